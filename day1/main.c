@@ -2,106 +2,111 @@
 #include "../knut.h"
 #define KNUT_DS_IMPLEMENTATION
 #include "../knut_ds.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_CACHE_IMPLEMENTATION
+#include "../knut_cache.h"
+#define KNUT_KNB_IMPLEMENTATION
+#include "../knut_knb.h"
 
-#include <inttypes.h>
-#include <math.h>
-
-static void part_one(const knut_array_int_data_t* left_numbers, 
-    const knut_array_int_data_t* right_numbers)
-{
-    uint64_t total_distance = 0;
-    const uint64_t list_size = left_numbers->size;
+#include "solve.h"
 
-    for (uint64_t i = 0; i < list_size; ++i)
-    {
-        total_distance += (uint64_t)fabs(left_numbers->buffer[i] - right_numbers->buffer[i]);
-    }
-    
-    printf("Part one: %" PRIu64 "\n", total_distance);
-}
+#include <inttypes.h>
 
-static void part_two(const knut_array_int_data_t* left_numbers, 
-    const knut_array_int_data_t* right_numbers)
+static int convert(const char* input_path, const char* output_path)
 {
-    const uint64_t list_size = left_numbers->size;
-    uint64_t total_similarity_score = 0;
-    int prev_number = 0;
-    uint64_t prev_similarity = 0;
-    uint64_t j = 0;
-
-    for (uint64_t i = 0; i < list_size; ++i)
-    {
-        uint64_t similarity = 0;
-        int current_number = left_numbers->buffer[i];
+    knut_io_mapped_file_t file;
+    knut_exit_if(knut_io_map_file(&file, input_path) != 0, "Unable to open file\n");
 
-        if (i != 0 && prev_number == current_number)
-        {
-            similarity = prev_similarity;
-        }
-        else
-        {
-            while (j < right_numbers->size && current_number > right_numbers->buffer[j]) { ++j; }
-            while (j < right_numbers->size && right_numbers->buffer[j] == current_number) 
-            { 
-                ++similarity;
-                ++j;
-            }
-
-            similarity *= current_number;
-        }
+    knut_array_int_t left_list;
+    knut_array_int_t right_list;
+    knut_exit_if(day1_parse(file.ptr, file.size, NULL, &left_list, &right_list) != 0,
+        "List sizes not matching\n");
 
-        total_similarity_score += similarity;
-        prev_number = current_number;
-        prev_similarity = similarity;
-    }
+    const knut_knb_source_t columns[2] = {
+        { KNUT_KNB_TYPE_I32, left_list.buffer, left_list.size },
+        { KNUT_KNB_TYPE_I32, right_list.buffer, right_list.size }
+    };
+    const int result = knut_knb_write(output_path, 1, columns, 2);
 
-    printf("Part two: %" PRIu64 "\n", total_similarity_score);
-}
+    knut_array_int_destroy(&left_list);
+    knut_array_int_destroy(&right_list);
+    knut_io_unmap_file(&file);
 
-static int compare_ints(const void* a, const void* b)
-{
-    return *(int*)a - *(int*)b;
+    return result;
 }
 
 int main(int argc, char** argv)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    if (argc == 4 && strcmp(argv[1], "-knb") == 0)
+    {
+        knut_exit_if(convert(argv[2], argv[3]) != 0, "Unable to write file\n");
+        return EXIT_SUCCESS;
+    }
+
+    knut_exit_if(argc != 2 && (argc != 3 || strcmp(argv[2], "-nocache") != 0),
+        "Usage: day1 input [-nocache]\n       day1 -knb input output.knb\n");
 
-    FILE* file = fopen(argv[1], "r");
-    knut_exit_if(!file, "Unable to open file\n");
+    /* A .knb input already holds both lists, they are sorted in the private mapping */
+    const bool binary = knut_knb_is_path(argv[1]);
+    knut_knb_t knb;
+    knut_io_mapped_file_t file;
+
+    if (binary)
+    {
+        knut_exit_if(knut_knb_open(&knb, argv[1], 1, 2) != 0, "Invalid knb file\n");
+        file = knb.file;
+    }
+    else
+    {
+        knut_exit_if(knut_io_map_file(&file, argv[1]) != 0, "Unable to open file\n");
+    }
 
-    const uint8_t LIST_CAPACITY = 64;
-    knut_array_int_t left_list = knut_array_int_create(LIST_CAPACITY);
-    knut_array_int_t right_list = knut_array_int_create(LIST_CAPACITY);
+    knut_cache_t cache;
+    knut_cache_open(&cache, argc == 3);
+    const knut_cache_key_t key = knut_cache_key(&cache, 1, file.ptr, file.size);
+    int64_t parts[2];
 
-    bool push_left = true;
-    int number;
-    while (fscanf_s(file, "%d", &number) == 1) 
+    if (!knut_cache_lookup(&cache, &key, parts, 2))
     {
-        if (push_left)
+        knut_answer_t answer;
+
+        if (binary)
         {
-            knut_array_int_push(&left_list, number);
+            knut_array_int_data_t left_numbers = knut_knb_int(&knb, 0);
+            knut_array_int_data_t right_numbers = knut_knb_int(&knb, 1);
+            knut_exit_if(day1_solve_lists(&left_numbers, &right_numbers, &answer) != 0,
+                "List sizes not matching\n");
         }
         else
         {
-            knut_array_int_push(&right_list, number);
+            knut_arena_t scratch;
+            knut_arena_init(&scratch, 1024 * 1024);
+            knut_exit_if(day1_solve(file.ptr, file.size, &scratch, &answer) != 0,
+                "List sizes not matching\n");
+            knut_arena_destroy(&scratch);
         }
 
-        push_left = !push_left;
+        parts[0] = answer.part_one;
+        parts[1] = answer.part_two;
+        knut_cache_store(&cache, &key, parts, 2);
     }
 
-    fclose(file);
-
-    knut_array_int_data_t left_numbers = knut_array_int_get_data(&left_list);
-    knut_array_int_data_t right_numbers = knut_array_int_get_data(&right_list);
-
-    knut_exit_if(left_numbers.size != right_numbers.size, "List sizes not matching\n");
+    printf("Part one: %" PRId64 "\n", parts[0]);
+    printf("Part two: %" PRId64 "\n", parts[1]);
 
-    qsort(left_numbers.buffer, left_numbers.size, sizeof(*left_numbers.buffer), compare_ints);
-    qsort(right_numbers.buffer, right_numbers.size, sizeof(*right_numbers.buffer), compare_ints);
+    knut_cache_close(&cache);
 
-    part_one(&left_numbers, &right_numbers);
-    part_two(&left_numbers, &right_numbers);
+    if (binary)
+    {
+        knut_knb_close(&knb);
+    }
+    else
+    {
+        knut_io_unmap_file(&file);
+    }
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "solve.h"
+
+#include <limits.h>
+
+static uint64_t part_one(const knut_array_int_data_t* left_numbers,
+    const knut_array_int_data_t* right_numbers)
+{
+    return knut_reduce_i32_abs_diff((const int32_t*)left_numbers->buffer,
+        (const int32_t*)right_numbers->buffer, left_numbers->size);
+}
+
+static uint64_t part_two(const knut_array_int_data_t* left_numbers,
+    const knut_array_int_data_t* right_numbers)
+{
+    const uint64_t list_size = left_numbers->size;
+    uint64_t total_similarity_score = 0;
+    int prev_number = 0;
+    uint64_t prev_similarity = 0;
+    uint64_t j = 0;
+
+    for (uint64_t i = 0; i < list_size; ++i)
+    {
+        uint64_t similarity = 0;
+        int current_number = left_numbers->buffer[i];
+
+        if (i != 0 && prev_number == current_number)
+        {
+            similarity = prev_similarity;
+        }
+        else
+        {
+            while (j < right_numbers->size && current_number > right_numbers->buffer[j]) { ++j; }
+            while (j < right_numbers->size && right_numbers->buffer[j] == current_number)
+            {
+                ++similarity;
+                ++j;
+            }
+
+            similarity *= current_number;
+        }
+
+        total_similarity_score += similarity;
+        prev_number = current_number;
+        prev_similarity = similarity;
+    }
+
+    return total_similarity_score;
+}
+
+static int compare_ints(const void* a, const void* b)
+{
+    return *(int*)a - *(int*)b;
+}
+
+/* The input isn't null terminated, so the numbers are read by hand */
+static bool next_number(const char* input, uint64_t size, uint64_t* i, int* number)
+{
+    while (*i < size && (input[*i] < '0' || input[*i] > '9')) { ++*i; }
+
+    if (*i == size)
+    {
+        return false;
+    }
+
+    *number = 0;
+    while (*i < size && input[*i] >= '0' && input[*i] <= '9')
+    {
+        const int digit = input[(*i)++] - '0';
+
+        /* Too large for an int, -1 fails the parse */
+        if (*number < 0 || *number > (INT_MAX - digit) / 10)
+        {
+            *number = -1;
+            continue;
+        }
+
+        *number = *number * 10 + digit;
+    }
+
+    return true;
+}
+
+int day1_parse(const char* input, uint64_t size, const knut_allocator_t* allocator,
+    knut_array_int_t* left_list, knut_array_int_t* right_list)
+{
+    uint64_t num_lines = 1;
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        num_lines += input[i] == '\n';
+    }
+
+    *left_list = knut_array_int_create_with(num_lines, allocator);
+    *right_list = knut_array_int_create_with(num_lines, allocator);
+
+    bool push_left = true;
+    uint64_t i = 0;
+    int number;
+    while (next_number(input, size, &i, &number))
+    {
+        if (number < 0)
+        {
+            return -1;
+        }
+
+        if (push_left)
+        {
+            knut_array_int_push(left_list, number);
+        }
+        else
+        {
+            knut_array_int_push(right_list, number);
+        }
+
+        push_left = !push_left;
+    }
+
+    return left_list->size == right_list->size ? 0 : -1;
+}
+
+int day1_solve_lists(knut_array_int_data_t* left_numbers, knut_array_int_data_t* right_numbers,
+    knut_answer_t* answer)
+{
+    if (left_numbers->size != right_numbers->size)
+    {
+        return -1;
+    }
+
+    qsort(left_numbers->buffer, left_numbers->size, sizeof(*left_numbers->buffer), compare_ints);
+    qsort(right_numbers->buffer, right_numbers->size, sizeof(*right_numbers->buffer),
+        compare_ints);
+
+    answer->part_one = (int64_t)part_one(left_numbers, right_numbers);
+    answer->part_two = (int64_t)part_two(left_numbers, right_numbers);
+
+    return 0;
+}
+
+int day1_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer)
+{
+    const knut_allocator_t allocator = knut_allocator_arena(scratch, NULL);
+    knut_array_int_t left_list;
+    knut_array_int_t right_list;
+
+    if (day1_parse(input, size, &allocator, &left_list, &right_list) != 0)
+    {
+        return -1;
+    }
+
+    knut_array_int_data_t left_numbers = knut_array_int_get_data(&left_list);
+    knut_array_int_data_t right_numbers = knut_array_int_get_data(&right_list);
+
+    return day1_solve_lists(&left_numbers, &right_numbers, answer);
+}
@@ -0,0 +1,14 @@
+#ifndef DAY1_SOLVE_H
+#define DAY1_SOLVE_H
+
+#include "../knut_solve.h"
+
+/* Splits the input into the two lists, -1 if their sizes don't match */
+int day1_parse(const char* input, uint64_t size, const knut_allocator_t* allocator,
+    knut_array_int_t* left_list, knut_array_int_t* right_list);
+/* Sorts both lists in place */
+int day1_solve_lists(knut_array_int_data_t* left_numbers, knut_array_int_data_t* right_numbers,
+    knut_answer_t* answer);
+int day1_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer);
+
+#endif // DAY1_SOLVE_H
@@ -4,9 +4,10 @@
 #include "../knut_ds.h"
 #define KNUT_IO_IMPLEMENTATION
 #include "../knut_io.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
 
 #include <inttypes.h>
-#include <math.h>
 
 KNUT_DEFINE_ARRAY(knut_pair_u64_t, pair_u64)
 KNUT_DEFINE_DEQUEUE(knut_pair_u64_t, pair_u64)
@@ -43,6 +44,8 @@ static void part_one(const knut_buffer_char_t* map, uint64_t width, uint64_t hei
         (knut_pair_i8_t){ 0, -1 },
     };
 
+    /* Positions taken off the queue at once */
+    enum { BATCH_SIZE = 64 };
     uint64_t score = 0;
 
     for (uint64_t x = 0; x < width; ++x)
@@ -61,18 +64,28 @@ static void part_one(const knut_buffer_char_t* map, uint64_t width, uint64_t hei
                 knut_dequeue_pair_u64_push_back(&queue, pos);
                 visited.ptr[to_index(x, y, width)] = true;
 
+                knut_pair_u64_t batch[BATCH_SIZE];
+
                 while (!knut_dequeue_pair_u64_is_empty(&queue))
                 {
-                    pos = knut_dequeue_pair_u64_front(&queue);
-                    knut_dequeue_pair_u64_pop_front(&queue);
-                    current_tile = tile(map, pos.first, pos.second, width, height);
+                    const uint64_t queue_size = knut_dequeue_pair_u64_size(&queue);
+                    const uint64_t batch_size = queue_size < BATCH_SIZE ? queue_size : BATCH_SIZE;
+                    knut_dequeue_pair_u64_pop_front_slice(&queue, batch, batch_size);
 
-                    if (current_tile == 9)
-                    {
-                        ++reached;
-                    }
-                    else
+                    for (uint64_t b = 0; b < batch_size; ++b)
                     {
+                        pos = batch[b];
+                        current_tile = tile(map, pos.first, pos.second, width, height);
+
+                        if (current_tile == 9)
+                        {
+                            ++reached;
+                            continue;
+                        }
+
+                        knut_pair_u64_t found[NUM_DIRECTIONS];
+                        uint8_t num_found = 0;
+
                         for (uint8_t i = 0; i < NUM_DIRECTIONS; ++i)
                         {
                             const knut_pair_i8_t dir = directions[i];
@@ -89,12 +102,13 @@ static void part_one(const knut_buffer_char_t* map, uint64_t width, uint64_t hei
                                 !visited.ptr[neighbour_index])
                             {
                                 visited.ptr[neighbour_index] = true;
-                                knut_dequeue_pair_u64_push_back(&queue,
-                                    (knut_pair_u64_t) {
+                                found[num_found++] = (knut_pair_u64_t) {
                                     neighbour.first, neighbour.second
-                                });
+                                };
                             }
                         }
+
+                        knut_dequeue_pair_u64_push_back_slice(&queue, found, num_found);
                     }
                 }
 
@@ -110,6 +124,253 @@ static void part_one(const knut_buffer_char_t* map, uint64_t width, uint64_t hei
 }
 
 
+#define MAX_HEIGHT 9
+#define SUMMIT_BLOCK_BITS 512
+#define SUMMIT_BLOCK_WORDS (SUMMIT_BLOCK_BITS / 64)
+#define SUMMIT_TILE_COLUMNS 64
+#define SUMMIT_TILE_MAX_ROWS 256
+
+typedef struct {
+    uint64_t words[SUMMIT_BLOCK_WORDS];
+} summit_set_t;
+
+typedef struct {
+    const knut_buffer_char_t* map;
+    uint64_t width;
+    uint64_t height;
+    const knut_array_u64_t* summits;
+    const knut_array_u64_t* block_starts;
+    uint64_t first_block;
+    uint64_t block_stride;
+    uint64_t score;
+} bitset_worker_t;
+
+static void or_reachable(summit_set_t* reachable, const summit_set_t* neighbour)
+{
+    for (uint8_t w = 0; w < SUMMIT_BLOCK_WORDS; ++w)
+    {
+        reachable->words[w] |= neighbour->words[w];
+    }
+}
+
+static uint64_t count_reachable(const summit_set_t* reachable)
+{
+    uint64_t count = 0;
+
+    for (uint8_t w = 0; w < SUMMIT_BLOCK_WORDS; ++w)
+    {
+        count += knut_popcount_u64(reachable->words[w]);
+    }
+
+    return count;
+}
+
+// Every summit in a block is given one bit. The bits are propagated downhill one level per
+// sweep, restricted to the window of cells that are within MAX_HEIGHT steps of the block.
+static void bitset_worker(void* arg)
+{
+    bitset_worker_t* worker = (bitset_worker_t*)arg;
+    const char* map = worker->map->ptr;
+    const uint64_t width = worker->width;
+    const uint64_t num_blocks = knut_array_u64_size(worker->block_starts) - 1;
+    summit_set_t* reachable = NULL;
+    uint64_t reachable_capacity = 0;
+
+    for (uint64_t b = worker->first_block; b < num_blocks; b += worker->block_stride)
+    {
+        const uint64_t first_summit = knut_array_u64_at(worker->block_starts, b);
+        const uint64_t end_summit = knut_array_u64_at(worker->block_starts, b + 1);
+        knut_pair_u64_t rows = { UINT64_MAX, 0 };
+        knut_pair_u64_t columns = { UINT64_MAX, 0 };
+
+        for (uint64_t s = first_summit; s < end_summit; ++s)
+        {
+            const uint64_t summit = knut_array_u64_at(worker->summits, s);
+            rows.first = summit / width < rows.first ? summit / width : rows.first;
+            rows.second = summit / width > rows.second ? summit / width : rows.second;
+            columns.first = summit % width < columns.first ? summit % width : columns.first;
+            columns.second = summit % width > columns.second ? summit % width : columns.second;
+        }
+
+        const uint64_t x0 = columns.first > MAX_HEIGHT ? columns.first - MAX_HEIGHT : 0;
+        const uint64_t y0 = rows.first > MAX_HEIGHT ? rows.first - MAX_HEIGHT : 0;
+        const uint64_t x1 = columns.second + MAX_HEIGHT + 1 < width ? 
+            columns.second + MAX_HEIGHT + 1 : width;
+        const uint64_t y1 = rows.second + MAX_HEIGHT + 1 < worker->height ? 
+            rows.second + MAX_HEIGHT + 1 : worker->height;
+        const uint64_t window_width = x1 - x0;
+        const uint64_t window_height = y1 - y0;
+        const uint64_t window_size = window_width * window_height;
+
+        if (reachable_capacity < window_size)
+        {
+            reachable_capacity = window_size;
+            reachable = (summit_set_t*)realloc(reachable, 
+                reachable_capacity * sizeof(*reachable));
+            KNUT_ASSERT(reachable, "[bitset_worker] Failed to alloc reachable sets\n");
+        }
+
+        #define WINDOW_TILE(lx, ly) \
+            ((y0 + (ly)) * width + x0 + (lx) < worker->map->size ? \
+                map[(y0 + (ly)) * width + x0 + (lx)] : ' ')
+
+        for (uint64_t ly = 0; ly < window_height; ++ly)
+        {
+            for (uint64_t lx = 0; lx < window_width; ++lx)
+            {
+                if (WINDOW_TILE(lx, ly) == '0' + MAX_HEIGHT)
+                {
+                    memset(&reachable[ly * window_width + lx], 0, sizeof(*reachable));
+                }
+            }
+        }
+
+        for (uint64_t s = first_summit; s < end_summit; ++s)
+        {
+            const uint64_t bit = s - first_summit;
+            const uint64_t summit = knut_array_u64_at(worker->summits, s);
+            const uint64_t i = (summit / width - y0) * window_width + summit % width - x0;
+            reachable[i].words[bit / 64] |= (uint64_t)1 << (bit % 64);
+        }
+
+        for (int8_t level = MAX_HEIGHT - 1; level >= 0; --level)
+        {
+            const char current = (char)('0' + level);
+            const char next = (char)(current + 1);
+
+            for (uint64_t ly = 0; ly < window_height; ++ly)
+            {
+                for (uint64_t lx = 0; lx < window_width; ++lx)
+                {
+                    if (WINDOW_TILE(lx, ly) != current)
+                    {
+                        continue;
+                    }
+
+                    const uint64_t i = ly * window_width + lx;
+                    summit_set_t acc = {0};
+
+                    if (lx > 0 && WINDOW_TILE(lx - 1, ly) == next) 
+                    { 
+                        or_reachable(&acc, &reachable[i - 1]); 
+                    }
+                    if (lx + 1 < window_width && WINDOW_TILE(lx + 1, ly) == next) 
+                    { 
+                        or_reachable(&acc, &reachable[i + 1]); 
+                    }
+                    if (ly > 0 && WINDOW_TILE(lx, ly - 1) == next) 
+                    { 
+                        or_reachable(&acc, &reachable[i - window_width]); 
+                    }
+                    if (ly + 1 < window_height && WINDOW_TILE(lx, ly + 1) == next) 
+                    { 
+                        or_reachable(&acc, &reachable[i + window_width]); 
+                    }
+
+                    reachable[i] = acc;
+                }
+            }
+        }
+
+        for (uint64_t ly = 0; ly < window_height; ++ly)
+        {
+            for (uint64_t lx = 0; lx < window_width; ++lx)
+            {
+                if (WINDOW_TILE(lx, ly) == '0')
+                {
+                    worker->score += count_reachable(&reachable[ly * window_width + lx]);
+                }
+            }
+        }
+
+        #undef WINDOW_TILE
+    }
+
+    free(reachable);
+}
+
+static void part_one_bitset(const knut_buffer_char_t* map, uint64_t width, uint64_t height,
+    uint32_t num_threads)
+{
+    knut_array_u64_t summits = knut_array_u64_create(1024);
+    knut_array_u64_t block_starts = knut_array_u64_create(64);
+
+    // Summits are tiled column stripe by column stripe so that each block of summit bits
+    // covers a compact area of the map.
+    for (uint64_t stripe = 0; stripe < width; stripe += SUMMIT_TILE_COLUMNS)
+    {
+        const uint64_t stripe_end = stripe + SUMMIT_TILE_COLUMNS < width ? 
+            stripe + SUMMIT_TILE_COLUMNS : width;
+        uint64_t block_start = knut_array_u64_size(&summits);
+        uint64_t block_row = 0;
+
+        for (uint64_t y = 0; y < height; ++y)
+        {
+            for (uint64_t x = stripe; x < stripe_end; ++x)
+            {
+                const uint64_t i = to_index(x, y, width);
+
+                if (i >= map->size || map->ptr[i] != '0' + MAX_HEIGHT)
+                {
+                    continue;
+                }
+
+                const uint64_t s = knut_array_u64_size(&summits);
+
+                if (s == block_start || s - block_start == SUMMIT_BLOCK_BITS || 
+                    y - block_row >= SUMMIT_TILE_MAX_ROWS)
+                {
+                    knut_array_u64_push(&block_starts, s);
+                    block_start = s;
+                    block_row = y;
+                }
+
+                knut_array_u64_push(&summits, i);
+            }
+        }
+    }
+
+    knut_array_u64_push(&block_starts, knut_array_u64_size(&summits));
+
+    const uint64_t num_blocks = knut_array_u64_size(&block_starts) - 1;
+    num_threads = num_threads > num_blocks ? (uint32_t)num_blocks : num_threads;
+    num_threads = num_threads > 0 ? num_threads : 1;
+
+    bitset_worker_t* workers = (bitset_worker_t*)calloc(num_threads, sizeof(*workers));
+    knut_thread_t* threads = (knut_thread_t*)calloc(num_threads, sizeof(*threads));
+    KNUT_ASSERT(workers && threads, "[part_one_bitset] Failed to alloc workers\n");
+
+    for (uint32_t t = 0; t < num_threads; ++t)
+    {
+        workers[t] = (bitset_worker_t){ 
+            map, width, height, &summits, &block_starts, t, num_threads, 0 
+        };
+
+        if (t > 0)
+        {
+            const knut_function_t function = { bitset_worker, &workers[t] };
+            knut_exit_if(knut_thread_create(&threads[t], function) != 0, 
+                "Failed to create thread\n");
+        }
+    }
+
+    bitset_worker(&workers[0]);
+    uint64_t score = workers[0].score;
+
+    for (uint32_t t = 1; t < num_threads; ++t)
+    {
+        knut_thread_join(threads[t]);
+        score += workers[t].score;
+    }
+
+    printf("Part one: %" PRIu64 "\n", score);
+
+    free(threads);
+    free(workers);
+    knut_array_u64_destroy(&block_starts);
+    knut_array_u64_destroy(&summits);
+}
+
 static void search(const knut_buffer_char_t* map, uint64_t width, uint64_t height, 
     knut_pair_i64_t current_pos, uint64_t* num_found)
 {
@@ -176,15 +437,37 @@ static void part_two(const knut_buffer_char_t* map, uint64_t width, uint64_t hei
 
 int main(int argc, char** argv)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    knut_exit_if(argc < 2 || argc > 4, "Wrong number of args\n");
+
+    const bool use_bitset = argc > 2 && strcmp(argv[2], "--bitset") == 0;
+    knut_exit_if(argc > 2 && !use_bitset, "Unknown mode, expected --bitset [num_threads]\n");
+    const uint32_t num_threads = argc > 3 ? 
+        (uint32_t)strtoul(argv[3], NULL, 10) : 1;
 
     knut_buffer_char_t map;
     knut_io_read_binary(&map, argv[1]);
 
-    const uint64_t width = strchr(map.ptr, '\n') - map.ptr + 1;
-    const uint64_t height = (uint64_t)ceill(map.size / (double)width);
+    knut_io_line_index_t lines;
+    KNUT_ASSERT(knut_io_index_lines(&lines, map.ptr, map.size,
+        knut_thread_hardware_concurrency(), knut_thread_run_all) == 0, 
+        "Failed to index lines\n");
+    knut_exit_if(knut_io_grid_width(&lines, map.ptr) < 0, "Lines differ in width\n");
+
+    /* Rows keep their line breaks, so the row stride is one past the line length */
+    const uint64_t width = knut_io_line_length(&lines, 0) + 1;
+    const uint64_t height = lines.num_lines;
+    knut_io_line_index_destroy(&lines);
+
+    if (use_bitset)
+    {
+        part_one_bitset(&map, width, height, 
+            num_threads > 0 ? num_threads : knut_thread_hardware_concurrency());
+    }
+    else
+    {
+        part_one(&map, width, height);
+    }
 
-    part_one(&map, width, height);
     part_two(&map, width, height);
 
     knut_buffer_char_destroy(&map);
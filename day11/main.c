@@ -11,6 +11,7 @@ typedef struct {
     uint64_t num_blinks;
 } stone_t;
 
+KNUT_DEFINE_ARRAY(stone_t, stone)
 KNUT_DEFINE_DEQUEUE(stone_t, stone)
 
 static uint64_t num_digits(uint64_t nr)
@@ -40,23 +41,590 @@ static bool split_number(knut_pair_u32_t* numbers, uint64_t nr)
     return true;
 }
 
-int main(int argc, char** argv)
+#define NO_CHILD UINT32_MAX
+
+typedef struct {
+    uint32_t children[2];
+} transition_t;
+
+KNUT_DEFINE_ARRAY(transition_t, transition)
+KNUT_DEFINE_ARRAY(knut_array_u32_t, bigint)
+
+static uint8_t blink(uint64_t nr, uint64_t* children)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    if (nr == 0)
+    {
+        children[0] = 1;
+        return 1;
+    }
 
-    knut_dequeue_stone_t stones = knut_dequeue_stone_create(1024);
+    const uint64_t digit_count = num_digits(nr);
+
+    if (digit_count % 2 == 0)
+    {
+        uint64_t div = 1;
+        for (uint64_t i = 0; i < digit_count / 2; ++i) { div *= 10; }
+        children[0] = nr / div;
+        children[1] = nr % div;
+        return 2;
+    }
+
+    KNUT_ASSERT(nr <= UINT64_MAX / 2024, "[blink] Stone number overflow\n");
+    children[0] = nr * 2024;
+    return 1;
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    const uint64_t lhs = *(const uint64_t*)a;
+    const uint64_t rhs = *(const uint64_t*)b;
+    return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+static void sort_unique(knut_array_u64_t* numbers)
+{
+    knut_array_u64_data_t data = knut_array_u64_get_data(numbers);
+
+    if (data.size == 0)
+    {
+        return;
+    }
+
+    qsort(data.buffer, data.size, sizeof(*data.buffer), compare_u64);
+    uint64_t j = 1;
+
+    for (uint64_t i = 1; i < data.size; ++i)
+    {
+        if (data.buffer[i] != data.buffer[j - 1])
+        {
+            data.buffer[j++] = data.buffer[i];
+        }
+    }
+
+    numbers->size = j;
+}
+
+static uint32_t index_of(const knut_array_u64_t* values, uint64_t nr)
+{
+    const uint64_t* found = (const uint64_t*)bsearch(&nr, values->buffer, values->size, 
+        sizeof(*values->buffer), compare_u64);
+    KNUT_ASSERT(found, "[index_of] Stone number not in closed set\n");
+    return (uint32_t)(found - values->buffer);
+}
+
+// Sorted set of every stone number that can appear when blinking at the input stones
+static knut_array_u64_t closed_set(const knut_array_u64_t* numbers)
+{
+    knut_array_u64_t values = knut_array_u64_copy(numbers);
+    sort_unique(&values);
+    knut_array_u64_t frontier = knut_array_u64_copy(&values);
+    knut_array_u64_t next = knut_array_u64_create(64);
+
+    while (!knut_array_u64_is_empty(&frontier))
+    {
+        knut_array_u64_clear(&next);
+
+        for (uint64_t i = 0; i < knut_array_u64_size(&frontier); ++i)
+        {
+            uint64_t children[2];
+            const uint8_t num_children = blink(knut_array_u64_at(&frontier, i), children);
+
+            for (uint8_t c = 0; c < num_children; ++c)
+            {
+                if (!bsearch(&children[c], values.buffer, values.size, 
+                    sizeof(*values.buffer), compare_u64))
+                {
+                    knut_array_u64_push(&next, children[c]);
+                }
+            }
+        }
+
+        sort_unique(&next);
+        knut_array_u64_push_slice(&values, next.buffer, next.size);
+        sort_unique(&values);
+
+        knut_array_u64_t tmp = frontier;
+        frontier = next;
+        next = tmp;
+    }
+
+    knut_array_u64_destroy(&next);
+    knut_array_u64_destroy(&frontier);
+
+    return values;
+}
+
+static void bigint_add(knut_array_u32_t* dst, const knut_array_u32_t* src)
+{
+    while (dst->size < src->size)
+    {
+        knut_array_u32_push(dst, 0);
+    }
+
+    uint64_t carry = 0;
+
+    for (uint64_t i = 0; i < dst->size && (carry != 0 || i < src->size); ++i)
+    {
+        const uint64_t sum = (uint64_t)dst->buffer[i] + (i < src->size ? src->buffer[i] : 0) + 
+            carry;
+        dst->buffer[i] = (uint32_t)sum;
+        carry = sum >> 32;
+    }
+
+    if (carry != 0)
+    {
+        knut_array_u32_push(dst, (uint32_t)carry);
+    }
+}
+
+static void bigint_print(const knut_array_u32_t* value)
+{
+    knut_array_u32_t quotient = knut_array_u32_copy(value);
+    knut_array_u32_t chunks = knut_array_u32_create(16);
+    const uint32_t chunk_base = 1000000000;
+
+    do
+    {
+        uint64_t remainder = 0;
+
+        for (uint64_t i = quotient.size; i-- > 0;)
+        {
+            const uint64_t current = (remainder << 32) | quotient.buffer[i];
+            quotient.buffer[i] = (uint32_t)(current / chunk_base);
+            remainder = current % chunk_base;
+        }
+
+        while (quotient.size > 0 && quotient.buffer[quotient.size - 1] == 0) 
+        { 
+            --quotient.size; 
+        }
+
+        knut_array_u32_push(&chunks, (uint32_t)remainder);
+    } while (quotient.size > 0);
+
+    printf("%" PRIu32, chunks.buffer[chunks.size - 1]);
+
+    for (uint64_t i = chunks.size - 1; i-- > 0;)
+    {
+        printf("%09" PRIu32, chunks.buffer[i]);
+    }
+
+    knut_array_u32_destroy(&chunks);
+    knut_array_u32_destroy(&quotient);
+}
+
+static void step_modulo(const knut_array_transition_t* transitions, uint64_t** counts, 
+    uint64_t** next_counts, uint64_t modulus)
+{
+    const uint64_t size = knut_array_transition_size(transitions);
+    memset(*next_counts, 0, size * sizeof(**next_counts));
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        const transition_t t = transitions->buffer[i];
+        for (uint8_t c = 0; c < 2 && t.children[c] != NO_CHILD; ++c)
+        {
+            (*next_counts)[t.children[c]] = ((*next_counts)[t.children[c]] + (*counts)[i]) % 
+                modulus;
+        }
+    }
+
+    uint64_t* tmp = *counts;
+    *counts = *next_counts;
+    *next_counts = tmp;
+}
+
+static void step_exact(const knut_array_transition_t* transitions, knut_array_bigint_t* counts, 
+    knut_array_bigint_t* next_counts)
+{
+    const uint64_t size = knut_array_transition_size(transitions);
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        knut_array_u32_clear(&next_counts->buffer[i]);
+    }
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        const transition_t t = transitions->buffer[i];
+        for (uint8_t c = 0; c < 2 && t.children[c] != NO_CHILD && counts->buffer[i].size > 0; ++c)
+        {
+            bigint_add(&next_counts->buffer[t.children[c]], &counts->buffer[i]);
+        }
+    }
+
+    knut_array_bigint_t tmp = *counts;
+    *counts = *next_counts;
+    *next_counts = tmp;
+}
+
+static uint64_t pow_modulo(uint64_t base, uint64_t exponent, uint64_t modulus)
+{
+    uint64_t result = 1;
+    base %= modulus;
+
+    while (exponent > 0)
+    {
+        if (exponent & 1) { result = result * base % modulus; }
+        base = base * base % modulus;
+        exponent >>= 1;
+    }
+
+    return result;
+}
+
+static bool is_prime(uint64_t nr)
+{
+    if (nr < 2) { return false; }
+
+    for (uint64_t d = 2; d * d <= nr; ++d)
+    {
+        if (nr % d == 0) { return false; }
+    }
+
+    return true;
+}
+
+// Berlekamp-Massey: shortest recurrence sequence[n] = sum(recurrence[i] * sequence[n - 1 - i])
+static knut_array_u64_t find_recurrence(const knut_array_u64_t* sequence, uint64_t modulus)
+{
+    const uint64_t size = knut_array_u64_size(sequence);
+    knut_array_u64_t current = knut_array_u64_create(size + 1);
+    knut_array_u64_t previous = knut_array_u64_create(size + 1);
+    knut_array_u64_t tmp = knut_array_u64_create(size + 1);
+
+    for (uint64_t i = 0; i <= size; ++i)
+    {
+        knut_array_u64_push(&current, 0);
+        knut_array_u64_push(&previous, 0);
+        knut_array_u64_push(&tmp, 0);
+    }
+
+    current.buffer[0] = 1;
+    previous.buffer[0] = 1;
+    uint64_t length = 0;
+    uint64_t shift = 1;
+    uint64_t previous_discrepancy = 1;
+
+    for (uint64_t n = 0; n < size; ++n)
+    {
+        uint64_t discrepancy = sequence->buffer[n];
+
+        for (uint64_t i = 1; i <= length; ++i)
+        {
+            discrepancy = (discrepancy + current.buffer[i] * sequence->buffer[n - i]) % modulus;
+        }
+
+        if (discrepancy == 0)
+        {
+            ++shift;
+            continue;
+        }
+
+        const uint64_t coef = discrepancy * 
+            pow_modulo(previous_discrepancy, modulus - 2, modulus) % modulus;
+        memcpy(tmp.buffer, current.buffer, (size + 1) * sizeof(*tmp.buffer));
+
+        for (uint64_t i = 0; i + shift <= size; ++i)
+        {
+            current.buffer[i + shift] = (current.buffer[i + shift] + modulus - 
+                coef * previous.buffer[i] % modulus) % modulus;
+        }
+
+        if (2 * length <= n)
+        {
+            length = n + 1 - length;
+            knut_array_u64_t swap = previous;
+            previous = tmp;
+            tmp = swap;
+            previous_discrepancy = discrepancy;
+            shift = 1;
+        }
+        else
+        {
+            ++shift;
+        }
+    }
+
+    knut_array_u64_t recurrence = knut_array_u64_create(length + 1);
+
+    for (uint64_t i = 1; i <= length; ++i)
+    {
+        knut_array_u64_push(&recurrence, (modulus - current.buffer[i]) % modulus);
+    }
+
+    knut_array_u64_destroy(&tmp);
+    knut_array_u64_destroy(&previous);
+    knut_array_u64_destroy(&current);
+
+    return recurrence;
+}
+
+// dst = lhs * rhs mod (x^L - sum(recurrence[i] * x^(L - 1 - i))), scratch holds 2L - 1 terms
+static void poly_mul_modulo(uint64_t* dst, const uint64_t* lhs, const uint64_t* rhs, 
+    const knut_array_u64_t* recurrence, uint64_t* scratch, uint64_t modulus)
+{
+    const uint64_t length = knut_array_u64_size(recurrence);
+    memset(scratch, 0, (2 * length - 1) * sizeof(*scratch));
+
+    for (uint64_t i = 0; i < length; ++i)
+    {
+        if (lhs[i] == 0) { continue; }
+
+        for (uint64_t j = 0; j < length; ++j)
+        {
+            scratch[i + j] += lhs[i] * rhs[j] % modulus;
+        }
+
+        if ((i & 0x3FF) == 0x3FF)
+        {
+            for (uint64_t j = 0; j < 2 * length - 1; ++j) { scratch[j] %= modulus; }
+        }
+    }
+
+    for (uint64_t i = 2 * length - 1; i-- > length;)
+    {
+        const uint64_t coef = scratch[i] % modulus;
+
+        for (uint64_t j = 0; j < length; ++j)
+        {
+            scratch[i - 1 - j] += coef * recurrence->buffer[j] % modulus;
+        }
+    }
+
+    for (uint64_t i = 0; i < length; ++i)
+    {
+        dst[i] = scratch[i] % modulus;
+    }
+}
+
+// The total stone count after n blinks is 1^T * M^n * v for the sparse transition matrix M, so 
+// it obeys a linear recurrence no longer than the closed set. The recurrence is found with 
+// Berlekamp-Massey, after which x^n is reduced modulo its characteristic polynomial by 
+// repeated squaring, which is the same as squaring M's companion matrix.
+static void count_modulo(const knut_array_transition_t* transitions, const uint32_t* initial, 
+    uint64_t num_initial, uint64_t blinks, uint64_t modulus)
+{
+    const uint64_t size = knut_array_transition_size(transitions);
+    uint64_t* counts = (uint64_t*)calloc(size, sizeof(*counts));
+    uint64_t* next_counts = (uint64_t*)calloc(size, sizeof(*next_counts));
+    KNUT_ASSERT(counts && next_counts, "[count_modulo] Failed to alloc counts\n");
+
+    for (uint64_t i = 0; i < num_initial; ++i)
+    {
+        counts[initial[i]] = (counts[initial[i]] + 1) % modulus;
+    }
+
+    const uint64_t num_terms = 2 * size + 2;
+    knut_array_u64_t sequence = knut_array_u64_create(num_terms);
+
+    for (uint64_t n = 0; n < num_terms; ++n)
+    {
+        uint64_t total = 0;
+        for (uint64_t i = 0; i < size; ++i) { total += counts[i]; }
+        knut_array_u64_push(&sequence, total % modulus);
+
+        if (n == blinks)
+        {
+            printf("Stones (mod %" PRIu64 "): %" PRIu64 "\n", modulus, total % modulus);
+            goto done;
+        }
+
+        step_modulo(transitions, &counts, &next_counts, modulus);
+    }
+
+    knut_array_u64_t recurrence = find_recurrence(&sequence, modulus);
+    const uint64_t length = knut_array_u64_size(&recurrence);
+
+    if (length == 0)
+    {
+        printf("Stones (mod %" PRIu64 "): 0\n", modulus);
+        knut_array_u64_destroy(&recurrence);
+        goto done;
+    }
+
+    uint64_t* result = (uint64_t*)calloc(length + 1, sizeof(*result));
+    uint64_t* scratch = (uint64_t*)calloc(2 * length + 1, sizeof(*scratch));
+    KNUT_ASSERT(result && scratch, "[count_modulo] Failed to alloc polynomials\n");
+
+    uint64_t top_bit = 63;
+    while (((blinks >> top_bit) & 1) == 0) { --top_bit; }
+    result[0] = 1;
+
+    for (uint64_t bit = top_bit + 1; bit-- > 0;)
+    {
+        poly_mul_modulo(result, result, result, &recurrence, scratch, modulus);
+
+        if ((blinks >> bit) & 1)
+        {
+            const uint64_t carry = result[length - 1];
+            memmove(result + 1, result, (length - 1) * sizeof(*result));
+            result[0] = 0;
+
+            for (uint64_t j = 0; j < length; ++j)
+            {
+                result[length - 1 - j] = (result[length - 1 - j] + 
+                    carry * recurrence.buffer[j] % modulus) % modulus;
+            }
+        }
+    }
+
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < length; ++i)
+    {
+        total = (total + result[i] * sequence.buffer[i]) % modulus;
+    }
+
+    printf("Stones (mod %" PRIu64 "): %" PRIu64 "\n", modulus, total);
+
+    free(scratch);
+    free(result);
+    knut_array_u64_destroy(&recurrence);
+
+done:
+    knut_array_u64_destroy(&sequence);
+    free(next_counts);
+    free(counts);
+}
+
+// Exact counts grow by a fixed number of bits per blink, so without fast multiplication
+// squaring can't beat stepping the sparse transitions with big integer additions.
+static void count_exact(const knut_array_transition_t* transitions, const uint32_t* initial, 
+    uint64_t num_initial, uint64_t blinks)
+{
+    const uint64_t size = knut_array_transition_size(transitions);
+    knut_array_bigint_t counts = knut_array_bigint_create(size);
+    knut_array_bigint_t next_counts = knut_array_bigint_create(size);
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        knut_array_bigint_push(&counts, knut_array_u32_create(4));
+        knut_array_bigint_push(&next_counts, knut_array_u32_create(4));
+    }
+
+    const knut_array_u32_t one = { &(uint32_t){ 1 }, 1, 1, NULL };
+
+    for (uint64_t i = 0; i < num_initial; ++i)
+    {
+        bigint_add(&counts.buffer[initial[i]], &one);
+    }
+
+    for (uint64_t b = 0; b < blinks; ++b)
+    {
+        step_exact(transitions, &counts, &next_counts);
+    }
+
+    knut_array_u32_t total = knut_array_u32_create(4);
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        bigint_add(&total, &counts.buffer[i]);
+    }
+
+    printf("Stones: ");
+    if (knut_array_u32_is_empty(&total)) { printf("0"); } else { bigint_print(&total); }
+    printf("\n");
+
+    knut_array_u32_destroy(&total);
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        knut_array_u32_destroy(&counts.buffer[i]);
+        knut_array_u32_destroy(&next_counts.buffer[i]);
+    }
+
+    knut_array_bigint_destroy(&next_counts);
+    knut_array_bigint_destroy(&counts);
+}
+
+static void count_with_matrix(const knut_array_u64_t* numbers, uint64_t blinks, uint64_t modulus)
+{
+    knut_array_u64_t values = closed_set(numbers);
+    const uint64_t size = knut_array_u64_size(&values);
+    knut_exit_if(size >= NO_CHILD, "Closed set of stone numbers too large\n");
+    knut_array_transition_t transitions = knut_array_transition_create(size);
+
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        uint64_t children[2];
+        const uint8_t num_children = blink(knut_array_u64_at(&values, i), children);
+        transition_t t = { { NO_CHILD, NO_CHILD } };
+
+        for (uint8_t c = 0; c < num_children; ++c)
+        {
+            t.children[c] = index_of(&values, children[c]);
+        }
+
+        knut_array_transition_push(&transitions, t);
+    }
+
+    knut_array_u32_t initial = knut_array_u32_create(knut_array_u64_size(numbers));
+
+    for (uint64_t i = 0; i < knut_array_u64_size(numbers); ++i)
+    {
+        knut_array_u32_push(&initial, index_of(&values, knut_array_u64_at(numbers, i)));
+    }
+
+    if (modulus != 0)
+    {
+        count_modulo(&transitions, initial.buffer, initial.size, blinks, modulus);
+    }
+    else
+    {
+        count_exact(&transitions, initial.buffer, initial.size, blinks);
+    }
+
+    knut_array_u32_destroy(&initial);
+    knut_array_transition_destroy(&transitions);
+    knut_array_u64_destroy(&values);
+}
+
+int main(int argc, char** argv)
+{
+    knut_exit_if(argc != 2 && argc != 4 && argc != 5, "Wrong number of args\n");
+    knut_exit_if(argc > 2 && strcmp(argv[2], "--matrix") != 0, 
+        "Unknown mode, expected --matrix <blinks> [prime]\n");
 
     FILE* file = fopen(argv[1], "rb");
+    knut_exit_if(!file, "Unable to open file\n");
 
-    uint64_t total_stones = 0;
-    const uint8_t max_blinks = 25;
+    knut_array_u64_t numbers = knut_array_u64_create(16);
     uint64_t nr;
 
     while (fscanf_s(file, "%" PRIu64, &nr) == 1)
     {
-        knut_dequeue_stone_push_back(&stones, (stone_t){ nr, 0 });
+        knut_array_u64_push(&numbers, nr);
     }
 
+    fclose(file);
+
+    if (argc > 2)
+    {
+        const uint64_t blinks = strtoull(argv[3], NULL, 10);
+        const uint64_t modulus = argc > 4 ? strtoull(argv[4], NULL, 10) : 0;
+        knut_exit_if(argc > 4 && (modulus > UINT32_MAX || !is_prime(modulus)), 
+            "Modulus must be a prime below 2^32\n");
+
+        count_with_matrix(&numbers, blinks, modulus);
+        knut_array_u64_destroy(&numbers);
+
+        return EXIT_SUCCESS;
+    }
+
+    knut_dequeue_stone_t stones = knut_dequeue_stone_create(1024);
+    knut_array_stone_t initial_stones = knut_array_stone_create(knut_array_u64_size(&numbers));
+    uint64_t total_stones = 0;
+    const uint8_t max_blinks = 25;
+
+    for (uint64_t i = 0; i < knut_array_u64_size(&numbers); ++i)
+    {
+        knut_array_stone_push(&initial_stones, (stone_t){ knut_array_u64_at(&numbers, i), 0 });
+    }
+
+    knut_dequeue_stone_push_back_slice(&stones, initial_stones.buffer, initial_stones.size);
+    knut_array_stone_destroy(&initial_stones);
+
     while (!knut_dequeue_stone_is_empty(&stones))
     {
         stone_t stone = knut_dequeue_stone_front(&stones);
@@ -92,8 +660,8 @@ int main(int argc, char** argv)
 
     printf("Part one: %" PRIu64 "\n", total_stones);
     
-    fclose(file);
     knut_dequeue_stone_destroy(&stones);
+    knut_array_u64_destroy(&numbers);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -1,5 +1,24 @@
 #define KNUT_IMPLEMENTATION
 #include "../knut.h"
+#define KNUT_DS_IMPLEMENTATION
+#include "../knut_ds.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#ifndef _WIN32
+#define KNUT_IO_URING_IMPLEMENTATION
+#include "../knut_io_uring.h"
+#endif
+#define KNUT_PIPELINE_IMPLEMENTATION
+#include "../knut_pipeline.h"
+
+#define BUFFER_SIZE 32
+
+typedef struct {
+    int numbers[BUFFER_SIZE];
+    uint8_t size;
+} report_t;
 
 static int part_one(int* report_numbers, uint8_t report_numbers_size)
 {
@@ -63,42 +82,62 @@ static int part_two(int* report_numbers, uint8_t report_numbers_size)
     return 1;
 }
 
-int main(int argc, char** argv)
+static bool parse_report(void* ctx, char* line, uint64_t length, void* record)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
-
-    FILE* file = fopen(argv[1], "r");
-    knut_exit_if(!file, "Unable to open file\n");
+    (void)ctx; (void)length;
+    report_t* report = (report_t*)record;
+    char* input = line;
+    report->size = 0;
 
-    #define BUFFER_SIZE 32
-    char report_input[BUFFER_SIZE] = {0};
-    int report_numbers[BUFFER_SIZE] = {0};
-    uint8_t report_numbers_size = 0;
-    int total_num_safe_reports[2] = {0};
-
-    while (fgets(report_input, BUFFER_SIZE, file))
+    while (report->size < BUFFER_SIZE && 
+        sscanf_s(input, "%d", &report->numbers[report->size]) == 1)
     {
-        char* input = report_input;
-        report_numbers_size = 0;
+        ++report->size;
 
-        while (report_numbers_size < BUFFER_SIZE && 
-            sscanf_s(input, "%d", &report_numbers[report_numbers_size]) == 1)
+        while (*input != ' ' && *input != '\0')
         {
-            ++report_numbers_size;
-
-            while (*input != ' ' && *input != '\0')
-            {
-                ++input;
-            }
-
-            if (*input == ' ') { ++input; }
+            ++input;
         }
 
-        total_num_safe_reports[0] += part_one(report_numbers, report_numbers_size);
-        total_num_safe_reports[1] += part_two(report_numbers, report_numbers_size);
+        if (*input == ' ') { ++input; }
     }
 
-    fclose(file);
+    return report->size >= 2;
+}
+
+static void solve_report(void* ctx, void* record, void* totals)
+{
+    (void)ctx;
+    report_t* report = (report_t*)record;
+    int* total_num_safe_reports = (int*)totals;
+    total_num_safe_reports[0] += part_one(report->numbers, report->size);
+    total_num_safe_reports[1] += part_two(report->numbers, report->size);
+}
+
+static void reduce_reports(void* ctx, void* totals, const void* worker_totals)
+{
+    (void)ctx;
+    ((int*)totals)[0] += ((const int*)worker_totals)[0];
+    ((int*)totals)[1] += ((const int*)worker_totals)[1];
+}
+
+int main(int argc, char** argv)
+{
+    knut_exit_if(argc != 2, "Wrong number of args\n");
+
+    const knut_pipeline_t pipeline = {
+        sizeof(report_t),
+        2 * sizeof(int),
+        parse_report,
+        solve_report,
+        reduce_reports,
+        NULL,
+        0
+    };
+    int total_num_safe_reports[2] = {0};
+
+    knut_exit_if(knut_pipeline_run(&pipeline, argv[1], total_num_safe_reports) != 0, 
+        "Unable to open file\n");
 
     printf("Part one: %d\n", total_num_safe_reports[0]);
     printf("Part two: %d\n", total_num_safe_reports[1]);
@@ -0,0 +1,88 @@
+#include "solve.h"
+
+#include "../knut_find.h"
+
+#include <stdbool.h>
+
+enum {
+    NEEDLE_MUL = 0,
+    NEEDLE_DO,
+    NEEDLE_DONT,
+    NUM_NEEDLES
+};
+
+#define MAX_NUMBER_DIGITS 3
+#define MATCH_BATCH_SIZE 256
+
+static bool parse_number(const char* data, uint64_t size, uint64_t* i, int* value)
+{
+    const uint64_t start = *i;
+    *value = 0;
+
+    while (*i < size && *i - start < MAX_NUMBER_DIGITS && data[*i] >= '0' && data[*i] <= '9')
+    {
+        *value = *value * 10 + (data[(*i)++] - '0');
+    }
+
+    return *i > start;
+}
+
+/* 'i' points right behind "mul(" */
+static bool parse_mul(const char* data, uint64_t size, uint64_t i, int* product)
+{
+    int left, right;
+
+    if (!parse_number(data, size, &i, &left) || i >= size || data[i++] != ',' ||
+        !parse_number(data, size, &i, &right) || i >= size || data[i] != ')')
+    {
+        return false;
+    }
+
+    *product = left * right;
+    return true;
+}
+
+int day3_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer)
+{
+    (void)scratch;
+
+    const char* const needles[NUM_NEEDLES] = { "mul(", "do()", "don't()" };
+    knut_find_t find;
+    knut_find_init(&find, needles, NUM_NEEDLES);
+
+    knut_find_match_t matches[MATCH_BATCH_SIZE];
+    uint64_t position = 0;
+    uint64_t num_matches;
+    bool do_mul = true;
+    int64_t total_part_one = 0;
+    int64_t total_part_two = 0;
+
+    while ((num_matches = knut_find_next(&find, input, size, &position, matches,
+        MATCH_BATCH_SIZE)) > 0)
+    {
+        for (uint64_t i = 0; i < num_matches; ++i)
+        {
+            const knut_find_match_t* match = &matches[i];
+            int product;
+
+            if (match->needle == NEEDLE_DO)
+            {
+                do_mul = true;
+            }
+            else if (match->needle == NEEDLE_DONT)
+            {
+                do_mul = false;
+            }
+            else if (parse_mul(input, size, match->offset + find.lengths[NEEDLE_MUL], &product))
+            {
+                total_part_one += product;
+                total_part_two += (do_mul ? 1 : 0) * product;
+            }
+        }
+    }
+
+    answer->part_one = total_part_one;
+    answer->part_two = total_part_two;
+
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef DAY3_SOLVE_H
+#define DAY3_SOLVE_H
+
+#include "../knut_solve.h"
+
+int day3_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer);
+
+#endif // DAY3_SOLVE_H
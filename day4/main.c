@@ -1,5 +1,9 @@
 #define KNUT_IMPLEMENTATION
 #include "../knut.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#define KNUT_FIND_IMPLEMENTATION
+#include "../knut_find.h"
 
 #include <inttypes.h>
 
@@ -8,181 +12,89 @@ typedef struct {
     uint64_t size;
 } string_t;
 
-static string_t read_file(FILE* file, uint64_t max_size)
-{
-    fseek(file, 0, SEEK_END);
-    const uint64_t size = ftell(file);
-    knut_exit_if(max_size < size + 1, "File too big\n");
-    rewind(file);
-
-    char* buffer = malloc(size + 1);
-
-    const size_t bytes_read = fread(buffer, sizeof(*buffer), size, file);
-    knut_exit_if(bytes_read != size, "Unable to read whole file\n");
-
-    buffer[bytes_read] = '\0';
-
-    return (string_t){buffer, bytes_read};
-}
-
-uint64_t remove_char(string_t* str, char to_remove)
+static uint32_t coordinate(uint32_t row, uint32_t column, uint32_t num_columns)
 {
-    uint64_t j = 0;
-
-    for (uint64_t i = 0; i < str->size; ++i)
-    {
-        if (str->buffer[i] != to_remove)
-        {
-            str->buffer[j++] = str->buffer[i];
-        }
-    }
-
-    const uint64_t removed = str->size - j;
-
-    str->buffer[j] = '\0';
-    str->size = j;
-
-    return removed;
+    return row * num_columns + column;
 }
 
-static bool intersects_linebreak(uint32_t index, uint32_t num_columns)
+static bool is_mas(const char* word)
 {
-    return index % num_columns > (num_columns - 4);
+    return word[1] == 'A' && 
+        ((word[0] == 'M' && word[2] == 'S') || (word[0] == 'S' && word[2] == 'M'));
 }
 
-static bool starts_with(const char* start, const char* with)
+/* Writes the cells from (r, c) on in steps of (dr, dc) followed by a line break */
+static char* append_line(char* out, const string_t* str, uint32_t num_columns, 
+    uint32_t num_rows, int32_t r, int32_t c, int32_t dr, int32_t dc)
 {
-    return strstr(start, with) == start;
-}
+    for (; r >= 0 && r < (int32_t)num_rows && c >= 0 && c < (int32_t)num_columns; 
+        r += dr, c += dc)
+    {
+        *out++ = str->buffer[coordinate(r, c, num_columns)];
+    }
 
-static uint32_t coordinate(uint32_t row, uint32_t column, uint32_t num_columns)
-{
-    return row * num_columns + column;
+    *out++ = '\n';
+    return out;
 }
 
-static void part_one(const string_t* str, uint32_t num_columns, uint32_t num_rows)
+/* Lays out every row, column and diagonal as its own line so that one search over them finds
+ * the words in all directions, returns the end of the written lines */
+static char* append_all_lines(char* out, const string_t* str, uint32_t num_columns, 
+    uint32_t num_rows)
 {
-    uint32_t num_horizontal = 0;
-
-    for (uint32_t i = 0; i < str->size; ++i)
+    for (uint32_t r = 0; r < num_rows; ++r)
     {
-        if (str->buffer[i] != '.')
-        {
-            const char* current = str->buffer + i;
-            const bool got_match = starts_with(current, "XMAS") || starts_with(current, "SAMX");
-            num_horizontal += got_match && !intersects_linebreak(i, num_columns) ? 1 : 0;
-        }
+        out = append_line(out, str, num_columns, num_rows, r, 0, 0, 1);
     }
 
-    uint32_t num_vertical = 0;
-
     for (uint32_t c = 0; c < num_columns; ++c)
     {
-        for (uint32_t r = 0; r < num_rows - 3; ++r)
-        {
-            if (str->buffer[coordinate(r, c, num_columns)] != '.')
-            {
-                const char word[] = { 
-                    str->buffer[coordinate(r, c, num_columns)],
-                    str->buffer[coordinate(r + 1, c, num_columns)],
-                    str->buffer[coordinate(r + 2, c, num_columns)],
-                    str->buffer[coordinate(r + 3, c, num_columns)],
-                    '\0'
-                };
-
-                const bool got_match = starts_with(word, "XMAS") || starts_with(word, "SAMX");
-                num_vertical += got_match ? 1 : 0;
-            }
-        }
+        out = append_line(out, str, num_columns, num_rows, 0, c, 1, 0);
     }
 
-    uint32_t num_diagonal = 0;
-
-    uint32_t start_r = num_rows - 4;
-    uint32_t start_c = 0;
-    bool scanning_left_bottom = true;
-
-    while (start_c < num_columns)
+    for (uint32_t r = num_rows; r-- > 0;)
     {
-        uint32_t r = start_r;
-        uint32_t c = start_c;
-
-        for (uint32_t r = start_r, c = start_c; r < num_rows - 3 && c < num_columns - 3; 
-            ++r, ++c)
-        {
-            if (str->buffer[coordinate(r, c, num_columns)] != '.')
-            {
-                const char word[] = { 
-                    str->buffer[coordinate(r, c, num_columns)],
-                    str->buffer[coordinate(r + 1, c + 1, num_columns)],
-                    str->buffer[coordinate(r + 2, c + 2, num_columns)],
-                    str->buffer[coordinate(r + 3, c + 3, num_columns)],
-                    '\0'
-                };
-
-                const bool got_match = starts_with(word, "XMAS") || starts_with(word, "SAMX");
-                num_diagonal += got_match ? 1 : 0;
-            }
-        }
+        out = append_line(out, str, num_columns, num_rows, r, 0, 1, 1);
+        out = append_line(out, str, num_columns, num_rows, r, 0, -1, 1);
+    }
 
-        if (scanning_left_bottom)
-        {
-            --start_r;
-            scanning_left_bottom = start_r > 0;
-        }
-        else
-        {
-            ++start_c;
-        }
+    for (uint32_t c = 1; c < num_columns; ++c)
+    {
+        out = append_line(out, str, num_columns, num_rows, 0, c, 1, 1);
+        out = append_line(out, str, num_columns, num_rows, num_rows - 1, c, -1, 1);
     }
 
-    start_r = 3;
-    start_c = 0;
-    bool scanning_top_left = true;
+    return out;
+}
+
+static void part_one(const string_t* str, uint32_t num_columns, uint32_t num_rows)
+{
+    const uint64_t num_cells = (uint64_t)num_columns * num_rows;
+    const uint64_t num_lines = num_rows + num_columns + 2 * (num_rows + num_columns - 1);
+    char* const lines = (char*)malloc(4 * num_cells + num_lines);
+    knut_exit_if(!lines, "Failed to alloc lines\n");
+    const char* const end = append_all_lines(lines, str, num_columns, num_rows);
 
-    while (start_c < num_columns)
-    {
-        uint32_t r = start_r;
-        uint32_t c = start_c;
+    const char* const words[] = { "XMAS", "SAMX" };
+    knut_find_t find;
+    knut_find_init(&find, words, 2);
 
-        for (uint32_t r = start_r, c = start_c; r > 2 && c < num_columns - 3; --r, ++c)
-        {
-            if (str->buffer[coordinate(r, c, num_columns)] != '.')
-            {
-                const char word[] = { 
-                    str->buffer[coordinate(r, c, num_columns)],
-                    str->buffer[coordinate(r - 1, c + 1, num_columns)],
-                    str->buffer[coordinate(r - 2, c + 2, num_columns)],
-                    str->buffer[coordinate(r - 3, c + 3, num_columns)],
-                    '\0'
-                };
-
-                const bool got_match = starts_with(word, "XMAS") || starts_with(word, "SAMX");
-                num_diagonal += got_match ? 1 : 0;
-            }
-        }
+    uint64_t counts[2] = {0};
+    const uint64_t total = knut_find_count(&find, lines, end - lines, counts);
 
-        if (scanning_top_left)
-        {
-            ++start_r;
-            scanning_top_left = start_r < num_rows - 1;
-        }
-        else
-        {
-            ++start_c;
-        }
-    }
+    printf("Part one: %" PRIu64 "\n", total);
 
-    printf("Part one: %" PRIu32 "\n", num_horizontal + num_vertical + num_diagonal);
+    free(lines);
 }
 
 static void part_two(const string_t* str, uint32_t num_columns, uint32_t num_rows)
 {
     uint32_t total = 0;
 
-    for (uint32_t r = 0; r < num_rows - 2; ++r)
+    /* Grids under 3x3 hold no X, num_rows - 2 would wrap around for them */
+    for (uint32_t r = 0; r + 2 < num_rows; ++r)
     {
-        for (uint32_t c = 0; c < num_columns - 2; ++c)
+        for (uint32_t c = 0; c + 2 < num_columns; ++c)
         {
             const char diag1[] = { 
                 str->buffer[coordinate(r, c, num_columns)],
@@ -197,7 +109,7 @@ static void part_two(const string_t* str, uint32_t num_columns, uint32_t num_row
                 '\0'
             };
 
-            const bool got_match = (starts_with(diag1, "MAS") || starts_with(diag1, "SAM")) && (starts_with(diag2, "MAS") || starts_with(diag2, "SAM"));
+            const bool got_match = is_mas(diag1) && is_mas(diag2);
             total += got_match ? 1 : 0;
         }
     }
@@ -209,20 +121,22 @@ int main(int argc, char** argv)
 {
     knut_exit_if(argc != 2, "Wrong number of args\n");
 
-    FILE* file = fopen(argv[1], "rb");
-    knut_exit_if(!file, "Unable to open file\n");
+    knut_buffer_char_t grid;
+    uint64_t width;
+    uint64_t height;
+    const int result = knut_io_read_grid(&grid, &width, &height, argv[1]);
+    knut_exit_if(result == -1, "Unable to read file\n");
+    knut_exit_if(result == -2, "Lines differ in width\n");
 
-    string_t str = read_file(file, (1 << 16) - 1);
-    fclose(file);
-
-    const char* newline = strchr(str.buffer, '\n');
-    knut_exit_if(!newline, "Expected newline in input\n");
-
-    const uint32_t num_columns = (uint32_t)(newline - str.buffer);
-    const uint32_t num_rows = (uint32_t)(remove_char(&str, '\n') + 1);
+    string_t str = { grid.ptr, grid.size };
+    const uint32_t num_columns = (uint32_t)width;
+    const uint32_t num_rows = (uint32_t)height;
+    knut_exit_if(num_columns == 0 || num_rows == 0, "Empty grid\n");
 
     part_one(&str, num_columns, num_rows);
     part_two(&str, num_columns, num_rows);
 
+    knut_buffer_char_destroy(&grid);
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
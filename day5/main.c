@@ -2,39 +2,68 @@
 #include "../knut.h"
 #define KNUT_DS_IMPLEMENTATION
 #include "../knut_ds.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#ifndef _WIN32
+#define KNUT_IO_URING_IMPLEMENTATION
+#include "../knut_io_uring.h"
+#endif
+#define KNUT_PIPELINE_IMPLEMENTATION
+#include "../knut_pipeline.h"
 
 #include <inttypes.h>
 #include <stdio.h>
 
+KNUT_DEFINE_SMALL_ARRAY(uint16_t, u16, 32)
+
 typedef struct {
-    knut_array_u16_t* rules;
+    knut_small_array_u16_t* rules;
     uint16_t nr;
 } page_t;
 
-KNUT_DEFINE_ARRAY(page_t, page)
+KNUT_DEFINE_SMALL_ARRAY(page_t, page, 32)
+
+#define MAX_PAGE_NR 1024
+
+/* Rules are only written by the parser, before the first update is handed out */
+typedef struct {
+    knut_small_array_u16_t rules[MAX_PAGE_NR];
+    bool parse_first_part;
+} context_t;
+
+typedef struct {
+    knut_small_array_u16_t page_numbers;
+} update_t;
+
+typedef struct {
+    uint32_t p1;
+    uint32_t p2;
+} totals_t;
 
 int sort_pages(const void* p1, const void* p2)
 {
     const page_t page1 = *(const page_t*)p1;
     const page_t page2 = *(const page_t*)p2;
  
-    knut_array_u16_t* rule1 = &page1.rules[page1.nr];
-    knut_array_u16_t* rule2 = &page2.rules[page2.nr];
-    const uint64_t rule1_size = knut_array_u16_size(rule1);
+    const knut_small_array_u16_t* rule1 = &page1.rules[page1.nr];
+    const knut_small_array_u16_t* rule2 = &page2.rules[page2.nr];
+    const uint64_t rule1_size = knut_small_array_u16_size(rule1);
 
     for (uint64_t i = 0; i < rule1_size; ++i)
     {
-        if (knut_array_u16_at(rule1, i) == page2.nr)
+        if (knut_small_array_u16_at(rule1, i) == page2.nr)
         {
             return -1;
         }
     }
 
-    const uint64_t rule2_size = knut_array_u16_size(rule2);
+    const uint64_t rule2_size = knut_small_array_u16_size(rule2);
 
     for (uint64_t i = 0; i < rule2_size; ++i)
     {
-        if (knut_array_u16_at(rule2, i) == page1.nr)
+        if (knut_small_array_u16_at(rule2, i) == page1.nr)
         {
             return 1;
         }
@@ -43,7 +72,8 @@ int sort_pages(const void* p1, const void* p2)
     return 0;
 }
 
-static bool is_equal(knut_array_page_data_t* page_data, knut_array_u16_data_t* page_numbers_data)
+static bool is_equal(knut_small_array_page_data_t* page_data, 
+    knut_small_array_u16_data_t* page_numbers_data)
 {
     for (uint64_t i = 0; i < page_data->size; ++i)
     {
@@ -56,78 +86,120 @@ static bool is_equal(knut_array_page_data_t* page_data, knut_array_u16_data_t* p
     return true;
 }
 
-int main(int argc, char** argv)
+static bool parse_line(void* ctx, char* line, uint64_t length, void* record)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    context_t* context = (context_t*)ctx;
 
-    FILE* file = fopen(argv[1], "r");
-    KNUT_ASSERT(file, "Unable to open file\n");
-
-    #define BUFFER_SIZE 1024
-
-    knut_array_u16_t rules[BUFFER_SIZE];
+    if (length == 0)
+    {
+        context->parse_first_part = false;
+        return false;
+    }
 
-    for (uint16_t i = 0; i < BUFFER_SIZE; ++i)
+    if (context->parse_first_part)
     {
-        rules[i] = knut_array_u16_create(0);
+        const knut_pair_u32_t pair = knut_parse_pair_u32(line, 10);
+        KNUT_ASSERT(pair.first < MAX_PAGE_NR, "Can't fit number in rules map\n");
+        knut_small_array_u16_push(&context->rules[pair.first], pair.second);
+        return false;
     }
 
-    char buffer[BUFFER_SIZE];
-    bool parse_first_part = true;
+    update_t* update = (update_t*)record;
+    knut_small_array_u16_init(&update->page_numbers);
 
-    knut_array_u16_t page_numbers = knut_array_u16_create(8);
-    knut_array_page_t pages = knut_array_page_create(8);
-    uint32_t middle_page_numbers_p1 = 0;
-    uint32_t middle_page_numbers_p2 = 0;
+    char* start = line;
+    char* delim;
+    uint32_t nr;
 
-    while (fgets(buffer, BUFFER_SIZE, file)) 
+    while ((nr = strtol(start, &delim, 10)) != 0)
     {
-        const bool input_split = strstr(buffer, "\n") == buffer;
-        parse_first_part &= !input_split;
+        knut_small_array_u16_push(&update->page_numbers, nr);
 
-        if (parse_first_part)
-        {
-            const knut_pair_u32_t pair = knut_parse_pair_u32(buffer, 10);
-            KNUT_ASSERT(pair.first < BUFFER_SIZE, "Can't fit number in rules map\n");
-            knut_array_u16_push(&rules[pair.first], pair.second);
-        }
-        else if (!input_split)
+        if (*delim == '\0')
         {
-            knut_array_u16_clear(&page_numbers);
-            knut_array_page_clear(&pages);
-
-            char* start = buffer;
-            char* delim;
-            uint32_t nr;
-
-            while ((nr = strtol(start, &delim, 10)) != 0)
-            {
-                knut_array_u16_push(&page_numbers, nr);
-                page_t p = { rules, nr };
-                knut_array_page_push(&pages, p);
-                start = delim + 1;
-            }
-
-            knut_array_page_data_t page_data = knut_array_page_get_data(&pages);
-            qsort(page_data.buffer, page_data.size, sizeof(*page_data.buffer), sort_pages);
-
-            knut_array_u16_data_t page_numbers_data = knut_array_u16_get_data(&page_numbers);
-
-            if (is_equal(&page_data, &page_numbers_data))
-            {
-                middle_page_numbers_p1 += page_numbers_data.buffer[page_numbers_data.size / 2];
-            }
-            else
-            {
-                middle_page_numbers_p2 += page_data.buffer[page_data.size / 2].nr;
-            }
+            break;
         }
+
+        start = delim + 1;
+    }
+
+    return true;
+}
+
+static void solve_update(void* ctx, void* record, void* totals)
+{
+    context_t* context = (context_t*)ctx;
+    update_t* update = (update_t*)record;
+    totals_t* t = (totals_t*)totals;
+
+    knut_small_array_u16_data_t page_numbers_data = 
+        knut_small_array_u16_get_data(&update->page_numbers);
+    knut_small_array_page_t pages = knut_small_array_page_create();
+
+    for (uint64_t i = 0; i < page_numbers_data.size; ++i)
+    {
+        page_t p = { context->rules, page_numbers_data.buffer[i] };
+        knut_small_array_page_push(&pages, p);
+    }
+
+    knut_small_array_page_data_t page_data = knut_small_array_page_get_data(&pages);
+    qsort(page_data.buffer, page_data.size, sizeof(*page_data.buffer), sort_pages);
+
+    if (is_equal(&page_data, &page_numbers_data))
+    {
+        t->p1 += page_numbers_data.buffer[page_numbers_data.size / 2];
+    }
+    else
+    {
+        t->p2 += page_data.buffer[page_data.size / 2].nr;
+    }
+
+    knut_small_array_page_destroy(&pages);
+    knut_small_array_u16_destroy(&update->page_numbers);
+}
+
+static void reduce_totals(void* ctx, void* totals, const void* worker_totals)
+{
+    (void)ctx;
+    ((totals_t*)totals)->p1 += ((const totals_t*)worker_totals)->p1;
+    ((totals_t*)totals)->p2 += ((const totals_t*)worker_totals)->p2;
+}
+
+int main(int argc, char** argv)
+{
+    knut_exit_if(argc != 2, "Wrong number of args\n");
+
+    context_t* context = (context_t*)malloc(sizeof(*context));
+    KNUT_ASSERT(context, "Failed to alloc context\n");
+    context->parse_first_part = true;
+
+    for (uint16_t i = 0; i < MAX_PAGE_NR; ++i)
+    {
+        knut_small_array_u16_init(&context->rules[i]);
+    }
+
+    const knut_pipeline_t pipeline = {
+        sizeof(update_t),
+        sizeof(totals_t),
+        parse_line,
+        solve_update,
+        reduce_totals,
+        context,
+        0
+    };
+    totals_t totals = { 0, 0 };
+
+    knut_exit_if(knut_pipeline_run(&pipeline, argv[1], &totals) != 0, "Unable to open file\n");
+
+    for (uint16_t i = 0; i < MAX_PAGE_NR; ++i)
+    {
+        knut_small_array_u16_destroy(&context->rules[i]);
     }
 
-    fclose(file);
+    free(context);
 
-    printf("Part one: %" PRIu32 "\n", middle_page_numbers_p1);
-    printf("Part two: %" PRIu32 "\n", middle_page_numbers_p2);
+    printf("Part one: %" PRIu32 "\n", totals.p1);
+    printf("Part two: %" PRIu32 "\n", totals.p2);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
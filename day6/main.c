@@ -4,9 +4,10 @@
 #include "../knut_ds.h"
 #define KNUT_IO_IMPLEMENTATION
 #include "../knut_io.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
 
 #include <inttypes.h>
-#include <math.h>
 
 static int64_t coordinate(int64_t x, int64_t y, int64_t width)
 {
@@ -88,8 +89,16 @@ int main(int argc, char** argv)
     knut_buffer_char_t buffer;
     KNUT_ASSERT(knut_io_read_binary(&buffer, argv[1]) != -1, "Failed to read file\n");
 
-    const int64_t width = strchr(buffer.ptr, '\n') - buffer.ptr + 1;
-    const int64_t height = (int64_t)ceill(buffer.size / (double)width);
+    knut_io_line_index_t lines;
+    KNUT_ASSERT(knut_io_index_lines(&lines, buffer.ptr, buffer.size,
+        knut_thread_hardware_concurrency(), knut_thread_run_all) == 0, 
+        "Failed to index lines\n");
+    knut_exit_if(knut_io_grid_width(&lines, buffer.ptr) < 0, "Lines differ in width\n");
+
+    /* Rows keep their line breaks, so the row stride is one past the line length */
+    const int64_t width = (int64_t)knut_io_line_length(&lines, 0) + 1;
+    const int64_t height = (int64_t)lines.num_lines;
+    knut_io_line_index_destroy(&lines);
 
     const knut_pair_i64_t start_pos = find_guard(buffer.ptr, width, height);
     const knut_pair_i8_t start_dir = { 0, -1 };
@@ -2,12 +2,36 @@
 #include "../knut.h"
 #define KNUT_DS_IMPLEMENTATION
 #include "../knut_ds.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#ifndef _WIN32
+#define KNUT_IO_URING_IMPLEMENTATION
+#include "../knut_io_uring.h"
+#endif
+#define KNUT_PIPELINE_IMPLEMENTATION
+#include "../knut_pipeline.h"
+#define KNUT_KNB_IMPLEMENTATION
+#include "../knut_knb.h"
 
 #include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
 
+KNUT_DEFINE_SMALL_ARRAY(uint64_t, u64, 16)
+
+typedef struct {
+    uint64_t target_sum;
+    knut_small_array_u64_t numbers;
+} equation_t;
+
+typedef struct {
+    uint64_t p1;
+    uint64_t p2;
+} totals_t;
+
 static uint64_t concat_numbers(uint64_t left, uint64_t right)
 {
     uint64_t num_digits = 0;
@@ -22,7 +46,7 @@ static uint64_t concat_numbers(uint64_t left, uint64_t right)
     return left * (uint64_t)powl(10, (double)num_digits) + right;
 }
 
-static bool valid_equation(const knut_array_u64_t* numbers, uint64_t number_index, 
+static bool valid_equation(const uint64_t* numbers, uint64_t num_numbers, uint64_t number_index,
     uint64_t target_sum, uint64_t current_sum, bool use_concat)
 {
     if (current_sum > target_sum)
@@ -30,64 +54,251 @@ static bool valid_equation(const knut_array_u64_t* numbers, uint64_t number_inde
         return false;
     }
 
-    if (knut_array_u64_size(numbers) == number_index)
+    if (num_numbers == number_index)
     {
         return current_sum == target_sum;
     }
 
-    const uint64_t current_number = knut_array_u64_at(numbers, number_index);
+    const uint64_t current_number = numbers[number_index];
     const uint64_t next_index = number_index + 1;
     return 
-        valid_equation(numbers, next_index, target_sum, current_number + current_sum, use_concat) ||
-        valid_equation(numbers, next_index, target_sum, current_number * current_sum, use_concat) ||
-        (use_concat && valid_equation(numbers, next_index, target_sum, 
+        valid_equation(numbers, num_numbers, next_index, target_sum, current_number + current_sum,
+            use_concat) ||
+        valid_equation(numbers, num_numbers, next_index, target_sum, current_number * current_sum,
+            use_concat) ||
+        (use_concat && valid_equation(numbers, num_numbers, next_index, target_sum, 
             concat_numbers(current_sum, current_number), use_concat));
 }
 
-int main(int argc, char** argv)
+static void add_equation(const uint64_t* numbers, uint64_t num_numbers, uint64_t target_sum,
+    totals_t* totals)
 {
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    if (num_numbers == 0)
+    {
+        return;
+    }
 
-    FILE* file = fopen(argv[1], "rb");
-    #define BUFFER_SIZE 1024
-    char buffer[BUFFER_SIZE] = {0};
+    if (valid_equation(numbers, num_numbers, 1, target_sum, numbers[0], false))
+    {
+        totals->p1 += target_sum;
+    }
 
-    knut_array_u64_t numbers = knut_array_u64_create(8);
-    uint64_t total_p1 = 0;
-    uint64_t total_p2 = 0;
+    if (valid_equation(numbers, num_numbers, 1, target_sum, numbers[0], true))
+    {
+        totals->p2 += target_sum;
+    }
+}
 
-    while (fgets(buffer, BUFFER_SIZE, file))
+/* The record owns its numbers until solve_equation destroys them */
+static bool parse_equation(void* ctx, char* line, uint64_t length, void* record)
+{
+    (void)ctx; (void)length;
+    char* colon = strchr(line, ':');
+
+    if (colon == NULL)
     {
-        const uint64_t target_sum = atoll(buffer);
+        return false;
+    }
 
-        const char* delim = " ";
-        char *next_token;
-        char *token = strtok_s(strchr(buffer, ':') + 1, delim, &next_token);
+    equation_t* equation = (equation_t*)record;
+    equation->target_sum = atoll(line);
+    knut_small_array_u64_init(&equation->numbers);
 
-        knut_array_u64_clear(&numbers);
+    const char* delim = " ";
+    char *next_token;
+    char *token = strtok_s(colon + 1, delim, &next_token);
 
-        while (token)
-        {
-            knut_array_u64_push(&numbers, atoll(token));
-            token = strtok_s(NULL, delim, &next_token);
-        }
+    while (token)
+    {
+        knut_small_array_u64_push(&equation->numbers, atoll(token));
+        token = strtok_s(NULL, delim, &next_token);
+    }
+
+    return true;
+}
 
-        if (valid_equation(&numbers, 1, target_sum, knut_array_u64_at(&numbers, 0), false))
+static void solve_equation(void* ctx, void* record, void* totals)
+{
+    (void)ctx;
+    equation_t* equation = (equation_t*)record;
+    add_equation(knut_small_array_u64_buffer(&equation->numbers),
+        knut_small_array_u64_size(&equation->numbers), equation->target_sum, (totals_t*)totals);
+    knut_small_array_u64_destroy(&equation->numbers);
+}
+
+static void reduce_totals(void* ctx, void* totals, const void* worker_totals)
+{
+    (void)ctx;
+    ((totals_t*)totals)->p1 += ((const totals_t*)worker_totals)->p1;
+    ((totals_t*)totals)->p2 += ((const totals_t*)worker_totals)->p2;
+}
+
+/* Columns of a day 7 .knb file */
+enum { KNB_TARGETS, KNB_ENDS, KNB_NUMBERS, KNB_NUM_COLUMNS };
+
+static int convert(const char* input_path, const char* output_path)
+{
+    knut_io_mapped_file_t file;
+    knut_exit_if(knut_io_map_file(&file, input_path) != 0, "Unable to open file\n");
+
+    /* parse_equation wants null terminated lines it can tokenize in place */
+    char* text = (char*)malloc(file.size + 1);
+    KNUT_ASSERT(text, "[convert] Failed to alloc text\n");
+    memcpy(text, file.ptr, file.size);
+    text[file.size] = '\0';
+
+    knut_array_u64_t targets = knut_array_u64_create_with(0, NULL);
+    knut_array_u64_t ends = knut_array_u64_create_with(0, NULL);
+    knut_array_u64_t numbers = knut_array_u64_create_with(0, NULL);
+    char* line = text;
+
+    while (line < text + file.size)
+    {
+        char* end = strchr(line, '\n');
+        end = end != NULL ? end : text + file.size;
+        *end = '\0';
+
+        equation_t equation;
+        if (parse_equation(NULL, line, (uint64_t)(end - line), &equation))
         {
-            total_p1 += target_sum;
+            knut_array_u64_push(&targets, equation.target_sum);
+            knut_array_u64_push_slice(&numbers, knut_small_array_u64_buffer(&equation.numbers),
+                knut_small_array_u64_size(&equation.numbers));
+            knut_array_u64_push(&ends, numbers.size);
+            knut_small_array_u64_destroy(&equation.numbers);
         }
 
-        if (valid_equation(&numbers, 1, target_sum, knut_array_u64_at(&numbers, 0), true))
+        line = end + 1;
+    }
+
+    const knut_knb_source_t columns[KNB_NUM_COLUMNS] = {
+        { KNUT_KNB_TYPE_U64, targets.buffer, targets.size },
+        { KNUT_KNB_TYPE_U64, ends.buffer, ends.size },
+        { KNUT_KNB_TYPE_U64, numbers.buffer, numbers.size }
+    };
+    const int result = knut_knb_write(output_path, 7, columns, KNB_NUM_COLUMNS);
+
+    knut_array_u64_destroy(&numbers);
+    knut_array_u64_destroy(&ends);
+    knut_array_u64_destroy(&targets);
+    free(text);
+    knut_io_unmap_file(&file);
+
+    return result;
+}
+
+typedef struct {
+    knut_array_u64_data_t targets;
+    knut_array_u64_data_t ends;
+    knut_array_u64_data_t numbers;
+    uint32_t index;
+    uint32_t num_workers;
+    totals_t totals;
+} knb_worker_t;
+
+static void knb_worker(void* arg)
+{
+    knb_worker_t* worker = (knb_worker_t*)arg;
+
+    for (uint64_t i = worker->index; i < worker->targets.size; i += worker->num_workers)
+    {
+        const uint64_t start = i > 0 ? worker->ends.buffer[i - 1] : 0;
+        add_equation(worker->numbers.buffer + start, worker->ends.buffer[i] - start,
+            worker->targets.buffer[i], &worker->totals);
+    }
+}
+
+/* Equations are interleaved across the workers, their cost varies a lot with the operand count */
+static int run_knb(const char* path, totals_t* totals)
+{
+    knut_knb_t knb;
+
+    if (knut_knb_open(&knb, path, 7, KNB_NUM_COLUMNS) != 0)
+    {
+        return -1;
+    }
+
+    const knut_array_u64_data_t targets = knut_knb_u64(&knb, KNB_TARGETS);
+    const knut_array_u64_data_t ends = knut_knb_u64(&knb, KNB_ENDS);
+    const knut_array_u64_data_t numbers = knut_knb_u64(&knb, KNB_NUMBERS);
+
+    for (uint64_t i = 0; i < ends.size; ++i)
+    {
+        if (ends.buffer[i] > numbers.size || (i > 0 && ends.buffer[i] < ends.buffer[i - 1]))
         {
-            total_p2 += target_sum;
+            knut_knb_close(&knb);
+            return -1;
         }
     }
 
-    printf("Part one: %" PRIu64 "\n", total_p1);
-    printf("Part two: %" PRIu64 "\n", total_p2);
+    if (targets.size != ends.size)
+    {
+        knut_knb_close(&knb);
+        return -1;
+    }
 
-    knut_array_u64_destroy(&numbers);
-    fclose(file);
+    uint32_t num_workers = knut_thread_hardware_concurrency();
+    num_workers = num_workers > targets.size ? (uint32_t)targets.size : num_workers;
+    num_workers = num_workers > 0 ? num_workers : 1;
+
+    knb_worker_t* workers = (knb_worker_t*)calloc(num_workers, sizeof(*workers));
+    knut_function_t* tasks = (knut_function_t*)calloc(num_workers, sizeof(*tasks));
+    KNUT_ASSERT(workers && tasks, "[run_knb] Failed to alloc workers\n");
+
+    for (uint32_t t = 0; t < num_workers; ++t)
+    {
+        workers[t] = (knb_worker_t){ targets, ends, numbers, t, num_workers, { 0, 0 } };
+        tasks[t] = (knut_function_t){ knb_worker, &workers[t] };
+    }
+
+    knut_thread_run_all(tasks, num_workers);
+
+    for (uint32_t t = 0; t < num_workers; ++t)
+    {
+        reduce_totals(NULL, totals, &workers[t].totals);
+    }
+
+    free(tasks);
+    free(workers);
+    knut_knb_close(&knb);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc == 4 && strcmp(argv[1], "-knb") == 0)
+    {
+        knut_exit_if(convert(argv[2], argv[3]) != 0, "Unable to write file\n");
+        return EXIT_SUCCESS;
+    }
+
+    knut_exit_if(argc != 2, "Usage: day7 input\n       day7 -knb input output.knb\n");
+
+    totals_t totals = { 0, 0 };
+
+    if (knut_knb_is_path(argv[1]))
+    {
+        knut_exit_if(run_knb(argv[1], &totals) != 0, "Invalid knb file\n");
+    }
+    else
+    {
+        const knut_pipeline_t pipeline = {
+            sizeof(equation_t),
+            sizeof(totals_t),
+            parse_equation,
+            solve_equation,
+            reduce_totals,
+            NULL,
+            0
+        };
+
+        knut_exit_if(knut_pipeline_run(&pipeline, argv[1], &totals) != 0,
+            "Unable to open file\n");
+    }
+
+    printf("Part one: %" PRIu64 "\n", totals.p1);
+    printf("Part two: %" PRIu64 "\n", totals.p2);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -9,24 +9,6 @@
 
 KNUT_DEFINE_ARRAY(knut_pair_i64_t, pair_i64)
 
-static uint64_t remove_char(knut_buffer_char_t* buffer, char to_remove)
-{
-    uint64_t j = 0;
-
-    for (uint64_t i = 0; i < buffer->size; ++i)
-    {
-        if (buffer->ptr[i] != to_remove)
-        {
-            buffer->ptr[j++] = buffer->ptr[i];
-        }
-    }
-
-    const uint64_t removed = buffer->size - j;
-    buffer->size = j;
-
-    return removed;
-}
-
 static int64_t coordinate(int64_t x, int64_t y, int64_t width)
 {
     return y * width + x;
@@ -66,13 +48,14 @@ int main(int argc, char** argv)
     knut_exit_if(argc != 2, "Wrong number of args\n");
 
     knut_buffer_char_t buffer_p1;
-    knut_io_read_binary(&buffer_p1, argv[1]);
-
-    const char* newline = strchr(buffer_p1.ptr, '\n');
-    KNUT_ASSERT(newline, "Expected newline\n");
-
-    const int64_t width = (int64_t)(newline - buffer_p1.ptr);
-    const int64_t height = (int64_t)(remove_char(&buffer_p1, '\n') + 1);
+    uint64_t grid_width;
+    uint64_t grid_height;
+    const int result = knut_io_read_grid(&buffer_p1, &grid_width, &grid_height, argv[1]);
+    knut_exit_if(result == -1, "Unable to read file\n");
+    knut_exit_if(result == -2, "Lines differ in width\n");
+
+    const int64_t width = (int64_t)grid_width;
+    const int64_t height = (int64_t)grid_height;
     const knut_pair_i64_t grid_size = { width, height };
 
     knut_buffer_char_t buffer_p2 = copy_buffer(&buffer_p1);
@@ -4,241 +4,117 @@
 #include "../knut_ds.h"
 #define KNUT_IO_IMPLEMENTATION
 #include "../knut_io.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_CACHE_IMPLEMENTATION
+#include "../knut_cache.h"
+#define KNUT_KNB_IMPLEMENTATION
+#include "../knut_knb.h"
 
-#include <inttypes.h>
-
-static bool done(const knut_pair_i64_t* iterators)
-{
-    return iterators->first == iterators->second;
-}
-
-static void update_iterators(const knut_array_i64_t* blocks, knut_pair_i64_t* iterators)
-{
-    while (iterators->first < iterators->second && 
-        knut_array_i64_at(blocks, iterators->first) != -1)
-    {
-        ++iterators->first;
-    }
+#include "solve.h"
 
-    while (iterators->first < iterators->second && 
-        knut_array_i64_at(blocks, iterators->second) == -1)
-    {
-        --iterators->second;
-    }
-}
+#include <inttypes.h>
 
-static knut_pair_i64_t find_iterators(const knut_array_i64_t* blocks)
+/* Stores the run lengths of the disk map, the expanded blocks would take 8 bytes each */
+static int convert(const char* input_path, const char* output_path)
 {
-    knut_pair_i64_t iterators = {
-        0, 
-        knut_array_i64_size(blocks) - 1
-    };
+    knut_io_mapped_file_t file;
+    knut_exit_if(knut_io_map_file(&file, input_path) != 0, "Unable to open file\n");
 
-    update_iterators(blocks, &iterators);
+    uint64_t size = file.size;
+    while (size > 0 && (file.ptr[size - 1] == '\n' || file.ptr[size - 1] == '\r')) { --size; }
+    knut_exit_if(size == 0, "Empty disk map\n");
 
-    return iterators;
-}
+    knut_array_u8_t lengths = knut_array_u8_create_with(size, NULL);
 
-static void swap_and_step(const knut_array_i64_t* blocks, knut_pair_i64_t* iterators)
-{
-    knut_array_i64_set(blocks, iterators->first, knut_array_i64_at(blocks, iterators->second));
-    knut_array_i64_set(blocks, iterators->second, -1);
-    ++iterators->first;
-    --iterators->second;
-}
-
-static knut_pair_i64_t find_next_empty(const knut_array_i64_t* blocks, uint64_t start)
-{
-    const uint64_t size = knut_array_i64_size(blocks);
-    int64_t empty_start = -1;
-    
-    for (uint64_t i = start; i < size; ++i)
+    for (uint64_t i = 0; i < size; ++i)
     {
-        if (knut_array_i64_at(blocks, i) == -1)
-        {
-            empty_start = i;
-            break;
-        }
+        const uint8_t length = (uint8_t)(file.ptr[i] - '0');
+        knut_exit_if(length > 9, "Invalid disk map\n");
+        knut_array_u8_push(&lengths, length);
     }
 
-    if (empty_start == -1)
-    {
-        return (knut_pair_i64_t){ -1, -1 };
-    }
-
-    uint64_t empty_end = empty_start;
+    const knut_knb_source_t column = { KNUT_KNB_TYPE_U8, lengths.buffer, lengths.size };
+    const int result = knut_knb_write(output_path, 9, &column, 1);
 
-    while (empty_end < size && knut_array_i64_at(blocks, empty_end) == -1)
-    {
-        ++empty_end;
-    }
+    knut_array_u8_destroy(&lengths);
+    knut_io_unmap_file(&file);
 
-    return (knut_pair_i64_t){ empty_start, empty_end - empty_start };
+    return result;
 }
 
-static knut_pair_i64_t find_last_block(const knut_array_i64_t* blocks, int64_t block_end, 
-    int64_t find_less_than)
+int main(int argc, char** argv)
 {
-    KNUT_ASSERT(block_end >= 0, "[find_last_block] Can't start on negative position\n");
-    #define CURRENT(i) knut_array_i64_at(blocks, i)
-
-    while (block_end >= 0 && (CURRENT(block_end) == -1 || CURRENT(block_end) >= find_less_than))
-    {
-        --block_end;
-    }
-
-    if (block_end == -1)
-    {
-        return (knut_pair_i64_t){ -1, -1 };
-    }
-
-    const int64_t block_nr = knut_array_i64_at(blocks, block_end);
-    int64_t block_start = block_end;
-
-    while (block_start > 0 && knut_array_i64_at(blocks, block_start) == block_nr)
+    if (argc == 4 && strcmp(argv[1], "-knb") == 0)
     {
-        --block_start;
+        knut_exit_if(convert(argv[2], argv[3]) != 0, "Unable to write file\n");
+        return EXIT_SUCCESS;
     }
 
-    if (block_start != 0) { ++block_start; }
-
-    return (knut_pair_i64_t){ block_start, block_end + 1 - block_start };
-}
-
-static knut_pair_i64_t find_free_memory(const knut_array_i64_t* blocks, int64_t start,
-    knut_pair_i64_t block)
-{
-    knut_pair_i64_t free_memory;
-
-    do
-    {
-        free_memory = find_next_empty(blocks, start);
-        start += free_memory.second;
-    } while (free_memory.first != -1 && free_memory.first < block.first && 
-        free_memory.second < block.second);
-
-    if (free_memory.first >= block.first)
-    {
-        return (knut_pair_i64_t){ -1, -1 };
-    }
-    
-    return free_memory;
-}
+    knut_exit_if(argc != 2 && (argc != 3 || strcmp(argv[2], "-nocache") != 0),
+        "Usage: day9 input [-nocache]\n       day9 -knb input output.knb\n");
 
-static int64_t swap_and_step_block(const knut_array_i64_t* blocks, knut_pair_i64_t free_slot, 
-    knut_pair_i64_t block)
-{
-    KNUT_ASSERT(block.second <= free_slot.second, 
-        "[swap_and_step_block] Free slot must be larger than block size\n");
-    knut_pair_i64_t iterators = {free_slot.first, block.first + block.second - 1};
+    /* A .knb input holds the lengths of the disk map without its text */
+    const bool binary = knut_knb_is_path(argv[1]);
+    knut_knb_t knb;
+    knut_io_mapped_file_t file;
 
-    for (uint64_t i = 0; i < (uint64_t)block.second; ++i)
+    if (binary)
     {
-        swap_and_step(blocks, &iterators);
+        knut_exit_if(knut_knb_open(&knb, argv[1], 9, 1) != 0 ||
+            knb.columns[0].type != KNUT_KNB_TYPE_U8, "Invalid knb file\n");
+        file = knb.file;
     }
-
-    return iterators.second;
-}
-
-static void part_one(knut_array_i64_t* blocks)
-{
-    knut_pair_i64_t iterators = find_iterators(blocks);
-
-    while (!done(&iterators))
+    else
     {
-        swap_and_step(blocks, &iterators);
-        update_iterators(blocks, &iterators);
+        knut_exit_if(knut_io_map_file(&file, argv[1]) != 0, "Unable to open file\n");
     }
 
-    const int64_t packed_size = find_iterators(blocks).first;
-    uint64_t checksum = 0;
+    knut_cache_t cache;
+    knut_cache_open(&cache, argc == 3);
+    const knut_cache_key_t key = knut_cache_key(&cache, 9, file.ptr, file.size);
+    int64_t parts[2];
 
-    for (uint64_t i = 0; i < (uint64_t)packed_size; ++i)
+    if (!knut_cache_lookup(&cache, &key, parts, 2))
     {
-        checksum += i * knut_array_i64_at(blocks, i);
-    }
+        knut_arena_t scratch;
+        knut_arena_init(&scratch, 1024 * 1024);
 
-    printf("Part one: %" PRIu64 "\n", checksum);
-}
+        knut_answer_t answer;
 
-static void part_two(knut_array_i64_t* blocks)
-{
-    int64_t left_ptr = 0;
-    const uint64_t p2_size = knut_array_i64_size(blocks);
-    int64_t right_ptr = p2_size - 1;
-    int64_t current_id = INT64_MAX;
-
-    while (left_ptr < right_ptr)
-    {
-        knut_pair_i64_t leftmost_empty = find_next_empty(blocks, left_ptr);
-        knut_pair_i64_t rightmost_block = find_last_block(blocks, right_ptr, current_id);
-        const int64_t current = knut_array_i64_at(blocks, rightmost_block.first);
-
-        current_id = current;
-        knut_pair_i64_t free_slot = find_free_memory(blocks, leftmost_empty.first, 
-            rightmost_block);
-        
-        left_ptr = leftmost_empty.first;
-        right_ptr = rightmost_block.first;
-        
-        if (free_slot.first != -1)
+        if (binary)
         {
-            right_ptr = swap_and_step_block(blocks, free_slot, rightmost_block);
+            const knut_array_u8_data_t lengths = knut_knb_u8(&knb, 0);
+            const knut_allocator_t allocator = knut_allocator_arena(&scratch, NULL);
+            knut_array_i64_t blocks;
+            knut_exit_if(day9_expand(lengths.buffer, lengths.size, 0, &allocator, &blocks) != 0 ||
+                day9_solve_blocks(&blocks, &scratch, &answer) != 0, "Empty disk map\n");
         }
         else
         {
-            --right_ptr;
+            knut_exit_if(day9_solve(file.ptr, file.size, &scratch, &answer) != 0,
+                "Empty disk map\n");
         }
-    }
-
-    const int64_t packed_size = find_iterators(blocks).second + 1;
-    uint64_t checksum = 0;
 
-    for (uint64_t i = 0; i < (uint64_t)packed_size; ++i)
-    {
-        const int64_t current = knut_array_i64_at(blocks, i);
-        checksum += i * (current != -1 ? current : 0);
+        knut_arena_destroy(&scratch);
+        parts[0] = answer.part_one;
+        parts[1] = answer.part_two;
+        knut_cache_store(&cache, &key, parts, 2);
     }
 
-    printf("Part two: %" PRIu64 "\n", checksum);
-}
-
-int main(int argc, char** argv)
-{
-    knut_exit_if(argc != 2, "Wrong number of args\n");
+    printf("Part one: %" PRIu64 "\n", (uint64_t)parts[0]);
+    printf("Part two: %" PRIu64 "\n", (uint64_t)parts[1]);
 
-    knut_buffer_char_t buffer;
-    knut_io_read_binary(&buffer, argv[1]);
+    knut_cache_close(&cache);
 
-    knut_array_i64_t blocks_p1 = knut_array_i64_create(buffer.size);
-
-    uint64_t file_id = 0;
-
-    for (uint64_t i = 0; i < buffer.size; i += 2)
+    if (binary)
     {
-        int8_t files = buffer.ptr[i] - '0';
-        int8_t free_space  = i < buffer.size - 1 ? buffer.ptr[i + 1] - '0' : -1;
-
-        for (uint64_t j = 0; j < files; ++j)
-        {
-            knut_array_i64_push(&blocks_p1, file_id);
-        }
-        for (int64_t j = 0; j < free_space; ++j)
-        {
-            knut_array_i64_push(&blocks_p1, -1);
-        }
-
-        ++file_id;
+        knut_knb_close(&knb);
+    }
+    else
+    {
+        knut_io_unmap_file(&file);
     }
-
-    knut_array_i64_t blocks_p2 = knut_array_i64_copy(&blocks_p1);
-
-    part_one(&blocks_p1);
-    part_two(&blocks_p2);
-
-    knut_array_i64_destroy(&blocks_p2);
-    knut_array_i64_destroy(&blocks_p1);
-    knut_buffer_char_destroy(&buffer);
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
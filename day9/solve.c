@@ -0,0 +1,238 @@
+#include "solve.h"
+
+static bool done(const knut_pair_i64_t* iterators)
+{
+    return iterators->first >= iterators->second;
+}
+
+static void update_iterators(const knut_array_i64_t* blocks, knut_pair_i64_t* iterators)
+{
+    while (iterators->first < iterators->second && 
+        knut_array_i64_at(blocks, iterators->first) != -1)
+    {
+        ++iterators->first;
+    }
+
+    while (iterators->first < iterators->second && 
+        knut_array_i64_at(blocks, iterators->second) == -1)
+    {
+        --iterators->second;
+    }
+}
+
+static knut_pair_i64_t find_iterators(const knut_array_i64_t* blocks)
+{
+    knut_pair_i64_t iterators = {
+        0, 
+        knut_array_i64_size(blocks) - 1
+    };
+
+    update_iterators(blocks, &iterators);
+
+    return iterators;
+}
+
+static void swap_and_step(const knut_array_i64_t* blocks, knut_pair_i64_t* iterators)
+{
+    knut_array_i64_set(blocks, iterators->first, knut_array_i64_at(blocks, iterators->second));
+    knut_array_i64_set(blocks, iterators->second, -1);
+    ++iterators->first;
+    --iterators->second;
+}
+
+static uint64_t part_one(knut_array_i64_t* blocks)
+{
+    knut_pair_i64_t iterators = find_iterators(blocks);
+
+    while (!done(&iterators))
+    {
+        swap_and_step(blocks, &iterators);
+        update_iterators(blocks, &iterators);
+    }
+
+    const int64_t packed_size = find_iterators(blocks).first;
+    const uint64_t checksum = 
+        (uint64_t)knut_reduce_i64_dot_index(blocks->buffer, (uint64_t)packed_size, 0);
+
+    return checksum;
+}
+
+/* Free spans are kept in one min-heap of start positions per span length, so the leftmost span
+ * that fits a file is the smallest top among the heaps for lengths >= file length. Files are at
+ * most 9 blocks long, so the last heap holds every span of 9 or more blocks. */
+static uint64_t part_two(knut_array_i64_t* blocks)
+{
+    const uint64_t size = knut_array_i64_size(blocks);
+    knut_array_u64_t spans_by_length[10] = { 0 };
+    uint64_t max_length = 0;
+
+    for (uint64_t i = 0; i < size;)
+    {
+        uint64_t end = i;
+        while (end < size && blocks->buffer[end] == -1) { ++end; }
+
+        if (end > i)
+        {
+            const uint64_t length = end - i < 9 ? end - i : 9;
+            knut_array_u64_push(&spans_by_length[length], i);
+            max_length = length > max_length ? length : max_length;
+            i = end;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    knut_heap_u64_min_t free_spans[10];
+
+    for (uint64_t length = 0; length < 10; ++length)
+    {
+        free_spans[length] = knut_heap_u64_min_heapify(spans_by_length[length].buffer, 
+            spans_by_length[length].size);
+        knut_array_u64_destroy(&spans_by_length[length]);
+    }
+
+    uint64_t file_end = size;
+
+    while (file_end > 0)
+    {
+        const int64_t file_id = blocks->buffer[file_end - 1];
+
+        if (file_id == -1)
+        {
+            --file_end;
+            continue;
+        }
+
+        uint64_t file_start = file_end - 1;
+        while (file_start > 0 && blocks->buffer[file_start - 1] == file_id) { --file_start; }
+
+        const uint64_t file_length = file_end - file_start;
+        uint64_t best_length = 0;
+        uint64_t best_start = file_start;
+
+        for (uint64_t length = file_length; length <= max_length; ++length)
+        {
+            if (!knut_heap_u64_min_is_empty(&free_spans[length]) && 
+                knut_heap_u64_min_top(&free_spans[length]) < best_start)
+            {
+                best_start = knut_heap_u64_min_top(&free_spans[length]);
+                best_length = length;
+            }
+        }
+
+        if (best_length > 0)
+        {
+            knut_heap_u64_min_pop(&free_spans[best_length]);
+
+            /* Zero length files merge free spans, those longer than 9 are measured again */
+            uint64_t span_end = best_start + best_length;
+            while (best_length == 9 && span_end < size && blocks->buffer[span_end] == -1)
+            {
+                ++span_end;
+            }
+
+            for (uint64_t i = 0; i < file_length; ++i)
+            {
+                blocks->buffer[best_start + i] = file_id;
+                blocks->buffer[file_start + i] = -1;
+            }
+
+            const uint64_t rest = span_end - best_start - file_length;
+
+            if (rest > 0)
+            {
+                knut_heap_u64_min_push(&free_spans[rest < 9 ? rest : 9], 
+                    best_start + file_length);
+            }
+        }
+
+        file_end = file_start;
+    }
+
+    /* Free blocks don't count towards the checksum */
+    for (uint64_t i = 0; i < size; ++i)
+    {
+        blocks->buffer[i] = blocks->buffer[i] != -1 ? blocks->buffer[i] : 0;
+    }
+
+    const uint64_t checksum = (uint64_t)knut_array_i64_reduce_dot_index(blocks, 0);
+
+    for (uint64_t length = 0; length < 10; ++length)
+    {
+        knut_heap_u64_min_destroy(&free_spans[length]);
+    }
+
+    return checksum;
+}
+
+int day9_expand(const uint8_t* lengths, uint64_t num_lengths, uint8_t zero,
+    const knut_allocator_t* allocator, knut_array_i64_t* blocks)
+{
+    uint64_t num_blocks = 0;
+
+    for (uint64_t i = 0; i < num_lengths; ++i)
+    {
+        const uint8_t length = (uint8_t)(lengths[i] - zero);
+
+        if (length > 9)
+        {
+            return -1;
+        }
+
+        num_blocks += length;
+    }
+
+    *blocks = knut_array_i64_create_with(num_blocks, allocator);
+
+    for (uint64_t i = 0; i < num_lengths; ++i)
+    {
+        const int64_t id = i % 2 == 0 ? (int64_t)(i / 2) : -1;
+
+        for (uint8_t j = 0; j < (uint8_t)(lengths[i] - zero); ++j)
+        {
+            knut_array_i64_push(blocks, id);
+        }
+    }
+
+    return blocks->size > 0 ? 0 : -1;
+}
+
+int day9_parse(const char* input, uint64_t size, const knut_allocator_t* allocator,
+    knut_array_i64_t* blocks)
+{
+    while (size > 0 && (input[size - 1] == '\n' || input[size - 1] == '\r')) { --size; }
+
+    return day9_expand((const uint8_t*)input, size, '0', allocator, blocks);
+}
+
+int day9_solve_blocks(knut_array_i64_t* blocks, knut_arena_t* scratch, knut_answer_t* answer)
+{
+    if (blocks->size == 0)
+    {
+        return -1;
+    }
+
+    const knut_allocator_t allocator = knut_allocator_arena(scratch, NULL);
+    knut_array_i64_t blocks_p1 = knut_array_i64_create_with(blocks->size, &allocator);
+    knut_array_i64_push_slice(&blocks_p1, blocks->buffer, blocks->size);
+
+    answer->part_one = (int64_t)part_one(&blocks_p1);
+    answer->part_two = (int64_t)part_two(blocks);
+
+    return 0;
+}
+
+int day9_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer)
+{
+    const knut_allocator_t allocator = knut_allocator_arena(scratch, NULL);
+    knut_array_i64_t blocks;
+
+    if (day9_parse(input, size, &allocator, &blocks) != 0)
+    {
+        return -1;
+    }
+
+    return day9_solve_blocks(&blocks, scratch, answer);
+}
@@ -0,0 +1,18 @@
+#ifndef DAY9_SOLVE_H
+#define DAY9_SOLVE_H
+
+#include "../knut_solve.h"
+
+/* Expands alternating file and free space lengths into one entry per block, -1 for free
+ * blocks. 'zero' is the value that stands for a length of 0, '0' for the text disk map.
+ * Returns -1 for lengths above 9 or if there are no blocks. */
+int day9_expand(const uint8_t* lengths, uint64_t num_lengths, uint8_t zero,
+    const knut_allocator_t* allocator, knut_array_i64_t* blocks);
+/* Expands the text disk map, anything but digits and trailing line breaks is rejected */
+int day9_parse(const char* input, uint64_t size, const knut_allocator_t* allocator,
+    knut_array_i64_t* blocks);
+/* Compacts a scratch copy for part one and 'blocks' itself for part two */
+int day9_solve_blocks(knut_array_i64_t* blocks, knut_arena_t* scratch, knut_answer_t* answer);
+int day9_solve(const char* input, uint64_t size, knut_arena_t* scratch, knut_answer_t* answer);
+
+#endif // DAY9_SOLVE_H
@@ -11,8 +11,17 @@ extern "C" {
 #include <stdio.h>
 #include <string.h>
 
+#include "knut_cpu.h"
+
 uint16_t knut_swap_u16(uint16_t val);
 uint32_t knut_swap_u32(uint32_t val);
+uint64_t knut_swap_u64(uint64_t val);
+
+/* Reverses the byte order of every value in place, on the instruction set picked by
+ * knut_cpu_isa */
+void knut_swap_u16_buffer(uint16_t* values, uint64_t size);
+void knut_swap_u32_buffer(uint32_t* values, uint64_t size);
+void knut_swap_u64_buffer(uint64_t* values, uint64_t size);
 
 void knut_exit_if(bool condition, const char* msg);
 
@@ -33,6 +42,10 @@ char* knut_strndup(const char* str, uint64_t size);
 
 int64_t knut_clamp_i64(int64_t value, int64_t min, int64_t max);
 
+uint64_t knut_popcount_u64(uint64_t value);
+uint64_t knut_next_pow2_u64(uint64_t value);
+uint64_t knut_ctz_u64(uint64_t value);
+
 #define KNUT_DEFINE_PAIR(TYPE, TYPE_NAME) \
     typedef struct { \
         TYPE first; \
@@ -82,23 +95,131 @@ KNUT_DEFINE_BUFFER(char, char)
 #if defined(KNUT_IMPLEMENTATION) && !defined(KNUT_IMPLEMENTATION_DONE)
 #define KNUT_IMPLEMENTATION_DONE
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef KNUT_ARCH_X86
+#include <immintrin.h>
+#endif
+
+#ifndef KNUT_CPU_IMPLEMENTATION_DONE
+#define KNUT_CPU_IMPLEMENTATION
+#endif
+#include "knut_cpu.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 uint16_t knut_swap_u16(uint16_t val)
 {
-    return val >> 8 | ((val & 0xFF) << 8);
+#ifdef _MSC_VER
+    return _byteswap_ushort(val);
+#else
+    return __builtin_bswap16(val);
+#endif
 }
 
 uint32_t knut_swap_u32(uint32_t val)
 {
-    return val >> 24                |
-        ((val & 0x00FF0000) >> 8)   |
-        ((val & 0x0000FF00) << 8)   |
-        ((val & 0xFF) << 24);
+#ifdef _MSC_VER
+    return _byteswap_ulong(val);
+#else
+    return __builtin_bswap32(val);
+#endif
+}
+
+uint64_t knut_swap_u64(uint64_t val)
+{
+#ifdef _MSC_VER
+    return _byteswap_uint64(val);
+#else
+    return __builtin_bswap64(val);
+#endif
 }
 
+#define KNUT_DEFINE_SWAP_SCALAR(BITS) \
+static void knut_swap_u##BITS##_buffer_scalar(uint##BITS##_t* values, uint64_t size) \
+{ \
+    for (uint64_t i = 0; i < size; ++i) { values[i] = knut_swap_u##BITS(values[i]); } \
+} \
+
+KNUT_DEFINE_SWAP_SCALAR(16)
+KNUT_DEFINE_SWAP_SCALAR(32)
+KNUT_DEFINE_SWAP_SCALAR(64)
+
+#ifdef KNUT_ARCH_X86
+
+/* pshufb masks that reverse the bytes inside every 2, 4 or 8 byte lane of 16 bytes */
+#define KNUT_SWAP_MASK_16 14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+#define KNUT_SWAP_MASK_32 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+#define KNUT_SWAP_MASK_64 8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7
+
+/* _mm_set_epi8 takes the bytes from the highest one down */
+#define KNUT_DEFINE_SWAP_VECTOR(BITS) \
+KNUT_TARGET_SSE42 static void knut_swap_u##BITS##_buffer_sse42(uint##BITS##_t* values, \
+    uint64_t size) \
+{ \
+    const __m128i mask = _mm_set_epi8(KNUT_SWAP_MASK_##BITS); \
+    const uint64_t lanes = 128 / BITS; \
+    uint64_t i = 0; \
+    for (; i + lanes <= size; i += lanes) \
+    { \
+        __m128i* block = (__m128i*)(values + i); \
+        _mm_storeu_si128(block, _mm_shuffle_epi8(_mm_loadu_si128(block), mask)); \
+    } \
+    knut_swap_u##BITS##_buffer_scalar(values + i, size - i); \
+} \
+\
+KNUT_TARGET_AVX2 static void knut_swap_u##BITS##_buffer_avx2(uint##BITS##_t* values, \
+    uint64_t size) \
+{ \
+    const __m256i mask = _mm256_broadcastsi128_si256(_mm_set_epi8(KNUT_SWAP_MASK_##BITS)); \
+    const uint64_t lanes = 256 / BITS; \
+    uint64_t i = 0; \
+    for (; i + 2 * lanes <= size; i += 2 * lanes) \
+    { \
+        __m256i* block = (__m256i*)(values + i); \
+        const __m256i first = _mm256_loadu_si256(block); \
+        const __m256i second = _mm256_loadu_si256(block + 1); \
+        _mm256_storeu_si256(block, _mm256_shuffle_epi8(first, mask)); \
+        _mm256_storeu_si256(block + 1, _mm256_shuffle_epi8(second, mask)); \
+    } \
+    knut_swap_u##BITS##_buffer_sse42(values + i, size - i); \
+} \
+\
+KNUT_TARGET_AVX512 static void knut_swap_u##BITS##_buffer_avx512(uint##BITS##_t* values, \
+    uint64_t size) \
+{ \
+    const __m512i mask = _mm512_broadcast_i32x4(_mm_set_epi8(KNUT_SWAP_MASK_##BITS)); \
+    const uint64_t lanes = 512 / BITS; \
+    uint64_t i = 0; \
+    for (; i + lanes <= size; i += lanes) \
+    { \
+        __m512i* block = (__m512i*)(values + i); \
+        _mm512_storeu_si512(block, _mm512_shuffle_epi8(_mm512_loadu_si512(block), mask)); \
+    } \
+    knut_swap_u##BITS##_buffer_avx2(values + i, size - i); \
+} \
+
+KNUT_DEFINE_SWAP_VECTOR(16)
+KNUT_DEFINE_SWAP_VECTOR(32)
+KNUT_DEFINE_SWAP_VECTOR(64)
+
+#endif // ifdef KNUT_ARCH_X86
+
+#define KNUT_SWAP_DISPATCH(BITS) \
+    KNUT_CPU_DEFINE_DISPATCH(void, knut_swap_u##BITS##_buffer, \
+        (uint##BITS##_t* values, uint64_t size), (values, size), \
+        knut_swap_u##BITS##_buffer_scalar, KNUT_CPU_X86(knut_swap_u##BITS##_buffer_sse42), \
+        KNUT_CPU_X86(knut_swap_u##BITS##_buffer_avx2), \
+        KNUT_CPU_X86(knut_swap_u##BITS##_buffer_avx512))
+
+KNUT_SWAP_DISPATCH(16)
+KNUT_SWAP_DISPATCH(32)
+KNUT_SWAP_DISPATCH(64)
+
 void knut_exit_if(bool condition, const char* msg)
 {
     if (condition)
@@ -124,7 +245,7 @@ char* knut_strndup(const char* str, uint64_t size)
 {
     char* dup_str = (char*)calloc(size + 1, sizeof(*str));
     knut_exit_if(dup_str == NULL, "[knut_strndup] calloc failed\n");
-    strncpy_s(dup_str, size + 1, str, size);
+    memcpy(dup_str, str, strnlen(str, size));
     return dup_str;
 }
 
@@ -135,6 +256,43 @@ int64_t knut_clamp_i64(int64_t value, int64_t min, int64_t max)
     return value;
 }
 
+uint64_t knut_popcount_u64(uint64_t value)
+{
+#ifdef _MSC_VER
+    return __popcnt64(value);
+#else
+    return (uint64_t)__builtin_popcountll(value);
+#endif
+}
+
+uint64_t knut_next_pow2_u64(uint64_t value)
+{
+    KNUT_ASSERT(value <= (UINT64_MAX / 2) + 1, "[knut_next_pow2_u64] Value overflow\n");
+
+    if (value <= 1) { return 1; }
+
+    --value;
+    value |= value >> 1;
+    value |= value >> 2;
+    value |= value >> 4;
+    value |= value >> 8;
+    value |= value >> 16;
+    value |= value >> 32;
+    return value + 1;
+}
+
+/* Value must not be 0 */
+uint64_t knut_ctz_u64(uint64_t value)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return (uint64_t)__builtin_ctzll(value);
+#endif
+}
+
 knut_pair_u32_t knut_parse_pair_u32(const char* input, int base)
 {
     knut_pair_u32_t pair;
@@ -0,0 +1,576 @@
+#ifndef KNUT_CACHE_INCLUDE_H
+#define KNUT_CACHE_INCLUDE_H
+
+#include "knut.h"
+#include "knut_io.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* 128 bit xxh3 style hash, not meant to resist attacks */
+typedef struct {
+    uint64_t low;
+    uint64_t high;
+} knut_cache_hash_t;
+
+/* Runs on the instruction set picked by knut_cpu_isa, every ISA gives the same hash */
+knut_cache_hash_t knut_cache_hash(const char* data, uint64_t size);
+
+#define KNUT_CACHE_VERSION 1
+#define KNUT_CACHE_WAYS 8
+#define KNUT_CACHE_DEFAULT_SETS 512
+#define KNUT_CACHE_DEFAULT_PATH ".knut_cache"
+
+/* On disk in host byte order, the file is a header followed by num_sets * KNUT_CACHE_WAYS
+ * entries. 'check' covers the other fields except 'last_used', so empty entries and entries
+ * torn by two processes writing at once never match. */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sets;
+    uint64_t clock;
+    uint64_t reserved[5];
+} knut_cache_header_t;
+
+typedef struct {
+    knut_cache_hash_t input;
+    uint64_t input_size;
+    uint64_t build_id;
+    uint32_t day;
+    uint32_t part;
+    int64_t value;
+    uint64_t last_used;
+    uint64_t check;
+} knut_cache_entry_t;
+
+typedef struct {
+    knut_cache_hash_t input;
+    uint64_t input_size;
+    uint64_t build_id;
+    uint32_t day;
+} knut_cache_key_t;
+
+/* Answers of past runs in a mapped file, each set of KNUT_CACHE_WAYS entries evicts its least
+ * recently used one. A bypassed cache never hashes, finds or stores anything. */
+typedef struct {
+    knut_io_mapped_file_t file;
+    knut_cache_header_t* header;
+    knut_cache_entry_t* entries;
+    uint64_t build_id;
+    bool bypass;
+} knut_cache_t;
+
+/* Uses the file named by the KNUT_CACHE_PATH environment variable or KNUT_CACHE_DEFAULT_PATH,
+ * a cache that can't be opened is bypassed. Files with another layout are cleared. */
+void knut_cache_open(knut_cache_t* cache, bool bypass);
+int knut_cache_open_path(knut_cache_t* cache, const char* path, uint32_t num_sets);
+void knut_cache_close(knut_cache_t* cache);
+
+/* The build ID is a hash of the running executable, so rebuilding drops old answers */
+knut_cache_key_t knut_cache_key(const knut_cache_t* cache, uint32_t day, const char* input,
+    uint64_t size);
+/* Parts are numbered from 1, returns true only if all 'num_parts' answers were found */
+bool knut_cache_lookup(knut_cache_t* cache, const knut_cache_key_t* key, int64_t* parts,
+    uint32_t num_parts);
+void knut_cache_store(knut_cache_t* cache, const knut_cache_key_t* key, const int64_t* parts,
+    uint32_t num_parts);
+
+#endif // KNUT_CACHE_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_CACHE_IMPLEMENTATION) && !defined(KNUT_CACHE_IMPLEMENTATION_DONE)
+#define KNUT_CACHE_IMPLEMENTATION_DONE
+
+#ifndef KNUT_IO_IMPLEMENTATION_DONE
+#error "'knut_io.h' must be implemented before this header can be used"
+#endif
+
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#endif
+
+#ifdef KNUT_ARCH_X86
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+#define KNUT_CACHE_PRIME32_1 0x9E3779B1u
+#define KNUT_CACHE_PRIME32_2 0x85EBCA77u
+#define KNUT_CACHE_PRIME32_3 0xC2B2AE3Du
+#define KNUT_CACHE_PRIME64_1 0x9E3779B185EBCA87ull
+#define KNUT_CACHE_PRIME64_2 0xC2B2AE3D27D4EB4Full
+#define KNUT_CACHE_PRIME64_3 0x165667B19E3779F9ull
+#define KNUT_CACHE_PRIME64_4 0x85EBCA77C2B2AE63ull
+#define KNUT_CACHE_PRIME64_5 0x27D4EB2F165667C5ull
+
+/* Eight 64 bit lanes take one 64 byte stripe at a time and get scrambled after every block of
+ * 16 stripes. Stripe i of a block is keyed with the secret at byte 8 * i. */
+#define KNUT_CACHE_SECRET_SIZE 192
+#define KNUT_CACHE_STRIPE_SIZE 64
+#define KNUT_CACHE_STRIPES_PER_BLOCK 16
+#define KNUT_CACHE_BLOCK_SIZE (KNUT_CACHE_STRIPES_PER_BLOCK * KNUT_CACHE_STRIPE_SIZE)
+#define KNUT_CACHE_SCRAMBLE_OFFSET (KNUT_CACHE_SECRET_SIZE - KNUT_CACHE_STRIPE_SIZE)
+
+static const char knut_cache_magic[8] = { 'K', 'N', 'U', 'T', 'C', 'A', 'C', 'H' };
+
+static uint64_t knut_cache_read_u64(const char* in)
+{
+    uint64_t value;
+    memcpy(&value, in, sizeof(value));
+    return value;
+}
+
+/* 64 x 64 bit product with its halves folded together */
+static uint64_t knut_cache_mul_fold(uint64_t a, uint64_t b)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high;
+    const uint64_t low = _umul128(a, b, &high);
+    return low ^ high;
+#elif defined(__SIZEOF_INT128__)
+    __extension__ const unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    const uint64_t a_low = a & 0xFFFFFFFF;
+    const uint64_t a_high = a >> 32;
+    const uint64_t b_low = b & 0xFFFFFFFF;
+    const uint64_t b_high = b >> 32;
+    const uint64_t low_low = a_low * b_low;
+    const uint64_t cross = (low_low >> 32) + (a_high * b_low & 0xFFFFFFFF) + a_low * b_high;
+    const uint64_t high = a_high * b_high + (a_high * b_low >> 32) + (cross >> 32);
+    return ((cross << 32) | (low_low & 0xFFFFFFFF)) ^ high;
+#endif
+}
+
+static uint64_t knut_cache_avalanche(uint64_t hash)
+{
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ull;
+    return hash ^ (hash >> 32);
+}
+
+/* splitmix64, the secret only has to be the same on every run */
+static void knut_cache_make_secret(char* secret)
+{
+    uint64_t state = KNUT_CACHE_PRIME64_1;
+
+    for (uint32_t i = 0; i < KNUT_CACHE_SECRET_SIZE / 8; ++i)
+    {
+        uint64_t value = (state += 0x9E3779B97F4A7C15ull);
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        value ^= value >> 31;
+        memcpy(secret + 8 * i, &value, sizeof(value));
+    }
+}
+
+static void knut_cache_accumulate(uint64_t* acc, const char* stripes, uint64_t num_stripes,
+    const char* secret)
+{
+    for (uint64_t i = 0; i < num_stripes; ++i)
+    {
+        const char* stripe = stripes + i * KNUT_CACHE_STRIPE_SIZE;
+        const char* key = secret + 8 * i;
+
+        for (uint32_t lane = 0; lane < 8; ++lane)
+        {
+            const uint64_t data = knut_cache_read_u64(stripe + 8 * lane);
+            const uint64_t keyed = data ^ knut_cache_read_u64(key + 8 * lane);
+            acc[lane ^ 1] += data;
+            acc[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+        }
+    }
+}
+
+static void knut_cache_hash_blocks_scalar(uint64_t* acc, const char* input, uint64_t num_blocks,
+    const char* secret)
+{
+    for (uint64_t block = 0; block < num_blocks; ++block)
+    {
+        knut_cache_accumulate(acc, input + block * KNUT_CACHE_BLOCK_SIZE,
+            KNUT_CACHE_STRIPES_PER_BLOCK, secret);
+
+        for (uint32_t lane = 0; lane < 8; ++lane)
+        {
+            acc[lane] ^= acc[lane] >> 47;
+            acc[lane] ^= knut_cache_read_u64(secret + KNUT_CACHE_SCRAMBLE_OFFSET + 8 * lane);
+            acc[lane] *= KNUT_CACHE_PRIME32_1;
+        }
+    }
+}
+
+#ifdef KNUT_ARCH_X86
+
+/* The 32 x 32 bit multiplies take the high half of every lane from a shuffled copy, the data
+ * gets added to the neighbouring lane by swapping lane pairs */
+KNUT_TARGET_SSE42 static void knut_cache_hash_blocks_sse42(uint64_t* acc, const char* input,
+    uint64_t num_blocks, const char* secret)
+{
+    __m128i lanes[4];
+    for (uint32_t i = 0; i < 4; ++i) { lanes[i] = _mm_loadu_si128((const __m128i*)acc + i); }
+    const __m128i prime = _mm_set1_epi32((int)KNUT_CACHE_PRIME32_1);
+
+    for (uint64_t block = 0; block < num_blocks; ++block)
+    {
+        const char* stripes = input + block * KNUT_CACHE_BLOCK_SIZE;
+
+        for (uint32_t stripe = 0; stripe < KNUT_CACHE_STRIPES_PER_BLOCK; ++stripe)
+        {
+            const __m128i* data = (const __m128i*)(stripes + stripe * KNUT_CACHE_STRIPE_SIZE);
+            const __m128i* key = (const __m128i*)(secret + 8 * stripe);
+
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                const __m128i value = _mm_loadu_si128(data + i);
+                const __m128i keyed = _mm_xor_si128(value, _mm_loadu_si128(key + i));
+                const __m128i product = _mm_mul_epu32(keyed,
+                    _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+                const __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+                lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, swapped));
+            }
+        }
+
+        const __m128i* key = (const __m128i*)(secret + KNUT_CACHE_SCRAMBLE_OFFSET);
+
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            __m128i value = _mm_xor_si128(lanes[i], _mm_srli_epi64(lanes[i], 47));
+            value = _mm_xor_si128(value, _mm_loadu_si128(key + i));
+            const __m128i low = _mm_mul_epu32(value, prime);
+            const __m128i high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+            lanes[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+        }
+    }
+
+    for (uint32_t i = 0; i < 4; ++i) { _mm_storeu_si128((__m128i*)acc + i, lanes[i]); }
+}
+
+KNUT_TARGET_AVX2 static void knut_cache_hash_blocks_avx2(uint64_t* acc, const char* input,
+    uint64_t num_blocks, const char* secret)
+{
+    __m256i lanes[2];
+    for (uint32_t i = 0; i < 2; ++i) { lanes[i] = _mm256_loadu_si256((const __m256i*)acc + i); }
+    const __m256i prime = _mm256_set1_epi32((int)KNUT_CACHE_PRIME32_1);
+
+    for (uint64_t block = 0; block < num_blocks; ++block)
+    {
+        const char* stripes = input + block * KNUT_CACHE_BLOCK_SIZE;
+
+        for (uint32_t stripe = 0; stripe < KNUT_CACHE_STRIPES_PER_BLOCK; ++stripe)
+        {
+            const __m256i* data = (const __m256i*)(stripes + stripe * KNUT_CACHE_STRIPE_SIZE);
+            const __m256i* key = (const __m256i*)(secret + 8 * stripe);
+
+            for (uint32_t i = 0; i < 2; ++i)
+            {
+                const __m256i value = _mm256_loadu_si256(data + i);
+                const __m256i keyed = _mm256_xor_si256(value, _mm256_loadu_si256(key + i));
+                const __m256i product = _mm256_mul_epu32(keyed,
+                    _mm256_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+                const __m256i swapped = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+                lanes[i] = _mm256_add_epi64(lanes[i], _mm256_add_epi64(product, swapped));
+            }
+        }
+
+        const __m256i* key = (const __m256i*)(secret + KNUT_CACHE_SCRAMBLE_OFFSET);
+
+        for (uint32_t i = 0; i < 2; ++i)
+        {
+            __m256i value = _mm256_xor_si256(lanes[i], _mm256_srli_epi64(lanes[i], 47));
+            value = _mm256_xor_si256(value, _mm256_loadu_si256(key + i));
+            const __m256i low = _mm256_mul_epu32(value, prime);
+            const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+            lanes[i] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+        }
+    }
+
+    for (uint32_t i = 0; i < 2; ++i) { _mm256_storeu_si256((__m256i*)acc + i, lanes[i]); }
+}
+
+#endif // ifdef KNUT_ARCH_X86
+
+/* AVX-512 would only halve the loop count of a loop that is already bound by memory */
+static KNUT_CPU_DEFINE_DISPATCH(void, knut_cache_hash_blocks,
+    (uint64_t* acc, const char* input, uint64_t num_blocks, const char* secret),
+    (acc, input, num_blocks, secret), knut_cache_hash_blocks_scalar,
+    KNUT_CPU_X86(knut_cache_hash_blocks_sse42), KNUT_CPU_X86(knut_cache_hash_blocks_avx2), NULL)
+
+static uint64_t knut_cache_merge(const uint64_t* acc, const char* secret, uint64_t start)
+{
+    uint64_t result = start;
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        result += knut_cache_mul_fold(acc[2 * i] ^ knut_cache_read_u64(secret + 16 * i),
+            acc[2 * i + 1] ^ knut_cache_read_u64(secret + 16 * i + 8));
+    }
+
+    return knut_cache_avalanche(result);
+}
+
+knut_cache_hash_t knut_cache_hash(const char* data, uint64_t size)
+{
+    char secret[KNUT_CACHE_SECRET_SIZE];
+    knut_cache_make_secret(secret);
+
+    uint64_t acc[8] = {
+        KNUT_CACHE_PRIME32_3, KNUT_CACHE_PRIME64_1, KNUT_CACHE_PRIME64_2, KNUT_CACHE_PRIME64_3,
+        KNUT_CACHE_PRIME64_4, KNUT_CACHE_PRIME32_2, KNUT_CACHE_PRIME64_5, KNUT_CACHE_PRIME32_1
+    };
+
+    const uint64_t num_blocks = size / KNUT_CACHE_BLOCK_SIZE;
+    knut_cache_hash_blocks(acc, data, num_blocks, secret);
+
+    /* The tail is made of whole stripes and a zero padded last one, the size goes into the
+     * merge so padding can't collide with real zeros */
+    const char* tail = data + num_blocks * KNUT_CACHE_BLOCK_SIZE;
+    const uint64_t tail_size = size - num_blocks * KNUT_CACHE_BLOCK_SIZE;
+    const uint64_t num_stripes = tail_size / KNUT_CACHE_STRIPE_SIZE;
+    knut_cache_accumulate(acc, tail, num_stripes, secret);
+
+    if (tail_size % KNUT_CACHE_STRIPE_SIZE != 0)
+    {
+        char last[KNUT_CACHE_STRIPE_SIZE] = { 0 };
+        memcpy(last, tail + num_stripes * KNUT_CACHE_STRIPE_SIZE,
+            tail_size % KNUT_CACHE_STRIPE_SIZE);
+        knut_cache_accumulate(acc, last, 1, secret + KNUT_CACHE_SCRAMBLE_OFFSET - 7);
+    }
+
+    knut_cache_hash_t hash;
+    hash.low = knut_cache_merge(acc, secret + 11, size * KNUT_CACHE_PRIME64_1);
+    hash.high = knut_cache_merge(acc, secret + KNUT_CACHE_SCRAMBLE_OFFSET - 11,
+        ~(size * KNUT_CACHE_PRIME64_2));
+    return hash;
+}
+
+static uint64_t knut_cache_entry_check(const knut_cache_entry_t* entry)
+{
+    uint64_t check = KNUT_CACHE_PRIME64_5;
+    check = knut_cache_mul_fold(check ^ entry->input.low, KNUT_CACHE_PRIME64_1 ^ entry->input.high);
+    check = knut_cache_mul_fold(check ^ entry->input_size, KNUT_CACHE_PRIME64_2 ^ entry->build_id);
+    check = knut_cache_mul_fold(check ^ ((uint64_t)entry->day << 32 | entry->part),
+        KNUT_CACHE_PRIME64_3 ^ (uint64_t)entry->value);
+    /* 0 is what a fresh file holds */
+    return knut_cache_avalanche(check) | 1;
+}
+
+static bool knut_cache_entry_matches(const knut_cache_entry_t* entry,
+    const knut_cache_key_t* key, uint32_t part)
+{
+    return entry->check == knut_cache_entry_check(entry) &&
+        entry->input.low == key->input.low && entry->input.high == key->input.high &&
+        entry->input_size == key->input_size && entry->build_id == key->build_id &&
+        entry->day == key->day && entry->part == part;
+}
+
+static knut_cache_entry_t* knut_cache_set(knut_cache_t* cache, const knut_cache_key_t* key,
+    uint32_t part)
+{
+    const uint64_t mixed = knut_cache_avalanche(key->input.low ^
+        ((uint64_t)key->day << 32 | part) * KNUT_CACHE_PRIME64_4);
+    return cache->entries + (mixed % cache->header->num_sets) * KNUT_CACHE_WAYS;
+}
+
+static void knut_cache_reset(knut_cache_t* cache, uint32_t num_sets)
+{
+    memset((char*)cache->file.ptr, 0, cache->file.size);
+    memcpy(cache->header->magic, knut_cache_magic, sizeof(knut_cache_magic));
+    cache->header->version = KNUT_CACHE_VERSION;
+    cache->header->num_sets = num_sets;
+}
+
+int knut_cache_open_path(knut_cache_t* cache, const char* path, uint32_t num_sets)
+{
+    KNUT_ASSERT(num_sets > 0, "[knut_cache_open_path] Need at least one set\n");
+    memset(cache, 0, sizeof(*cache));
+    cache->bypass = true;
+
+    const uint64_t size = sizeof(knut_cache_header_t) +
+        (uint64_t)num_sets * KNUT_CACHE_WAYS * sizeof(knut_cache_entry_t);
+
+    if (knut_io_map_file_writable(&cache->file, path, size) != 0)
+    {
+        return -1;
+    }
+
+    cache->header = (knut_cache_header_t*)cache->file.ptr;
+    cache->entries = (knut_cache_entry_t*)(cache->header + 1);
+
+    if (memcmp(cache->header->magic, knut_cache_magic, sizeof(knut_cache_magic)) != 0 ||
+        cache->header->version != KNUT_CACHE_VERSION || cache->header->num_sets != num_sets)
+    {
+        knut_cache_reset(cache, num_sets);
+    }
+
+    /* A running executable can always be read, falls back to a per compile ID if not */
+    knut_io_mapped_file_t executable;
+    char executable_path[4096] = { 0 };
+
+#ifdef _WIN32
+    GetModuleFileNameA(NULL, executable_path, sizeof(executable_path) - 1);
+#else
+    strncpy(executable_path, "/proc/self/exe", sizeof(executable_path) - 1);
+#endif
+
+    if (knut_io_map_file(&executable, executable_path) == 0 && executable.ptr != NULL)
+    {
+        cache->build_id = knut_cache_hash(executable.ptr, executable.size).low;
+        knut_io_unmap_file(&executable);
+    }
+    else
+    {
+        const char* compiled = __DATE__ " " __TIME__;
+        cache->build_id = knut_cache_hash(compiled, strlen(compiled)).low;
+    }
+
+    cache->bypass = false;
+    return 0;
+}
+
+void knut_cache_open(knut_cache_t* cache, bool bypass)
+{
+    memset(cache, 0, sizeof(*cache));
+    cache->bypass = true;
+
+    if (bypass)
+    {
+        return;
+    }
+
+    char path[4096] = { 0 };
+
+#ifdef _MSC_VER
+    size_t length;
+    if (getenv_s(&length, path, sizeof(path), "KNUT_CACHE_PATH") != 0 || length == 0)
+    {
+        strncpy_s(path, sizeof(path), KNUT_CACHE_DEFAULT_PATH, _TRUNCATE);
+    }
+#else
+    const char* value = getenv("KNUT_CACHE_PATH");
+    strncpy(path, value != NULL ? value : KNUT_CACHE_DEFAULT_PATH, sizeof(path) - 1);
+#endif
+
+    knut_cache_open_path(cache, path, KNUT_CACHE_DEFAULT_SETS);
+}
+
+void knut_cache_close(knut_cache_t* cache)
+{
+    knut_io_unmap_file(&cache->file);
+    memset(cache, 0, sizeof(*cache));
+}
+
+knut_cache_key_t knut_cache_key(const knut_cache_t* cache, uint32_t day, const char* input,
+    uint64_t size)
+{
+    knut_cache_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.input_size = size;
+    key.build_id = cache->build_id;
+    key.day = day;
+
+    if (!cache->bypass)
+    {
+        key.input = knut_cache_hash(input, size);
+    }
+
+    return key;
+}
+
+bool knut_cache_lookup(knut_cache_t* cache, const knut_cache_key_t* key, int64_t* parts,
+    uint32_t num_parts)
+{
+    if (cache->bypass)
+    {
+        return false;
+    }
+
+    const uint64_t now = ++cache->header->clock;
+
+    for (uint32_t part = 1; part <= num_parts; ++part)
+    {
+        knut_cache_entry_t* set = knut_cache_set(cache, key, part);
+        bool found = false;
+
+        for (uint32_t way = 0; way < KNUT_CACHE_WAYS && !found; ++way)
+        {
+            found = knut_cache_entry_matches(&set[way], key, part);
+
+            if (found)
+            {
+                parts[part - 1] = set[way].value;
+                set[way].last_used = now;
+            }
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void knut_cache_store(knut_cache_t* cache, const knut_cache_key_t* key, const int64_t* parts,
+    uint32_t num_parts)
+{
+    if (cache->bypass)
+    {
+        return;
+    }
+
+    const uint64_t now = ++cache->header->clock;
+
+    for (uint32_t part = 1; part <= num_parts; ++part)
+    {
+        knut_cache_entry_t* set = knut_cache_set(cache, key, part);
+        knut_cache_entry_t* victim = &set[0];
+
+        /* The entry of the same key if it is there, else an empty one, else the oldest */
+        for (uint32_t way = 0; way < KNUT_CACHE_WAYS; ++way)
+        {
+            knut_cache_entry_t* entry = &set[way];
+
+            if (knut_cache_entry_matches(entry, key, part))
+            {
+                victim = entry;
+                break;
+            }
+
+            const bool victim_empty = victim->check != knut_cache_entry_check(victim);
+            const bool entry_empty = entry->check != knut_cache_entry_check(entry);
+
+            if (!victim_empty && (entry_empty || entry->last_used < victim->last_used))
+            {
+                victim = entry;
+            }
+        }
+
+        knut_cache_entry_t entry;
+        entry.input = key->input;
+        entry.input_size = key->input_size;
+        entry.build_id = key->build_id;
+        entry.day = key->day;
+        entry.part = part;
+        entry.value = parts[part - 1];
+        entry.last_used = now;
+        entry.check = knut_cache_entry_check(&entry);
+        *victim = entry;
+    }
+}
+
+#endif // KNUT_CACHE_IMPLEMENTATION
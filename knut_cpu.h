@@ -0,0 +1,227 @@
+#ifndef KNUT_CPU_INCLUDE_H
+#define KNUT_CPU_INCLUDE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KNUT_ARCH_X86
+#endif
+
+/* Lets single functions use an instruction set without compiling the whole file for it, MSVC
+ * always can */
+#if defined(KNUT_ARCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KNUT_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#define KNUT_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,popcnt")))
+#define KNUT_TARGET_AVX512 \
+    __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl,avx2,bmi,bmi2,popcnt")))
+#else
+#define KNUT_TARGET_SSE42
+#define KNUT_TARGET_AVX2
+#define KNUT_TARGET_AVX512
+#endif
+
+/* Ordered, every level implies the ones below it */
+typedef enum {
+    KNUT_CPU_ISA_SCALAR = 0,
+    KNUT_CPU_ISA_SSE42,
+    KNUT_CPU_ISA_AVX2,
+    KNUT_CPU_ISA_AVX512,
+    KNUT_CPU_ISA_COUNT
+} knut_cpu_isa_t;
+
+/* avx512 is only set if F, DQ, BW and VL are all there and the OS saves the registers */
+typedef struct {
+    bool sse42;
+    bool popcnt;
+    bool avx2;
+    bool bmi2;
+    bool avx512;
+} knut_cpu_features_t;
+
+knut_cpu_features_t knut_cpu_detect();
+
+/* Best ISA of the CPU, lowered to the one named by the KNUT_FORCE_ISA environment variable
+ * (scalar, sse42, avx2 or avx512) if it is set. Resolved on the first call. */
+knut_cpu_isa_t knut_cpu_isa();
+const char* knut_cpu_isa_name(knut_cpu_isa_t isa);
+
+/* Vector versions only exist on x86, everywhere else their table entries are NULL */
+#ifdef KNUT_ARCH_X86
+#define KNUT_CPU_X86(FUNCTION) FUNCTION
+#else
+#define KNUT_CPU_X86(FUNCTION) NULL
+#endif
+
+/* Defines NAME with one implementation per ISA, NULL entries fall back to the next lower ISA
+ * and SCALAR must always be given. The choice is made on the first call and then only costs
+ * an indirect call. PARAMS is the parenthesized parameter list and ARGS the matching names. */
+#define KNUT_CPU_DEFINE_DISPATCH(RETURN_TYPE, NAME, PARAMS, ARGS, SCALAR, SSE42, AVX2, AVX512) \
+RETURN_TYPE NAME PARAMS \
+{ \
+    typedef RETURN_TYPE (*function_t) PARAMS; \
+    static const function_t functions[KNUT_CPU_ISA_COUNT] = { SCALAR, SSE42, AVX2, AVX512 }; \
+    static _Atomic(function_t) resolved = NULL; \
+    function_t function = atomic_load_explicit(&resolved, memory_order_relaxed); \
+    if (function == NULL) \
+    { \
+        uint32_t isa = (uint32_t)knut_cpu_isa(); \
+        while (functions[isa] == NULL) { --isa; } \
+        function = functions[isa]; \
+        atomic_store_explicit(&resolved, function, memory_order_relaxed); \
+    } \
+    return function ARGS; \
+} \
+
+#endif // KNUT_CPU_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_CPU_IMPLEMENTATION) && !defined(KNUT_CPU_IMPLEMENTATION_DONE)
+#define KNUT_CPU_IMPLEMENTATION_DONE
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(KNUT_ARCH_X86) && defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(KNUT_ARCH_X86) && defined(_MSC_VER)
+
+knut_cpu_features_t knut_cpu_detect()
+{
+    knut_cpu_features_t features = {0};
+    int info[4];
+    __cpuid(info, 0);
+    const int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    features.sse42 = (info[2] & (1 << 20)) != 0;
+    features.popcnt = (info[2] & (1 << 23)) != 0;
+
+    const bool uses_xsave = (info[2] & (1 << 27)) != 0;
+    const bool has_avx = (info[2] & (1 << 28)) != 0;
+    const uint64_t saved_state = uses_xsave ? _xgetbv(0) : 0;
+    const bool os_saves_avx = has_avx && (saved_state & 0x6) == 0x6;
+    const bool os_saves_avx512 = os_saves_avx && (saved_state & 0xe0) == 0xe0;
+
+    if (max_leaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        features.avx2 = os_saves_avx && (info[1] & (1 << 5)) != 0;
+        features.bmi2 = (info[1] & (1 << 8)) != 0;
+        features.avx512 = os_saves_avx512 &&
+            (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 17)) != 0 &&
+            (info[1] & (1 << 30)) != 0 && (info[1] & (1u << 31)) != 0;
+    }
+
+    return features;
+}
+
+#elif defined(KNUT_ARCH_X86)
+
+knut_cpu_features_t knut_cpu_detect()
+{
+    __builtin_cpu_init();
+
+    knut_cpu_features_t features;
+    features.sse42 = __builtin_cpu_supports("sse4.2");
+    features.popcnt = __builtin_cpu_supports("popcnt");
+    features.avx2 = __builtin_cpu_supports("avx2");
+    features.bmi2 = __builtin_cpu_supports("bmi2");
+    features.avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl");
+    return features;
+}
+
+#else
+
+knut_cpu_features_t knut_cpu_detect()
+{
+    knut_cpu_features_t features = {0};
+    return features;
+}
+
+#endif // if defined(KNUT_ARCH_X86) && defined(_MSC_VER)
+
+static const char* knut_cpu_isa_names[KNUT_CPU_ISA_COUNT] = { "scalar", "sse42", "avx2", "avx512" };
+
+const char* knut_cpu_isa_name(knut_cpu_isa_t isa)
+{
+    return isa < KNUT_CPU_ISA_COUNT ? knut_cpu_isa_names[isa] : "unknown";
+}
+
+static knut_cpu_isa_t knut_cpu_detect_isa()
+{
+    const knut_cpu_features_t features = knut_cpu_detect();
+
+    if (features.avx512 && features.avx2 && features.bmi2 && features.popcnt)
+    {
+        return KNUT_CPU_ISA_AVX512;
+    }
+
+    if (features.avx2 && features.bmi2 && features.popcnt)
+    {
+        return KNUT_CPU_ISA_AVX2;
+    }
+
+    return features.sse42 && features.popcnt ? KNUT_CPU_ISA_SSE42 : KNUT_CPU_ISA_SCALAR;
+}
+
+/* Unknown names are ignored */
+static knut_cpu_isa_t knut_cpu_forced_isa()
+{
+    char name[16] = {0};
+
+#ifdef _MSC_VER
+    size_t length;
+    if (getenv_s(&length, name, sizeof(name), "KNUT_FORCE_ISA") != 0)
+    {
+        return KNUT_CPU_ISA_COUNT;
+    }
+#else
+    const char* value = getenv("KNUT_FORCE_ISA");
+    if (value != NULL)
+    {
+        strncpy(name, value, sizeof(name) - 1);
+    }
+#endif
+
+    for (uint32_t isa = 0; isa < KNUT_CPU_ISA_COUNT; ++isa)
+    {
+        if (strcmp(name, knut_cpu_isa_names[isa]) == 0)
+        {
+            return (knut_cpu_isa_t)isa;
+        }
+    }
+
+    return KNUT_CPU_ISA_COUNT;
+}
+
+/* Racing first calls all store the same value */
+knut_cpu_isa_t knut_cpu_isa()
+{
+    static atomic_int selected = -1;
+    int isa = atomic_load_explicit(&selected, memory_order_relaxed);
+
+    if (isa < 0)
+    {
+        const knut_cpu_isa_t detected = knut_cpu_detect_isa();
+        const knut_cpu_isa_t forced = knut_cpu_forced_isa();
+        isa = (int)(forced < detected ? forced : detected);
+        atomic_store_explicit(&selected, isa, memory_order_relaxed);
+    }
+
+    return (knut_cpu_isa_t)isa;
+}
+
+#endif // KNUT_CPU_IMPLEMENTATION
@@ -5,13 +5,67 @@
 extern "C" {
 #endif
 
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/* Page backed memory for very large buffers, sizes are in bytes */
+void* knut_huge_alloc(uint64_t size);
+void* knut_huge_realloc(void* ptr, uint64_t old_size, uint64_t new_size);
+void knut_huge_free(void* ptr, uint64_t size);
+
+typedef struct {
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+    uint64_t num_allocations;
+    uint64_t realloc_copy_bytes;
+} knut_allocator_stats_t;
+
+/* Sizes are always passed back on realloc and free, stats are optional and not thread safe */
+typedef struct {
+    void* (*alloc)(void* ctx, uint64_t size);
+    void* (*realloc)(void* ctx, void* ptr, uint64_t old_size, uint64_t new_size, 
+        uint64_t* copied_bytes);
+    void (*free)(void* ctx, void* ptr, uint64_t size);
+    void* ctx;
+    knut_allocator_stats_t* stats;
+} knut_allocator_t;
+
+/* Containers use these with a NULL allocator meaning plain malloc */
+void* knut_allocator_alloc(const knut_allocator_t* allocator, uint64_t size);
+void* knut_allocator_realloc(const knut_allocator_t* allocator, void* ptr, uint64_t old_size, 
+    uint64_t new_size);
+void knut_allocator_free(const knut_allocator_t* allocator, void* ptr, uint64_t size);
+
+/* Bump allocator over chunks, memory is only given back on reset or destroy */
+typedef struct knut_arena_chunk_t {
+    struct knut_arena_chunk_t* next;
+    uint64_t size;
+    uint64_t used;
+} knut_arena_chunk_t;
+
+typedef struct {
+    knut_arena_chunk_t* chunks;
+    uint64_t chunk_size;
+    void* last_allocation;
+} knut_arena_t;
+
+void knut_arena_init(knut_arena_t* arena, uint64_t chunk_size);
+void knut_arena_destroy(knut_arena_t* arena);
+void* knut_arena_alloc(knut_arena_t* arena, uint64_t size);
+void knut_arena_reset(knut_arena_t* arena);
+
+knut_allocator_t knut_allocator_malloc(knut_allocator_stats_t* stats);
+knut_allocator_t knut_allocator_huge(knut_allocator_stats_t* stats);
+knut_allocator_t knut_allocator_arena(knut_arena_t* arena, knut_allocator_stats_t* stats);
+const knut_allocator_t* knut_allocator_huge_default();
+
 #define KNUT_DEFINE_ARRAY(TYPE, TYPE_NAME) \
 typedef struct { \
     TYPE* buffer; \
     uint64_t size; \
     uint64_t capacity; \
+    const knut_allocator_t* allocator; \
 } knut_array_##TYPE_NAME##_t; \
 \
 /* TODO: make this part of struct above */ \
@@ -26,6 +80,7 @@ static void knut_array_##TYPE_NAME##_init(knut_array_##TYPE_NAME##_t* array, uin
     KNUT_ASSERT(array->buffer, "[knut_array_" #TYPE_NAME "_init] Failed to alloc buffer\n"); \
     array->size = 0; \
     array->capacity = capacity; \
+    array->allocator = NULL; \
 } \
 \
 static knut_array_##TYPE_NAME##_t knut_array_##TYPE_NAME##_create(uint64_t capacity) \
@@ -35,12 +90,63 @@ static knut_array_##TYPE_NAME##_t knut_array_##TYPE_NAME##_create(uint64_t capac
     return array; \
 } \
 \
+/* The allocator has to outlive the array, NULL uses malloc */ \
+static knut_array_##TYPE_NAME##_t knut_array_##TYPE_NAME##_create_with(uint64_t capacity, \
+    const knut_allocator_t* allocator) \
+{ \
+    knut_array_##TYPE_NAME##_t array = { NULL, 0, capacity, allocator }; \
+    if (capacity > 0) \
+    { \
+        array.buffer = (TYPE*)knut_allocator_alloc(allocator, capacity * sizeof(TYPE)); \
+        KNUT_ASSERT(array.buffer, \
+            "[knut_array_" #TYPE_NAME "_create_with] Failed to alloc buffer\n"); \
+    } \
+    return array; \
+} \
+\
+/* Backed by page mappings that grow without copying, meant for very large arrays */ \
+static knut_array_##TYPE_NAME##_t knut_array_##TYPE_NAME##_create_huge(uint64_t capacity) \
+{ \
+    return knut_array_##TYPE_NAME##_create_with(capacity, knut_allocator_huge_default()); \
+} \
+\
 static void knut_array_##TYPE_NAME##_destroy(knut_array_##TYPE_NAME##_t* array) \
 { \
-    free(array->buffer); \
+    knut_allocator_free(array->allocator, array->buffer, \
+        array->capacity * sizeof(*array->buffer)); \
     memset(array, 0, sizeof(*array)); \
 } \
 \
+static void knut_array_##TYPE_NAME##_resize_buffer(knut_array_##TYPE_NAME##_t* array, \
+    uint64_t capacity) \
+{ \
+    const size_t value_size = sizeof(*array->buffer); \
+    TYPE* buffer = (TYPE*)knut_allocator_realloc(array->allocator, array->buffer, \
+        array->capacity * value_size, capacity * value_size); \
+\
+    KNUT_ASSERT(buffer || capacity == 0, \
+        "[knut_array_" #TYPE_NAME "_resize_buffer] Failed to resize buffer\n"); \
+    array->buffer = buffer; \
+    array->capacity = capacity; \
+} \
+\
+static void knut_array_##TYPE_NAME##_reserve(knut_array_##TYPE_NAME##_t* array, \
+    uint64_t capacity) \
+{ \
+    if (capacity > array->capacity) \
+    { \
+        knut_array_##TYPE_NAME##_resize_buffer(array, capacity); \
+    } \
+} \
+\
+static void knut_array_##TYPE_NAME##_shrink_to_fit(knut_array_##TYPE_NAME##_t* array) \
+{ \
+    if (array->size < array->capacity) \
+    { \
+        knut_array_##TYPE_NAME##_resize_buffer(array, array->size); \
+    } \
+} \
+\
 static void knut_array_##TYPE_NAME##_clear(knut_array_##TYPE_NAME##_t* array) \
 { \
     array->size = 0; \
@@ -50,20 +156,20 @@ static void knut_array_##TYPE_NAME##_push_slice(knut_array_##TYPE_NAME##_t* arra
     const TYPE* entries, uint64_t num_entries) \
 { \
     const size_t value_size = sizeof(*array->buffer); \
+    uint64_t new_capacity = array->capacity == 0 ? 8 : array->capacity; \
  \
-    while (array->capacity < (array->size + num_entries)) \
+    while (new_capacity < (array->size + num_entries)) \
     { \
         KNUT_ASSERT( \
-            array->capacity <= (UINT64_MAX / 2), \
+            new_capacity <= (UINT64_MAX / 2 / value_size), \
             "[knut_array_" #TYPE_NAME "_push] Capacity overflow" \
         ); \
-        if (array->capacity == 0) \
-        { \
-            array->capacity = 4; \
-        } \
-        const uint64_t old_capacity = array->capacity; \
-        array->capacity = old_capacity == 0 ? 8 : 2 * old_capacity; \
-        array->buffer = (TYPE*)realloc(array->buffer, value_size * array->capacity); \
+        new_capacity *= 2; \
+    } \
+ \
+    if (new_capacity != array->capacity) \
+    { \
+        knut_array_##TYPE_NAME##_resize_buffer(array, new_capacity); \
     } \
  \
     memcpy(array->buffer + array->size, entries, value_size * num_entries); \
@@ -126,7 +232,8 @@ static knut_array_##TYPE_NAME##_data_t knut_array_##TYPE_NAME##_get_data( \
 static knut_array_##TYPE_NAME##_t knut_array_##TYPE_NAME##_copy( \
     const knut_array_##TYPE_NAME##_t* array) \
 { \
-    knut_array_##TYPE_NAME##_t new_array = knut_array_##TYPE_NAME##_create(array->capacity); \
+    knut_array_##TYPE_NAME##_t new_array = \
+        knut_array_##TYPE_NAME##_create_with(array->capacity, array->allocator); \
     new_array.size = array->size; \
     memcpy(new_array.buffer, array->buffer, array->size * sizeof(*array->buffer)); \
     return new_array; \
@@ -146,32 +253,281 @@ KNUT_DEFINE_ARRAY(int16_t, i16)
 KNUT_DEFINE_ARRAY(int32_t, i32)
 KNUT_DEFINE_ARRAY(int64_t, i64)
 
+/* Reductions over plain buffers that run on the instruction set picked by knut_cpu_isa. Sums
+ * and dot products wrap around on overflow, abs_diff is the sum of |a[i] - b[i]| and dot_index
+ * the sum of (first_index + i) * values[i]. */
+#define KNUT_DECLARE_REDUCE(TYPE, TYPE_NAME, SUM_TYPE) \
+SUM_TYPE knut_reduce_##TYPE_NAME##_sum(const TYPE* values, uint64_t size); \
+SUM_TYPE knut_reduce_##TYPE_NAME##_dot_index(const TYPE* values, uint64_t size, \
+    uint64_t first_index); \
+uint64_t knut_reduce_##TYPE_NAME##_abs_diff(const TYPE* a, const TYPE* b, uint64_t size); \
+knut_pair_##TYPE_NAME##_t knut_reduce_##TYPE_NAME##_minmax(const TYPE* values, uint64_t size); \
+uint64_t knut_reduce_##TYPE_NAME##_count_equal(const TYPE* values, uint64_t size, TYPE value); \
+
+KNUT_DECLARE_REDUCE(int32_t, i32, int64_t)
+KNUT_DECLARE_REDUCE(uint32_t, u32, uint64_t)
+KNUT_DECLARE_REDUCE(int64_t, i64, int64_t)
+KNUT_DECLARE_REDUCE(uint64_t, u64, uint64_t)
+
+/* Array wrappers around the reductions, KERNEL_TYPE has to have the same layout as TYPE */
+#define KNUT_DEFINE_ARRAY_REDUCE(TYPE, TYPE_NAME, KERNEL_TYPE, KERNEL_NAME, SUM_TYPE) \
+static SUM_TYPE knut_array_##TYPE_NAME##_reduce_sum(const knut_array_##TYPE_NAME##_t* array) \
+{ \
+    return knut_reduce_##KERNEL_NAME##_sum((const KERNEL_TYPE*)array->buffer, array->size); \
+} \
+\
+static SUM_TYPE knut_array_##TYPE_NAME##_reduce_dot_index( \
+    const knut_array_##TYPE_NAME##_t* array, uint64_t first_index) \
+{ \
+    return knut_reduce_##KERNEL_NAME##_dot_index((const KERNEL_TYPE*)array->buffer, \
+        array->size, first_index); \
+} \
+\
+static uint64_t knut_array_##TYPE_NAME##_reduce_abs_diff(const knut_array_##TYPE_NAME##_t* a, \
+    const knut_array_##TYPE_NAME##_t* b) \
+{ \
+    KNUT_ASSERT(a->size == b->size, \
+        "[knut_array_" #TYPE_NAME "_reduce_abs_diff] Sizes don't match\n"); \
+    return knut_reduce_##KERNEL_NAME##_abs_diff((const KERNEL_TYPE*)a->buffer, \
+        (const KERNEL_TYPE*)b->buffer, a->size); \
+} \
+\
+static knut_pair_##KERNEL_NAME##_t knut_array_##TYPE_NAME##_reduce_minmax( \
+    const knut_array_##TYPE_NAME##_t* array) \
+{ \
+    KNUT_ASSERT(array->size > 0, \
+        "[knut_array_" #TYPE_NAME "_reduce_minmax] Array is empty\n"); \
+    return knut_reduce_##KERNEL_NAME##_minmax((const KERNEL_TYPE*)array->buffer, array->size); \
+} \
+\
+static uint64_t knut_array_##TYPE_NAME##_reduce_count(const knut_array_##TYPE_NAME##_t* array, \
+    TYPE value) \
+{ \
+    return knut_reduce_##KERNEL_NAME##_count_equal((const KERNEL_TYPE*)array->buffer, \
+        array->size, (KERNEL_TYPE)value); \
+} \
+
+_Static_assert(sizeof(int) == sizeof(int32_t), "int arrays reuse the int32_t reductions");
+
+KNUT_DEFINE_ARRAY_REDUCE(int, int, int32_t, i32, int64_t)
+KNUT_DEFINE_ARRAY_REDUCE(int32_t, i32, int32_t, i32, int64_t)
+KNUT_DEFINE_ARRAY_REDUCE(uint32_t, u32, uint32_t, u32, uint64_t)
+KNUT_DEFINE_ARRAY_REDUCE(int64_t, i64, int64_t, i64, int64_t)
+KNUT_DEFINE_ARRAY_REDUCE(uint64_t, u64, uint64_t, u64, uint64_t)
+
+/* Keeps up to INLINE_CAPACITY entries inside the struct and only spills to the heap beyond that */
+#define KNUT_DEFINE_SMALL_ARRAY(TYPE, TYPE_NAME, INLINE_CAPACITY) \
+typedef struct { \
+    TYPE* heap; \
+    uint64_t size; \
+    uint64_t capacity; \
+    TYPE inline_buffer[INLINE_CAPACITY]; \
+} knut_small_array_##TYPE_NAME##_t; \
+\
+typedef struct { \
+    TYPE* buffer; \
+    uint64_t size; \
+} knut_small_array_##TYPE_NAME##_data_t; \
+\
+static void knut_small_array_##TYPE_NAME##_init(knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    array->heap = NULL; \
+    array->size = 0; \
+    array->capacity = INLINE_CAPACITY; \
+} \
+\
+static knut_small_array_##TYPE_NAME##_t knut_small_array_##TYPE_NAME##_create() \
+{ \
+    knut_small_array_##TYPE_NAME##_t array; \
+    knut_small_array_##TYPE_NAME##_init(&array); \
+    return array; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_destroy(knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    free(array->heap); \
+    knut_small_array_##TYPE_NAME##_init(array); \
+} \
+\
+static TYPE* knut_small_array_##TYPE_NAME##_buffer(knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    return array->heap != NULL ? array->heap : array->inline_buffer; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_clear(knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    array->size = 0; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_push_slice(knut_small_array_##TYPE_NAME##_t* array, \
+    const TYPE* entries, uint64_t num_entries) \
+{ \
+    const size_t value_size = sizeof(TYPE); \
+ \
+    if (array->capacity < array->size + num_entries) \
+    { \
+        KNUT_ASSERT(array->capacity <= (UINT64_MAX / 2), \
+            "[knut_small_array_" #TYPE_NAME "_push] Capacity overflow"); \
+        const uint64_t new_capacity = 2 * array->capacity > array->size + num_entries ? \
+            2 * array->capacity : array->size + num_entries; \
+        TYPE* heap = (TYPE*)realloc(array->heap, value_size * new_capacity); \
+        KNUT_ASSERT(heap, "[knut_small_array_" #TYPE_NAME "_push] Failed to alloc buffer\n"); \
+ \
+        if (array->heap == NULL) \
+        { \
+            memcpy(heap, array->inline_buffer, value_size * array->size); \
+        } \
+ \
+        array->heap = heap; \
+        array->capacity = new_capacity; \
+    } \
+ \
+    memcpy(knut_small_array_##TYPE_NAME##_buffer(array) + array->size, entries, \
+        value_size * num_entries); \
+    array->size += num_entries; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_push(knut_small_array_##TYPE_NAME##_t* array, TYPE f) \
+{ \
+    knut_small_array_##TYPE_NAME##_push_slice(array, &f, 1); \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_pop(knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    KNUT_ASSERT(array->size > 0, "[knut_small_array_" #TYPE_NAME "_pop] Can't pop empty array"); \
+    --array->size; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_pop_slice(knut_small_array_##TYPE_NAME##_t* array, \
+    uint64_t size) \
+{ \
+    KNUT_ASSERT(array->size >= size, "[knut_small_array_" #TYPE_NAME "_pop_slice] Can't pop \
+        slice of that size"); \
+    array->size -= size; \
+} \
+\
+static uint64_t knut_small_array_##TYPE_NAME##_size(const knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    return array->size; \
+} \
+\
+static bool knut_small_array_##TYPE_NAME##_is_empty( \
+    const knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    return array->size == 0; \
+} \
+\
+static uint64_t knut_small_array_##TYPE_NAME##_capacity( \
+    const knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    return array->capacity; \
+} \
+\
+static TYPE knut_small_array_##TYPE_NAME##_at(const knut_small_array_##TYPE_NAME##_t* array, \
+    uint64_t pos) \
+{ \
+    KNUT_ASSERT(pos < array->size, "[knut_small_array_" #TYPE_NAME "_at] Index out of bounds"); \
+    return array->heap != NULL ? array->heap[pos] : array->inline_buffer[pos]; \
+} \
+\
+static void knut_small_array_##TYPE_NAME##_set(knut_small_array_##TYPE_NAME##_t* array, \
+    uint64_t pos, TYPE t) \
+{ \
+    KNUT_ASSERT(pos < array->size, "[knut_small_array_" #TYPE_NAME "_set] Index out of bounds"); \
+    knut_small_array_##TYPE_NAME##_buffer(array)[pos] = t; \
+} \
+\
+static knut_small_array_##TYPE_NAME##_data_t knut_small_array_##TYPE_NAME##_get_data( \
+    knut_small_array_##TYPE_NAME##_t* array) \
+{ \
+    knut_small_array_##TYPE_NAME##_data_t data = { \
+        knut_small_array_##TYPE_NAME##_buffer(array), array->size \
+    }; \
+    return data; \
+} \
+
+
+/* Maps the same pages twice back to back, size must be a multiple of the granularity */
+void* knut_mirror_alloc(uint64_t size);
+void knut_mirror_free(void* ptr, uint64_t size);
+uint64_t knut_mirror_granularity();
+
+/* Capacity is always a power of two so positions wrap with a mask */
 #define KNUT_DEFINE_DEQUEUE(TYPE, TYPE_NAME) \
 typedef struct { \
     TYPE* buffer; \
     uint64_t capacity; \
     uint64_t size; \
     uint64_t front; \
-    uint64_t back; \
+    bool mirrored; \
+    const knut_allocator_t* allocator; \
 } knut_dequeue_##TYPE_NAME##_t; \
 \
+/* The allocator has to outlive the dequeue, NULL uses malloc */ \
+static knut_dequeue_##TYPE_NAME##_t knut_dequeue_##TYPE_NAME##_create_with(uint64_t capacity, \
+    const knut_allocator_t* allocator) \
+{ \
+    KNUT_ASSERT(capacity > 0, \
+        "[knut_dequeue_" #TYPE_NAME "_create_with] Capacity can't be 0\n"); \
+    capacity = knut_next_pow2_u64(capacity); \
+    knut_dequeue_##TYPE_NAME##_t dequeue = { \
+        (TYPE*)knut_allocator_alloc(allocator, capacity * sizeof(TYPE)), \
+        capacity, \
+        0, \
+        0, \
+        false, \
+        allocator \
+    }; \
+    KNUT_ASSERT(dequeue.buffer, \
+        "[knut_dequeue_" #TYPE_NAME "_create_with] Failed to alloc buffer\n"); \
+ \
+    return dequeue; \
+} \
+\
 static knut_dequeue_##TYPE_NAME##_t knut_dequeue_##TYPE_NAME##_create(uint64_t capacity) \
 { \
-    KNUT_ASSERT(capacity > 0, "[knut_dequeue_" #TYPE_NAME "_create] Capacity can't be 0\n"); \
+    return knut_dequeue_##TYPE_NAME##_create_with(capacity, NULL); \
+} \
+\
+static uint64_t knut_dequeue_##TYPE_NAME##_mirrored_capacity(uint64_t capacity) \
+{ \
+    const uint64_t value_size = sizeof(TYPE); \
+    const uint64_t granularity = knut_mirror_granularity(); \
+    const uint64_t alignment = value_size & (~value_size + 1); \
+    const uint64_t min_capacity = alignment < granularity ? granularity / alignment : 1; \
+    return knut_next_pow2_u64(capacity > min_capacity ? capacity : min_capacity); \
+} \
+\
+/* Any window of up to 'capacity' entries is contiguous in memory, also across the wrap */ \
+static knut_dequeue_##TYPE_NAME##_t knut_dequeue_##TYPE_NAME##_create_mirrored( \
+    uint64_t capacity) \
+{ \
+    capacity = knut_dequeue_##TYPE_NAME##_mirrored_capacity(capacity); \
     knut_dequeue_##TYPE_NAME##_t dequeue = { \
-        (TYPE*)calloc(capacity, sizeof(*dequeue.buffer)), \
+        (TYPE*)knut_mirror_alloc(capacity * sizeof(TYPE)), \
         capacity, \
-        0,  \
         0, \
-        0 \
+        0, \
+        true, \
+        NULL \
     }; \
+    KNUT_ASSERT(dequeue.buffer, \
+        "[knut_dequeue_" #TYPE_NAME "_create_mirrored] Failed to map buffer\n"); \
  \
     return dequeue; \
 } \
 \
 static void knut_dequeue_##TYPE_NAME##_destroy(knut_dequeue_##TYPE_NAME##_t* dequeue) \
 { \
-    free(dequeue->buffer); \
+    if (dequeue->mirrored) \
+    { \
+        knut_mirror_free(dequeue->buffer, dequeue->capacity * sizeof(*dequeue->buffer)); \
+    } \
+    else \
+    { \
+        knut_allocator_free(dequeue->allocator, dequeue->buffer, \
+            dequeue->capacity * sizeof(*dequeue->buffer)); \
+    } \
     memset(dequeue, 0, sizeof(*dequeue)); \
 } \
 static uint64_t knut_dequeue_##TYPE_NAME##_size(const knut_dequeue_##TYPE_NAME##_t* dequeue) \
@@ -189,60 +545,57 @@ static bool knut_dequeue_##TYPE_NAME##_is_empty(const knut_dequeue_##TYPE_NAME##
     return dequeue->size == 0; \
 } \
 \
-static void knut_dequeue_##TYPE_NAME##_realloc(knut_dequeue_##TYPE_NAME##_t* dequeue, \
-    bool offset_new_buffer) \
+static void knut_dequeue_##TYPE_NAME##_reserve(knut_dequeue_##TYPE_NAME##_t* dequeue, \
+    uint64_t capacity) \
 { \
-    KNUT_ASSERT( \
-        dequeue->capacity <= (UINT64_MAX / 2), \
-        "[knut_dequeue_" #TYPE_NAME "_push_front] Capacity overflow" \
-    ); \
+    if (capacity <= dequeue->capacity) \
+    { \
+        return; \
+    } \
  \
-    const uint8_t new_buffer_offset = offset_new_buffer ? 1 : 0; \
     const uint64_t old_capacity = dequeue->capacity; \
-    const uint64_t new_capacity = dequeue->capacity * 2; \
-    TYPE* new_buffer = (TYPE*)calloc(new_capacity, sizeof(*dequeue->buffer)); \
-    const uint64_t first_block_size = old_capacity - dequeue->front; \
+    const uint64_t new_capacity = knut_next_pow2_u64(capacity); \
     const size_t value_size = sizeof(*dequeue->buffer); \
-    memcpy(new_buffer + new_buffer_offset, dequeue->buffer + dequeue->front,  \
-        first_block_size * value_size); \
-    uint64_t second_block_size = 0; \
+    KNUT_ASSERT(new_capacity <= SIZE_MAX / value_size, \
+        "[knut_dequeue_" #TYPE_NAME "_reserve] Capacity overflow\n"); \
+ \
+    if (dequeue->mirrored) \
+    { \
+        TYPE* new_buffer = (TYPE*)knut_mirror_alloc(new_capacity * value_size); \
+        KNUT_ASSERT(new_buffer, "[knut_dequeue_" #TYPE_NAME "_reserve] Failed to map buffer\n"); \
+        memcpy(new_buffer, dequeue->buffer + dequeue->front, dequeue->size * value_size); \
+        knut_mirror_free(dequeue->buffer, old_capacity * value_size); \
+        dequeue->buffer = new_buffer; \
+        dequeue->capacity = new_capacity; \
+        dequeue->front = 0; \
+        return; \
+    } \
  \
-    if (dequeue->front != 0) \
+    TYPE* new_buffer = (TYPE*)knut_allocator_realloc(dequeue->allocator, dequeue->buffer, \
+        old_capacity * value_size, new_capacity * value_size); \
+    KNUT_ASSERT(new_buffer, "[knut_dequeue_" #TYPE_NAME "_reserve] Failed to alloc buffer\n"); \
+ \
+    /* The wrapped part moves to right after the old end, which always fits */ \
+    if (dequeue->front + dequeue->size > old_capacity) \
     { \
-        second_block_size = dequeue->back + 1; \
-        memcpy(new_buffer + new_buffer_offset + first_block_size, dequeue->buffer,  \
-            second_block_size * value_size); \
+        memcpy(new_buffer + old_capacity, new_buffer, \
+            (dequeue->front + dequeue->size - old_capacity) * value_size); \
     } \
-     \
-    knut_dequeue_##TYPE_NAME##_destroy(dequeue); \
+ \
     dequeue->buffer = new_buffer; \
     dequeue->capacity = new_capacity; \
-    dequeue->size = first_block_size + second_block_size; \
-    dequeue->front = 0; \
-    dequeue->back = dequeue->size - 1 + new_buffer_offset; \
 } \
  \
 static void knut_dequeue_##TYPE_NAME##_push_front(knut_dequeue_##TYPE_NAME##_t* dequeue, TYPE f) \
 { \
-    if (knut_dequeue_##TYPE_NAME##_is_empty(dequeue)) \
-    { \
-        ++dequeue->size; \
-        dequeue->buffer[0] = f; \
-        return; \
-    } \
- \
-    const uint64_t old_front = dequeue->front; \
-    uint64_t new_front = old_front > 0 ? old_front - 1 : dequeue->capacity - 1; \
- \
-    if (new_front == dequeue->back) \
+    if (dequeue->size == dequeue->capacity) \
     { \
-        knut_dequeue_##TYPE_NAME##_realloc(dequeue, true); \
-        new_front = 0; \
+        knut_dequeue_##TYPE_NAME##_reserve(dequeue, dequeue->capacity * 2); \
     } \
  \
+    dequeue->front = (dequeue->front - 1) & (dequeue->capacity - 1); \
+    dequeue->buffer[dequeue->front] = f; \
     ++dequeue->size; \
-    dequeue->buffer[new_front] = f; \
-    dequeue->front = new_front; \
 } \
  \
 static TYPE knut_dequeue_##TYPE_NAME##_front(const knut_dequeue_##TYPE_NAME##_t* dequeue) \
@@ -256,45 +609,26 @@ static void knut_dequeue_##TYPE_NAME##_pop_front(knut_dequeue_##TYPE_NAME##_t* d
 { \
     KNUT_ASSERT(!knut_dequeue_##TYPE_NAME##_is_empty(dequeue), \
         "[knut_dequeue_" #TYPE_NAME "_pop_front] Dequeue is empty"); \
+    dequeue->front = (dequeue->front + 1) & (dequeue->capacity - 1); \
     --dequeue->size; \
-    const uint64_t current_front = dequeue->front; \
-    dequeue->front = current_front < (dequeue->capacity - 1) ? current_front + 1 : 0; \
- \
-    if (knut_dequeue_##TYPE_NAME##_is_empty(dequeue)) \
-    { \
-        dequeue->front = 0; \
-        dequeue->back = 0; \
-    } \
 } \
  \
 static void knut_dequeue_##TYPE_NAME##_push_back(knut_dequeue_##TYPE_NAME##_t* dequeue, TYPE f) \
 { \
-    if (knut_dequeue_##TYPE_NAME##_is_empty(dequeue)) \
+    if (dequeue->size == dequeue->capacity) \
     { \
-        ++dequeue->size; \
-        dequeue->buffer[0] = f; \
-        return; \
-    } \
- \
-    const uint64_t old_back = dequeue->back; \
-    uint64_t new_back = old_back < (dequeue->capacity - 1) ? old_back + 1 : 0; \
- \
-    if (new_back == dequeue->front) \
-    { \
-        knut_dequeue_##TYPE_NAME##_realloc(dequeue, false); \
-        new_back = dequeue->size; \
+        knut_dequeue_##TYPE_NAME##_reserve(dequeue, dequeue->capacity * 2); \
     } \
  \
+    dequeue->buffer[(dequeue->front + dequeue->size) & (dequeue->capacity - 1)] = f; \
     ++dequeue->size; \
-    dequeue->buffer[new_back] = f; \
-    dequeue->back = new_back; \
 } \
  \
 static TYPE knut_dequeue_##TYPE_NAME##_back(const knut_dequeue_##TYPE_NAME##_t* dequeue) \
 { \
     KNUT_ASSERT(!knut_dequeue_##TYPE_NAME##_is_empty(dequeue), \
         "[knut_dequeue_" #TYPE_NAME "_back] Dequeue is empty"); \
-    return dequeue->buffer[dequeue->back]; \
+    return dequeue->buffer[(dequeue->front + dequeue->size - 1) & (dequeue->capacity - 1)]; \
 } \
  \
 static void knut_dequeue_##TYPE_NAME##_pop_back(knut_dequeue_##TYPE_NAME##_t* dequeue) \
@@ -302,52 +636,87 @@ static void knut_dequeue_##TYPE_NAME##_pop_back(knut_dequeue_##TYPE_NAME##_t* de
     KNUT_ASSERT(!knut_dequeue_##TYPE_NAME##_is_empty(dequeue), \
         "[knut_dequeue_" #TYPE_NAME "_pop_back] Dequeue is empty"); \
     --dequeue->size; \
-    const uint64_t current_back = dequeue->back; \
-    dequeue->back = current_back > 0 ? current_back - 1 : dequeue->capacity - 1; \
+} \
+ \
+static TYPE knut_dequeue_##TYPE_NAME##_at(const knut_dequeue_##TYPE_NAME##_t* dequeue, \
+    uint64_t pos) \
+{ \
+    KNUT_ASSERT(pos < dequeue->size, "[knut_dequeue_" #TYPE_NAME "_at] Index out of bounds"); \
+    return dequeue->buffer[(dequeue->front + pos) & (dequeue->capacity - 1)]; \
+} \
+ \
+static void knut_dequeue_##TYPE_NAME##_push_back_slice(knut_dequeue_##TYPE_NAME##_t* dequeue, \
+    const TYPE* entries, uint64_t num_entries) \
+{ \
+    knut_dequeue_##TYPE_NAME##_reserve(dequeue, dequeue->size + num_entries); \
+ \
+    const size_t value_size = sizeof(*dequeue->buffer); \
+    const uint64_t back = (dequeue->front + dequeue->size) & (dequeue->capacity - 1); \
+    const uint64_t first_block_size = dequeue->mirrored || \
+        num_entries < dequeue->capacity - back ? num_entries : dequeue->capacity - back; \
+    memcpy(dequeue->buffer + back, entries, first_block_size * value_size); \
+    memcpy(dequeue->buffer, entries + first_block_size, \
+        (num_entries - first_block_size) * value_size); \
+    dequeue->size += num_entries; \
+} \
+ \
+/* Entries are copied to 'out' unless it is NULL */ \
+static void knut_dequeue_##TYPE_NAME##_pop_front_slice(knut_dequeue_##TYPE_NAME##_t* dequeue, \
+    TYPE* out, uint64_t num_entries) \
+{ \
+    KNUT_ASSERT(dequeue->size >= num_entries, \
+        "[knut_dequeue_" #TYPE_NAME "_pop_front_slice] Can't pop slice of that size"); \
  \
-    if (knut_dequeue_##TYPE_NAME##_is_empty(dequeue)) \
+    if (out != NULL) \
     { \
-        dequeue->front = 0; \
-        dequeue->back = 0; \
+        const size_t value_size = sizeof(*dequeue->buffer); \
+        const uint64_t first_block_size = dequeue->mirrored || \
+            num_entries < dequeue->capacity - dequeue->front ? \
+            num_entries : dequeue->capacity - dequeue->front; \
+        memcpy(out, dequeue->buffer + dequeue->front, first_block_size * value_size); \
+        memcpy(out + first_block_size, dequeue->buffer, \
+            (num_entries - first_block_size) * value_size); \
     } \
+ \
+    dequeue->front = (dequeue->front + num_entries) & (dequeue->capacity - 1); \
+    dequeue->size -= num_entries; \
+} \
+ \
+/* Contiguous view of 'count' entries starting at 'pos', can only cross the wrap if mirrored */ \
+static TYPE* knut_dequeue_##TYPE_NAME##_window(const knut_dequeue_##TYPE_NAME##_t* dequeue, \
+    uint64_t pos, uint64_t count) \
+{ \
+    KNUT_ASSERT(pos + count <= dequeue->size, \
+        "[knut_dequeue_" #TYPE_NAME "_window] Window out of bounds"); \
+    const uint64_t start = (dequeue->front + pos) & (dequeue->capacity - 1); \
+    KNUT_ASSERT(dequeue->mirrored || start + count <= dequeue->capacity, \
+        "[knut_dequeue_" #TYPE_NAME "_window] Window wraps around unmirrored buffer"); \
+    return dequeue->buffer + start; \
 } \
  \
 static void knut_dequeue_##TYPE_NAME##_clear(knut_dequeue_##TYPE_NAME##_t* dequeue) \
 { \
     dequeue->size = 0; \
     dequeue->front = 0; \
-    dequeue->back = 0; \
 } \
  \
 static void knut_dequeue_##TYPE_NAME##_foreach(knut_dequeue_##TYPE_NAME##_t* dequeue, \
     void(*callback)(TYPE*)) \
 { \
-    if (knut_dequeue_##TYPE_NAME##_is_empty(dequeue)) \
-    { \
-        return; \
-    } \
- \
-    if (dequeue->front > dequeue->back) \
-    { \
-        for (uint64_t i = dequeue->front; i < dequeue->capacity; ++i) \
-        { \
-            callback(&dequeue->buffer[i]); \
-        } \
- \
-        for (uint64_t i = 0; i <= dequeue->back; ++i) \
-        { \
-            callback(&dequeue->buffer[i]); \
-        } \
-    } \
-    else \
+    TYPE* element; \
+    KNUT_DEQUEUE_FOREACH(dequeue, element) \
     { \
-        for (uint64_t i = dequeue->front; i <= dequeue->back; ++i) \
-        { \
-            callback(&dequeue->buffer[i]); \
-        } \
+        callback(element); \
     } \
 } \
 
+/* Iterates front to back without indirect calls, 'element' is a pointer declared by the caller */
+#define KNUT_DEQUEUE_FOREACH(dequeue, element) \
+    for (uint64_t knut_foreach_i = 0; knut_foreach_i < (dequeue)->size && \
+        ((element) = &(dequeue)->buffer[ \
+            ((dequeue)->front + knut_foreach_i) & ((dequeue)->capacity - 1)], true); \
+        ++knut_foreach_i)
+
 KNUT_DEFINE_DEQUEUE(float, float)
 KNUT_DEFINE_DEQUEUE(int, int)
 KNUT_DEFINE_DEQUEUE(uint8_t, u8)
@@ -355,25 +724,1618 @@ KNUT_DEFINE_DEQUEUE(uint16_t, u16)
 KNUT_DEFINE_DEQUEUE(uint32_t, u32)
 KNUT_DEFINE_DEQUEUE(uint64_t, u64)
 
-#ifdef __cplusplus
-}
-#endif
-
-#endif // KNUT_DS_INCLUDE_H
-
-// ==============================================================================
-// ==============================================================================
-// ==============================================================================
-// ==============================================================================
-// ==============================================================================
-// ==============================================================================
-
-#if defined(KNUT_DS_IMPLEMENTATION) && !defined(KNUT_DS_IMPLEMENTATION_DONE)
-#define KNUT_DS_IMPLEMENTATION_DONE
+#define KNUT_HEAP_LESS(a, b) ((a) < (b))
+#define KNUT_HEAP_GREATER(a, b) ((a) > (b))
+#define KNUT_HEAP_INVALID_POSITION UINT64_MAX
 
-#ifdef __cplusplus
-extern "C" {
-#endif
+/* 4-ary heap, IS_BEFORE(a, b) is true if a has to come out before b. Every push hands out a
+ * handle that stays valid until its entry is popped and can be used for decrease_key. */
+#define KNUT_DEFINE_HEAP(TYPE, TYPE_NAME, IS_BEFORE) \
+typedef struct { \
+    TYPE value; \
+    uint64_t handle; \
+} knut_heap_##TYPE_NAME##_entry_t; \
+\
+typedef struct { \
+    knut_heap_##TYPE_NAME##_entry_t* entries; \
+    uint64_t size; \
+    uint64_t capacity; \
+    uint64_t* positions; \
+    uint64_t num_handles; \
+    uint64_t handles_capacity; \
+    knut_array_u64_t free_handles; \
+} knut_heap_##TYPE_NAME##_t; \
+\
+static knut_heap_##TYPE_NAME##_t knut_heap_##TYPE_NAME##_create(uint64_t capacity) \
+{ \
+    knut_heap_##TYPE_NAME##_t heap = { 0 }; \
+    heap.free_handles = knut_array_u64_create_with(0, NULL); \
+    if (capacity > 0) \
+    { \
+        heap.entries = (knut_heap_##TYPE_NAME##_entry_t*)malloc(capacity * \
+            sizeof(*heap.entries)); \
+        heap.positions = (uint64_t*)malloc(capacity * sizeof(*heap.positions)); \
+        KNUT_ASSERT(heap.entries && heap.positions, \
+            "[knut_heap_" #TYPE_NAME "_create] Failed to alloc buffers\n"); \
+        heap.capacity = capacity; \
+        heap.handles_capacity = capacity; \
+    } \
+    return heap; \
+} \
+\
+static void knut_heap_##TYPE_NAME##_destroy(knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    free(heap->entries); \
+    free(heap->positions); \
+    knut_array_u64_destroy(&heap->free_handles); \
+    memset(heap, 0, sizeof(*heap)); \
+} \
+\
+static void knut_heap_##TYPE_NAME##_clear(knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    heap->size = 0; \
+    heap->num_handles = 0; \
+    knut_array_u64_clear(&heap->free_handles); \
+} \
+\
+static uint64_t knut_heap_##TYPE_NAME##_size(const knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    return heap->size; \
+} \
+\
+static bool knut_heap_##TYPE_NAME##_is_empty(const knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    return heap->size == 0; \
+} \
+\
+static void knut_heap_##TYPE_NAME##_reserve(knut_heap_##TYPE_NAME##_t* heap, uint64_t capacity) \
+{ \
+    if (capacity > heap->capacity) \
+    { \
+        uint64_t new_capacity = heap->capacity == 0 ? 8 : heap->capacity; \
+        while (new_capacity < capacity) { new_capacity *= 2; } \
+        heap->entries = (knut_heap_##TYPE_NAME##_entry_t*)realloc(heap->entries, \
+            new_capacity * sizeof(*heap->entries)); \
+        KNUT_ASSERT(heap->entries, \
+            "[knut_heap_" #TYPE_NAME "_reserve] Failed to alloc entries\n"); \
+        heap->capacity = new_capacity; \
+    } \
+} \
+\
+static uint64_t knut_heap_##TYPE_NAME##_new_handle(knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    if (!knut_array_u64_is_empty(&heap->free_handles)) \
+    { \
+        const uint64_t handle = heap->free_handles.buffer[heap->free_handles.size - 1]; \
+        knut_array_u64_pop(&heap->free_handles); \
+        return handle; \
+    } \
+\
+    if (heap->num_handles == heap->handles_capacity) \
+    { \
+        heap->handles_capacity = heap->handles_capacity == 0 ? 8 : 2 * heap->handles_capacity; \
+        heap->positions = (uint64_t*)realloc(heap->positions, \
+            heap->handles_capacity * sizeof(*heap->positions)); \
+        KNUT_ASSERT(heap->positions, \
+            "[knut_heap_" #TYPE_NAME "_new_handle] Failed to alloc handles\n"); \
+    } \
+\
+    return heap->num_handles++; \
+} \
+\
+static void knut_heap_##TYPE_NAME##_place(knut_heap_##TYPE_NAME##_t* heap, uint64_t pos, \
+    knut_heap_##TYPE_NAME##_entry_t entry) \
+{ \
+    heap->entries[pos] = entry; \
+    heap->positions[entry.handle] = pos; \
+} \
+\
+static void knut_heap_##TYPE_NAME##_sift_up(knut_heap_##TYPE_NAME##_t* heap, uint64_t pos) \
+{ \
+    const knut_heap_##TYPE_NAME##_entry_t entry = heap->entries[pos]; \
+\
+    while (pos > 0) \
+    { \
+        const uint64_t parent = (pos - 1) / 4; \
+        if (!(IS_BEFORE(entry.value, heap->entries[parent].value))) \
+        { \
+            break; \
+        } \
+        knut_heap_##TYPE_NAME##_place(heap, pos, heap->entries[parent]); \
+        pos = parent; \
+    } \
+\
+    knut_heap_##TYPE_NAME##_place(heap, pos, entry); \
+} \
+\
+static void knut_heap_##TYPE_NAME##_sift_down(knut_heap_##TYPE_NAME##_t* heap, uint64_t pos) \
+{ \
+    const knut_heap_##TYPE_NAME##_entry_t entry = heap->entries[pos]; \
+\
+    while (true) \
+    { \
+        const uint64_t first_child = 4 * pos + 1; \
+        if (first_child >= heap->size) \
+        { \
+            break; \
+        } \
+\
+        const uint64_t last_child = first_child + 4 < heap->size ? first_child + 4 : heap->size; \
+        uint64_t best = first_child; \
+        for (uint64_t child = first_child + 1; child < last_child; ++child) \
+        { \
+            if (IS_BEFORE(heap->entries[child].value, heap->entries[best].value)) \
+            { \
+                best = child; \
+            } \
+        } \
+\
+        if (!(IS_BEFORE(heap->entries[best].value, entry.value))) \
+        { \
+            break; \
+        } \
+        knut_heap_##TYPE_NAME##_place(heap, pos, heap->entries[best]); \
+        pos = best; \
+    } \
+\
+    knut_heap_##TYPE_NAME##_place(heap, pos, entry); \
+} \
+\
+static void knut_heap_##TYPE_NAME##_append(knut_heap_##TYPE_NAME##_t* heap, \
+    const TYPE* values, uint64_t num_values, uint64_t* handles) \
+{ \
+    knut_heap_##TYPE_NAME##_reserve(heap, heap->size + num_values); \
+\
+    for (uint64_t i = 0; i < num_values; ++i) \
+    { \
+        const knut_heap_##TYPE_NAME##_entry_t entry = { \
+            values[i], knut_heap_##TYPE_NAME##_new_handle(heap) \
+        }; \
+        knut_heap_##TYPE_NAME##_place(heap, heap->size++, entry); \
+        if (handles != NULL) { handles[i] = entry.handle; } \
+    } \
+} \
+\
+static void knut_heap_##TYPE_NAME##_rebuild(knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    if (heap->size < 2) \
+    { \
+        return; \
+    } \
+\
+    for (uint64_t pos = (heap->size - 2) / 4 + 1; pos-- > 0;) \
+    { \
+        knut_heap_##TYPE_NAME##_sift_down(heap, pos); \
+    } \
+} \
+\
+static uint64_t knut_heap_##TYPE_NAME##_push(knut_heap_##TYPE_NAME##_t* heap, TYPE value) \
+{ \
+    uint64_t handle; \
+    knut_heap_##TYPE_NAME##_append(heap, &value, 1, &handle); \
+    knut_heap_##TYPE_NAME##_sift_up(heap, heap->size - 1); \
+    return handle; \
+} \
+\
+/* Handles are written to 'handles' if it isn't NULL, large batches rebuild the whole heap */ \
+static void knut_heap_##TYPE_NAME##_push_slice(knut_heap_##TYPE_NAME##_t* heap, \
+    const TYPE* values, uint64_t num_values, uint64_t* handles) \
+{ \
+    const uint64_t old_size = heap->size; \
+    knut_heap_##TYPE_NAME##_append(heap, values, num_values, handles); \
+\
+    if (num_values > old_size) \
+    { \
+        knut_heap_##TYPE_NAME##_rebuild(heap); \
+        return; \
+    } \
+\
+    for (uint64_t pos = old_size; pos < heap->size; ++pos) \
+    { \
+        knut_heap_##TYPE_NAME##_sift_up(heap, pos); \
+    } \
+} \
+\
+/* Builds the heap in linear time, e.g. from the buffer of a knut_array */ \
+static knut_heap_##TYPE_NAME##_t knut_heap_##TYPE_NAME##_heapify(const TYPE* values, \
+    uint64_t num_values) \
+{ \
+    knut_heap_##TYPE_NAME##_t heap = knut_heap_##TYPE_NAME##_create(num_values); \
+    knut_heap_##TYPE_NAME##_append(&heap, values, num_values, NULL); \
+    knut_heap_##TYPE_NAME##_rebuild(&heap); \
+    return heap; \
+} \
+\
+static TYPE knut_heap_##TYPE_NAME##_top(const knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    KNUT_ASSERT(heap->size > 0, "[knut_heap_" #TYPE_NAME "_top] Heap is empty\n"); \
+    return heap->entries[0].value; \
+} \
+\
+static uint64_t knut_heap_##TYPE_NAME##_top_handle(const knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    KNUT_ASSERT(heap->size > 0, "[knut_heap_" #TYPE_NAME "_top_handle] Heap is empty\n"); \
+    return heap->entries[0].handle; \
+} \
+\
+static TYPE knut_heap_##TYPE_NAME##_pop(knut_heap_##TYPE_NAME##_t* heap) \
+{ \
+    KNUT_ASSERT(heap->size > 0, "[knut_heap_" #TYPE_NAME "_pop] Heap is empty\n"); \
+    const knut_heap_##TYPE_NAME##_entry_t top = heap->entries[0]; \
+    heap->positions[top.handle] = KNUT_HEAP_INVALID_POSITION; \
+    knut_array_u64_push(&heap->free_handles, top.handle); \
+\
+    if (--heap->size > 0) \
+    { \
+        knut_heap_##TYPE_NAME##_place(heap, 0, heap->entries[heap->size]); \
+        knut_heap_##TYPE_NAME##_sift_down(heap, 0); \
+    } \
+\
+    return top.value; \
+} \
+\
+static bool knut_heap_##TYPE_NAME##_contains(const knut_heap_##TYPE_NAME##_t* heap, \
+    uint64_t handle) \
+{ \
+    return handle < heap->num_handles && \
+        heap->positions[handle] != KNUT_HEAP_INVALID_POSITION; \
+} \
+\
+static TYPE knut_heap_##TYPE_NAME##_get(const knut_heap_##TYPE_NAME##_t* heap, uint64_t handle) \
+{ \
+    KNUT_ASSERT(knut_heap_##TYPE_NAME##_contains(heap, handle), \
+        "[knut_heap_" #TYPE_NAME "_get] Invalid handle\n"); \
+    return heap->entries[heap->positions[handle]].value; \
+} \
+\
+/* The new value must not come out later than the old one */ \
+static void knut_heap_##TYPE_NAME##_decrease_key(knut_heap_##TYPE_NAME##_t* heap, \
+    uint64_t handle, TYPE value) \
+{ \
+    KNUT_ASSERT(knut_heap_##TYPE_NAME##_contains(heap, handle), \
+        "[knut_heap_" #TYPE_NAME "_decrease_key] Invalid handle\n"); \
+    const uint64_t pos = heap->positions[handle]; \
+    KNUT_ASSERT(!(IS_BEFORE(heap->entries[pos].value, value)), \
+        "[knut_heap_" #TYPE_NAME "_decrease_key] Key can only move towards the top\n"); \
+    heap->entries[pos].value = value; \
+    knut_heap_##TYPE_NAME##_sift_up(heap, pos); \
+} \
+
+KNUT_DEFINE_HEAP(uint64_t, u64_min, KNUT_HEAP_LESS)
+KNUT_DEFINE_HEAP(uint64_t, u64_max, KNUT_HEAP_GREATER)
+
+typedef struct knut_pool_free_node_t {
+    struct knut_pool_free_node_t* next;
+} knut_pool_free_node_t;
+
+/* Fixed-size objects carved out of slabs, freed objects are kept on an intrusive free list */
+typedef struct {
+    uint64_t object_size;
+    uint64_t alignment;
+    uint64_t objects_per_slab;
+    void** slabs;
+    uint64_t num_slabs;
+    uint64_t slabs_capacity;
+    uint64_t current_slab;
+    uint64_t next_object;
+    knut_pool_free_node_t* free_list;
+    atomic_flag lock;
+} knut_pool_t;
+
+/* Per-thread cache that takes objects from and returns objects to the pool in batches */
+typedef struct {
+    knut_pool_t* pool;
+    knut_pool_free_node_t* free_list;
+    uint64_t size;
+    uint64_t batch_size;
+} knut_pool_cache_t;
+
+void knut_pool_init(knut_pool_t* pool, uint64_t object_size, uint64_t alignment, 
+    uint64_t objects_per_slab);
+void knut_pool_destroy(knut_pool_t* pool);
+void* knut_pool_alloc(knut_pool_t* pool);
+void knut_pool_free(knut_pool_t* pool, void* object);
+void knut_pool_free_slice(knut_pool_t* pool, void** objects, uint64_t num_objects);
+void knut_pool_release_all(knut_pool_t* pool);
+
+void knut_pool_cache_init(knut_pool_cache_t* cache, knut_pool_t* pool, uint64_t batch_size);
+void* knut_pool_cache_alloc(knut_pool_cache_t* cache);
+void knut_pool_cache_free(knut_pool_cache_t* cache, void* object);
+void knut_pool_cache_flush(knut_pool_cache_t* cache);
+
+/* Every allocation has to fit into a single pool object */
+knut_allocator_t knut_allocator_pool(knut_pool_t* pool, knut_allocator_stats_t* stats);
+
+#define KNUT_DEFINE_POOL(TYPE, TYPE_NAME) \
+typedef struct { \
+    knut_pool_t pool; \
+} knut_pool_##TYPE_NAME##_t; \
+\
+typedef struct { \
+    knut_pool_cache_t cache; \
+} knut_pool_##TYPE_NAME##_cache_t; \
+\
+static void knut_pool_##TYPE_NAME##_init(knut_pool_##TYPE_NAME##_t* pool, \
+    uint64_t objects_per_slab) \
+{ \
+    knut_pool_init(&pool->pool, sizeof(TYPE), _Alignof(TYPE), objects_per_slab); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_destroy(knut_pool_##TYPE_NAME##_t* pool) \
+{ \
+    knut_pool_destroy(&pool->pool); \
+} \
+\
+static TYPE* knut_pool_##TYPE_NAME##_alloc(knut_pool_##TYPE_NAME##_t* pool) \
+{ \
+    return (TYPE*)knut_pool_alloc(&pool->pool); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_free(knut_pool_##TYPE_NAME##_t* pool, TYPE* object) \
+{ \
+    knut_pool_free(&pool->pool, object); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_free_slice(knut_pool_##TYPE_NAME##_t* pool, \
+    TYPE** objects, uint64_t num_objects) \
+{ \
+    knut_pool_free_slice(&pool->pool, (void**)objects, num_objects); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_release_all(knut_pool_##TYPE_NAME##_t* pool) \
+{ \
+    knut_pool_release_all(&pool->pool); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_cache_init(knut_pool_##TYPE_NAME##_cache_t* cache, \
+    knut_pool_##TYPE_NAME##_t* pool, uint64_t batch_size) \
+{ \
+    knut_pool_cache_init(&cache->cache, &pool->pool, batch_size); \
+} \
+\
+static TYPE* knut_pool_##TYPE_NAME##_cache_alloc(knut_pool_##TYPE_NAME##_cache_t* cache) \
+{ \
+    return (TYPE*)knut_pool_cache_alloc(&cache->cache); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_cache_free(knut_pool_##TYPE_NAME##_cache_t* cache, \
+    TYPE* object) \
+{ \
+    knut_pool_cache_free(&cache->cache, object); \
+} \
+\
+static void knut_pool_##TYPE_NAME##_cache_flush(knut_pool_##TYPE_NAME##_cache_t* cache) \
+{ \
+    knut_pool_cache_flush(&cache->cache); \
+} \
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KNUT_DS_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_DS_IMPLEMENTATION) && !defined(KNUT_DS_IMPLEMENTATION_DONE)
+#define KNUT_DS_IMPLEMENTATION_DONE
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#pragma comment(lib, "onecore.lib")
+
+#else
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif
+
+#ifdef KNUT_ARCH_X86
+#include <immintrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define KNUT_HUGE_PAGE_SIZE (2ull * 1024 * 1024)
+
+#ifdef _WIN32
+
+void* knut_mirror_alloc(uint64_t size)
+{
+    KNUT_ASSERT(size % knut_mirror_granularity() == 0, 
+        "[knut_mirror_alloc] Size must be a multiple of the granularity\n");
+
+    char* placeholder = (char*)VirtualAlloc2(NULL, NULL, 2 * size, 
+        MEM_RESERVE | MEM_RESERVE_PLACEHOLDER, PAGE_NOACCESS, NULL, 0);
+
+    if (placeholder == NULL)
+    {
+        return NULL;
+    }
+
+    VirtualFree(placeholder, size, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER);
+
+    HANDLE section = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 
+        (DWORD)(size >> 32), (DWORD)size, NULL);
+
+    if (section == NULL)
+    {
+        VirtualFree(placeholder, 0, MEM_RELEASE);
+        VirtualFree(placeholder + size, 0, MEM_RELEASE);
+        return NULL;
+    }
+
+    void* first = MapViewOfFile3(section, NULL, placeholder, 0, size, MEM_REPLACE_PLACEHOLDER, 
+        PAGE_READWRITE, NULL, 0);
+    void* second = MapViewOfFile3(section, NULL, placeholder + size, 0, size, 
+        MEM_REPLACE_PLACEHOLDER, PAGE_READWRITE, NULL, 0);
+    CloseHandle(section);
+
+    if (first == NULL || second == NULL)
+    {
+        if (first) { UnmapViewOfFile(first); } else { VirtualFree(placeholder, 0, MEM_RELEASE); }
+        if (second) { UnmapViewOfFile(second); } 
+        else { VirtualFree(placeholder + size, 0, MEM_RELEASE); }
+        return NULL;
+    }
+
+    return placeholder;
+}
+
+void knut_mirror_free(void* ptr, uint64_t size)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    UnmapViewOfFile(ptr);
+    UnmapViewOfFile((char*)ptr + size);
+}
+
+uint64_t knut_mirror_granularity()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+static uint64_t knut_huge_round_size(uint64_t size)
+{
+    const uint64_t granularity = size >= KNUT_HUGE_PAGE_SIZE ? KNUT_HUGE_PAGE_SIZE : 4096;
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+void* knut_huge_alloc(uint64_t size)
+{
+    return VirtualAlloc(NULL, knut_huge_round_size(size), MEM_RESERVE | MEM_COMMIT, 
+        PAGE_READWRITE);
+}
+
+/* Windows can't move committed pages, so growing copies and shrinking decommits the tail */
+void* knut_huge_realloc(void* ptr, uint64_t old_size, uint64_t new_size)
+{
+    if (ptr == NULL)
+    {
+        return new_size > 0 ? knut_huge_alloc(new_size) : NULL;
+    }
+
+    if (new_size == 0)
+    {
+        knut_huge_free(ptr, old_size);
+        return NULL;
+    }
+
+    old_size = knut_huge_round_size(old_size);
+    new_size = knut_huge_round_size(new_size);
+
+    if (new_size <= old_size)
+    {
+        if (new_size < old_size)
+        {
+            VirtualFree((char*)ptr + new_size, old_size - new_size, MEM_DECOMMIT);
+        }
+        return ptr;
+    }
+
+    void* new_ptr = knut_huge_alloc(new_size);
+
+    if (new_ptr != NULL)
+    {
+        memcpy(new_ptr, ptr, old_size);
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+
+    return new_ptr;
+}
+
+void knut_huge_free(void* ptr, uint64_t size)
+{
+    (void)size;
+
+    if (ptr != NULL)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+}
+
+#else
+
+void* knut_mirror_alloc(uint64_t size)
+{
+    KNUT_ASSERT(size % knut_mirror_granularity() == 0, 
+        "[knut_mirror_alloc] Size must be a multiple of the granularity\n");
+
+#ifdef __linux__
+    const int fd = memfd_create("knut_mirror", MFD_CLOEXEC);
+#else
+    char name[64];
+    snprintf(name, sizeof(name), "/knut_mirror_%ld", (long)getpid());
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd != -1) { shm_unlink(name); }
+#endif
+
+    if (fd == -1)
+    {
+        return NULL;
+    }
+
+    char* base = MAP_FAILED;
+
+    if (ftruncate(fd, (off_t)size) == 0)
+    {
+        base = (char*)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+
+    if (base != MAP_FAILED && (
+        mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == 
+            MAP_FAILED))
+    {
+        munmap(base, 2 * size);
+        base = MAP_FAILED;
+    }
+
+    close(fd);
+
+    return base != MAP_FAILED ? base : NULL;
+}
+
+void knut_mirror_free(void* ptr, uint64_t size)
+{
+    if (ptr != NULL)
+    {
+        munmap(ptr, 2 * size);
+    }
+}
+
+uint64_t knut_mirror_granularity()
+{
+    return (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+static uint64_t knut_huge_round_size(uint64_t size)
+{
+    const uint64_t granularity = size >= KNUT_HUGE_PAGE_SIZE ? 
+        KNUT_HUGE_PAGE_SIZE : (uint64_t)sysconf(_SC_PAGESIZE);
+    return (size + granularity - 1) & ~(granularity - 1);
+}
+
+static void knut_huge_advise(void* ptr, uint64_t size)
+{
+#ifdef MADV_HUGEPAGE
+    if (size >= KNUT_HUGE_PAGE_SIZE)
+    {
+        madvise(ptr, size, MADV_HUGEPAGE);
+    }
+#else
+    (void)ptr; (void)size;
+#endif
+}
+
+void* knut_huge_alloc(uint64_t size)
+{
+    size = knut_huge_round_size(size);
+    void* ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (ptr == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    knut_huge_advise(ptr, size);
+    return ptr;
+}
+
+/* On Linux the pages are remapped in place or moved without copying their contents */
+void* knut_huge_realloc(void* ptr, uint64_t old_size, uint64_t new_size)
+{
+    if (ptr == NULL)
+    {
+        return new_size > 0 ? knut_huge_alloc(new_size) : NULL;
+    }
+
+    if (new_size == 0)
+    {
+        knut_huge_free(ptr, old_size);
+        return NULL;
+    }
+
+    old_size = knut_huge_round_size(old_size);
+    new_size = knut_huge_round_size(new_size);
+
+    if (new_size == old_size)
+    {
+        return ptr;
+    }
+
+#ifdef __linux__
+    void* new_ptr = mremap(ptr, old_size, new_size, MREMAP_MAYMOVE);
+
+    if (new_ptr == MAP_FAILED)
+    {
+        return NULL;
+    }
+#else
+    if (new_size < old_size)
+    {
+        munmap((char*)ptr + new_size, old_size - new_size);
+        return ptr;
+    }
+
+    void* new_ptr = knut_huge_alloc(new_size);
+
+    if (new_ptr == NULL)
+    {
+        return NULL;
+    }
+
+    memcpy(new_ptr, ptr, old_size);
+    munmap(ptr, old_size);
+#endif
+
+    if (new_size > old_size)
+    {
+        knut_huge_advise(new_ptr, new_size);
+    }
+
+    return new_ptr;
+}
+
+void knut_huge_free(void* ptr, uint64_t size)
+{
+    if (ptr != NULL)
+    {
+        munmap(ptr, knut_huge_round_size(size));
+    }
+}
+
+#endif // ifdef _WIN32
+
+static void knut_pool_lock(knut_pool_t* pool)
+{
+    while (atomic_flag_test_and_set_explicit(&pool->lock, memory_order_acquire)) {}
+}
+
+static void knut_pool_unlock(knut_pool_t* pool)
+{
+    atomic_flag_clear_explicit(&pool->lock, memory_order_release);
+}
+
+void knut_pool_init(knut_pool_t* pool, uint64_t object_size, uint64_t alignment, 
+    uint64_t objects_per_slab)
+{
+    KNUT_ASSERT(objects_per_slab > 0, "[knut_pool_init] Slabs can't be empty\n");
+    KNUT_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, 
+        "[knut_pool_init] Alignment must be a power of two\n");
+
+    const uint64_t node_alignment = _Alignof(knut_pool_free_node_t);
+    alignment = alignment > node_alignment ? alignment : node_alignment;
+    object_size = object_size > sizeof(knut_pool_free_node_t) ? 
+        object_size : sizeof(knut_pool_free_node_t);
+
+    memset(pool, 0, sizeof(*pool));
+    pool->object_size = (object_size + alignment - 1) & ~(alignment - 1);
+    pool->alignment = alignment;
+    pool->objects_per_slab = objects_per_slab;
+    atomic_flag_clear(&pool->lock);
+}
+
+void knut_pool_destroy(knut_pool_t* pool)
+{
+    for (uint64_t i = 0; i < pool->num_slabs; ++i)
+    {
+        free(pool->slabs[i]);
+    }
+
+    free(pool->slabs);
+    memset(pool, 0, sizeof(*pool));
+}
+
+static char* knut_pool_slab_start(const knut_pool_t* pool, uint64_t slab)
+{
+    const uintptr_t raw = (uintptr_t)pool->slabs[slab];
+    return (char*)((raw + pool->alignment - 1) & ~(uintptr_t)(pool->alignment - 1));
+}
+
+/* Expects the pool to be locked */
+static void* knut_pool_alloc_locked(knut_pool_t* pool)
+{
+    if (pool->free_list != NULL)
+    {
+        knut_pool_free_node_t* node = pool->free_list;
+        pool->free_list = node->next;
+        return node;
+    }
+
+    if (pool->current_slab < pool->num_slabs && pool->next_object == pool->objects_per_slab)
+    {
+        ++pool->current_slab;
+        pool->next_object = 0;
+    }
+
+    if (pool->current_slab == pool->num_slabs)
+    {
+        if (pool->num_slabs == pool->slabs_capacity)
+        {
+            pool->slabs_capacity = pool->slabs_capacity == 0 ? 8 : 2 * pool->slabs_capacity;
+            pool->slabs = (void**)realloc(pool->slabs, pool->slabs_capacity * sizeof(void*));
+            KNUT_ASSERT(pool->slabs, "[knut_pool_alloc] Failed to alloc slab list\n");
+        }
+
+        void* slab = malloc(pool->objects_per_slab * pool->object_size + pool->alignment);
+        KNUT_ASSERT(slab, "[knut_pool_alloc] Failed to alloc slab\n");
+        pool->slabs[pool->num_slabs++] = slab;
+        pool->next_object = 0;
+    }
+
+    return knut_pool_slab_start(pool, pool->current_slab) + 
+        pool->next_object++ * pool->object_size;
+}
+
+void* knut_pool_alloc(knut_pool_t* pool)
+{
+    knut_pool_lock(pool);
+    void* object = knut_pool_alloc_locked(pool);
+    knut_pool_unlock(pool);
+    return object;
+}
+
+void knut_pool_free(knut_pool_t* pool, void* object)
+{
+    knut_pool_free_slice(pool, &object, 1);
+}
+
+void knut_pool_free_slice(knut_pool_t* pool, void** objects, uint64_t num_objects)
+{
+    if (num_objects == 0)
+    {
+        return;
+    }
+
+    for (uint64_t i = 0; i + 1 < num_objects; ++i)
+    {
+        ((knut_pool_free_node_t*)objects[i])->next = (knut_pool_free_node_t*)objects[i + 1];
+    }
+
+    knut_pool_free_node_t* last = (knut_pool_free_node_t*)objects[num_objects - 1];
+
+    knut_pool_lock(pool);
+    last->next = pool->free_list;
+    pool->free_list = (knut_pool_free_node_t*)objects[0];
+    knut_pool_unlock(pool);
+}
+
+/* Returns every object to the pool at once, slabs are kept for reuse */
+void knut_pool_release_all(knut_pool_t* pool)
+{
+    knut_pool_lock(pool);
+    pool->free_list = NULL;
+    pool->current_slab = 0;
+    pool->next_object = 0;
+    knut_pool_unlock(pool);
+}
+
+void knut_pool_cache_init(knut_pool_cache_t* cache, knut_pool_t* pool, uint64_t batch_size)
+{
+    KNUT_ASSERT(batch_size > 0, "[knut_pool_cache_init] Batch size can't be 0\n");
+    cache->pool = pool;
+    cache->free_list = NULL;
+    cache->size = 0;
+    cache->batch_size = batch_size;
+}
+
+void* knut_pool_cache_alloc(knut_pool_cache_t* cache)
+{
+    if (cache->free_list == NULL)
+    {
+        knut_pool_lock(cache->pool);
+
+        for (uint64_t i = 0; i < cache->batch_size; ++i)
+        {
+            knut_pool_free_node_t* node = 
+                (knut_pool_free_node_t*)knut_pool_alloc_locked(cache->pool);
+            node->next = cache->free_list;
+            cache->free_list = node;
+        }
+
+        knut_pool_unlock(cache->pool);
+        cache->size = cache->batch_size;
+    }
+
+    knut_pool_free_node_t* node = cache->free_list;
+    cache->free_list = node->next;
+    --cache->size;
+    return node;
+}
+
+void knut_pool_cache_free(knut_pool_cache_t* cache, void* object)
+{
+    knut_pool_free_node_t* node = (knut_pool_free_node_t*)object;
+    node->next = cache->free_list;
+    cache->free_list = node;
+    ++cache->size;
+
+    if (cache->size < 2 * cache->batch_size)
+    {
+        return;
+    }
+
+    knut_pool_free_node_t* last = cache->free_list;
+
+    for (uint64_t i = 1; i < cache->batch_size; ++i)
+    {
+        last = last->next;
+    }
+
+    knut_pool_free_node_t* batch = cache->free_list;
+    cache->free_list = last->next;
+    cache->size -= cache->batch_size;
+
+    knut_pool_lock(cache->pool);
+    last->next = cache->pool->free_list;
+    cache->pool->free_list = batch;
+    knut_pool_unlock(cache->pool);
+}
+
+void knut_pool_cache_flush(knut_pool_cache_t* cache)
+{
+    if (cache->free_list == NULL)
+    {
+        return;
+    }
+
+    knut_pool_free_node_t* last = cache->free_list;
+
+    while (last->next != NULL)
+    {
+        last = last->next;
+    }
+
+    knut_pool_lock(cache->pool);
+    last->next = cache->pool->free_list;
+    cache->pool->free_list = cache->free_list;
+    knut_pool_unlock(cache->pool);
+
+    cache->free_list = NULL;
+    cache->size = 0;
+}
+
+static void knut_allocator_account(knut_allocator_stats_t* stats, uint64_t old_size, 
+    uint64_t new_size, uint64_t copied_bytes)
+{
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    stats->live_bytes = stats->live_bytes - old_size + new_size;
+    stats->peak_bytes = stats->live_bytes > stats->peak_bytes ? 
+        stats->live_bytes : stats->peak_bytes;
+    stats->realloc_copy_bytes += copied_bytes;
+
+    if (new_size > 0)
+    {
+        ++stats->num_allocations;
+    }
+}
+
+void* knut_allocator_alloc(const knut_allocator_t* allocator, uint64_t size)
+{
+    if (allocator == NULL)
+    {
+        return malloc(size);
+    }
+
+    void* ptr = allocator->alloc(allocator->ctx, size);
+
+    if (ptr != NULL)
+    {
+        knut_allocator_account(allocator->stats, 0, size, 0);
+    }
+
+    return ptr;
+}
+
+void* knut_allocator_realloc(const knut_allocator_t* allocator, void* ptr, uint64_t old_size, 
+    uint64_t new_size)
+{
+    if (ptr == NULL)
+    {
+        return new_size > 0 ? knut_allocator_alloc(allocator, new_size) : NULL;
+    }
+
+    if (new_size == 0)
+    {
+        knut_allocator_free(allocator, ptr, old_size);
+        return NULL;
+    }
+
+    if (allocator == NULL)
+    {
+        return realloc(ptr, new_size);
+    }
+
+    uint64_t copied_bytes = 0;
+    void* new_ptr = allocator->realloc(allocator->ctx, ptr, old_size, new_size, &copied_bytes);
+
+    if (new_ptr != NULL)
+    {
+        knut_allocator_account(allocator->stats, old_size, new_size, copied_bytes);
+    }
+
+    return new_ptr;
+}
+
+void knut_allocator_free(const knut_allocator_t* allocator, void* ptr, uint64_t size)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    if (allocator == NULL)
+    {
+        free(ptr);
+        return;
+    }
+
+    allocator->free(allocator->ctx, ptr, size);
+    knut_allocator_account(allocator->stats, size, 0, 0);
+}
+
+static void* knut_malloc_alloc(void* ctx, uint64_t size)
+{
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* knut_malloc_realloc(void* ctx, void* ptr, uint64_t old_size, uint64_t new_size, 
+    uint64_t* copied_bytes)
+{
+    (void)ctx;
+    void* new_ptr = realloc(ptr, new_size);
+
+    if (new_ptr != NULL && new_ptr != ptr)
+    {
+        *copied_bytes = old_size < new_size ? old_size : new_size;
+    }
+
+    return new_ptr;
+}
+
+static void knut_malloc_free(void* ctx, void* ptr, uint64_t size)
+{
+    (void)ctx; (void)size;
+    free(ptr);
+}
+
+knut_allocator_t knut_allocator_malloc(knut_allocator_stats_t* stats)
+{
+    knut_allocator_t allocator = { 
+        knut_malloc_alloc, knut_malloc_realloc, knut_malloc_free, NULL, stats 
+    };
+    return allocator;
+}
+
+static void* knut_huge_allocator_alloc(void* ctx, uint64_t size)
+{
+    (void)ctx;
+    return knut_huge_alloc(size);
+}
+
+static void* knut_huge_allocator_realloc(void* ctx, void* ptr, uint64_t old_size, 
+    uint64_t new_size, uint64_t* copied_bytes)
+{
+    (void)ctx;
+#ifndef __linux__
+    /* Only mremap can move pages, everywhere else growing is a copy */
+    *copied_bytes = new_size > old_size ? old_size : 0;
+#else
+    (void)copied_bytes;
+#endif
+    return knut_huge_realloc(ptr, old_size, new_size);
+}
+
+static void knut_huge_allocator_free(void* ctx, void* ptr, uint64_t size)
+{
+    (void)ctx;
+    knut_huge_free(ptr, size);
+}
+
+knut_allocator_t knut_allocator_huge(knut_allocator_stats_t* stats)
+{
+    knut_allocator_t allocator = { 
+        knut_huge_allocator_alloc, knut_huge_allocator_realloc, knut_huge_allocator_free, 
+        NULL, stats 
+    };
+    return allocator;
+}
+
+const knut_allocator_t* knut_allocator_huge_default()
+{
+    static const knut_allocator_t allocator = { 
+        knut_huge_allocator_alloc, knut_huge_allocator_realloc, knut_huge_allocator_free, 
+        NULL, NULL 
+    };
+    return &allocator;
+}
+
+#define KNUT_ARENA_ALIGNMENT 16ull
+#define KNUT_ARENA_HEADER_SIZE \
+    ((sizeof(knut_arena_chunk_t) + KNUT_ARENA_ALIGNMENT - 1) & ~(KNUT_ARENA_ALIGNMENT - 1))
+
+static char* knut_arena_chunk_data(knut_arena_chunk_t* chunk)
+{
+    return (char*)chunk + KNUT_ARENA_HEADER_SIZE;
+}
+
+void knut_arena_init(knut_arena_t* arena, uint64_t chunk_size)
+{
+    KNUT_ASSERT(chunk_size > 0, "[knut_arena_init] Chunk size can't be 0\n");
+    arena->chunks = NULL;
+    arena->chunk_size = chunk_size;
+    arena->last_allocation = NULL;
+}
+
+void knut_arena_destroy(knut_arena_t* arena)
+{
+    while (arena->chunks != NULL)
+    {
+        knut_arena_chunk_t* next = arena->chunks->next;
+        free(arena->chunks);
+        arena->chunks = next;
+    }
+
+    arena->last_allocation = NULL;
+}
+
+void* knut_arena_alloc(knut_arena_t* arena, uint64_t size)
+{
+    size = (size + KNUT_ARENA_ALIGNMENT - 1) & ~(KNUT_ARENA_ALIGNMENT - 1);
+    knut_arena_chunk_t* chunk = arena->chunks;
+
+    if (chunk == NULL || chunk->size - chunk->used < size)
+    {
+        const uint64_t chunk_size = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = (knut_arena_chunk_t*)malloc(KNUT_ARENA_HEADER_SIZE + chunk_size);
+
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+
+        chunk->next = arena->chunks;
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        arena->chunks = chunk;
+    }
+
+    arena->last_allocation = knut_arena_chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    return arena->last_allocation;
+}
+
+/* Keeps the newest chunk around for the next round of allocations */
+void knut_arena_reset(knut_arena_t* arena)
+{
+    if (arena->chunks == NULL)
+    {
+        return;
+    }
+
+    knut_arena_chunk_t* newest = arena->chunks;
+    arena->chunks = newest->next;
+    knut_arena_destroy(arena);
+    newest->next = NULL;
+    newest->used = 0;
+    arena->chunks = newest;
+}
+
+static void* knut_arena_allocator_alloc(void* ctx, uint64_t size)
+{
+    return knut_arena_alloc((knut_arena_t*)ctx, size);
+}
+
+/* The most recent allocation grows in place while its chunk has room */
+static void* knut_arena_allocator_realloc(void* ctx, void* ptr, uint64_t old_size, 
+    uint64_t new_size, uint64_t* copied_bytes)
+{
+    knut_arena_t* arena = (knut_arena_t*)ctx;
+    knut_arena_chunk_t* chunk = arena->chunks;
+
+    if (ptr == arena->last_allocation)
+    {
+        const uint64_t start = (uint64_t)((char*)ptr - knut_arena_chunk_data(chunk));
+        const uint64_t size = 
+            (new_size + KNUT_ARENA_ALIGNMENT - 1) & ~(KNUT_ARENA_ALIGNMENT - 1);
+
+        if (chunk->size - start >= size)
+        {
+            chunk->used = start + size;
+            return ptr;
+        }
+    }
+
+    if (new_size <= old_size)
+    {
+        return ptr;
+    }
+
+    void* new_ptr = knut_arena_alloc(arena, new_size);
+
+    if (new_ptr != NULL)
+    {
+        memcpy(new_ptr, ptr, old_size);
+        *copied_bytes = old_size;
+    }
+
+    return new_ptr;
+}
+
+static void knut_arena_allocator_free(void* ctx, void* ptr, uint64_t size)
+{
+    (void)size;
+    knut_arena_t* arena = (knut_arena_t*)ctx;
+
+    if (ptr == arena->last_allocation)
+    {
+        arena->chunks->used = (uint64_t)((char*)ptr - knut_arena_chunk_data(arena->chunks));
+        arena->last_allocation = NULL;
+    }
+}
+
+knut_allocator_t knut_allocator_arena(knut_arena_t* arena, knut_allocator_stats_t* stats)
+{
+    knut_allocator_t allocator = { 
+        knut_arena_allocator_alloc, knut_arena_allocator_realloc, knut_arena_allocator_free, 
+        arena, stats 
+    };
+    return allocator;
+}
+
+static void* knut_pool_allocator_alloc(void* ctx, uint64_t size)
+{
+    knut_pool_t* pool = (knut_pool_t*)ctx;
+    KNUT_ASSERT(size <= pool->object_size, 
+        "[knut_pool_allocator_alloc] Allocation doesn't fit into a pool object\n");
+    return knut_pool_alloc(pool);
+}
+
+static void* knut_pool_allocator_realloc(void* ctx, void* ptr, uint64_t old_size, 
+    uint64_t new_size, uint64_t* copied_bytes)
+{
+    (void)old_size; (void)copied_bytes;
+    KNUT_ASSERT(new_size <= ((knut_pool_t*)ctx)->object_size, 
+        "[knut_pool_allocator_realloc] Allocation doesn't fit into a pool object\n");
+    return ptr;
+}
+
+static void knut_pool_allocator_free(void* ctx, void* ptr, uint64_t size)
+{
+    (void)size;
+    knut_pool_free((knut_pool_t*)ctx, ptr);
+}
+
+knut_allocator_t knut_allocator_pool(knut_pool_t* pool, knut_allocator_stats_t* stats)
+{
+    knut_allocator_t allocator = { 
+        knut_pool_allocator_alloc, knut_pool_allocator_realloc, knut_pool_allocator_free, 
+        pool, stats 
+    };
+    return allocator;
+}
+
+
+/* Scalar versions, also used for the tails the vector loops leave over */
+#define KNUT_DEFINE_REDUCE_SCALAR(TYPE, TYPE_NAME, SUM_TYPE) \
+static SUM_TYPE knut_reduce_##TYPE_NAME##_sum_scalar(const TYPE* values, uint64_t size) \
+{ \
+    uint64_t sum = 0; \
+    for (uint64_t i = 0; i < size; ++i) \
+    { \
+        sum += (uint64_t)values[i]; \
+    } \
+    return (SUM_TYPE)sum; \
+} \
+\
+static SUM_TYPE knut_reduce_##TYPE_NAME##_dot_index_scalar(const TYPE* values, uint64_t size, \
+    uint64_t first_index) \
+{ \
+    uint64_t sum = 0; \
+    for (uint64_t i = 0; i < size; ++i) \
+    { \
+        sum += (first_index + i) * (uint64_t)values[i]; \
+    } \
+    return (SUM_TYPE)sum; \
+} \
+\
+static uint64_t knut_reduce_##TYPE_NAME##_abs_diff_scalar(const TYPE* a, const TYPE* b, \
+    uint64_t size) \
+{ \
+    uint64_t sum = 0; \
+    for (uint64_t i = 0; i < size; ++i) \
+    { \
+        sum += a[i] > b[i] ? (uint64_t)a[i] - (uint64_t)b[i] : (uint64_t)b[i] - (uint64_t)a[i]; \
+    } \
+    return sum; \
+} \
+\
+static knut_pair_##TYPE_NAME##_t knut_reduce_##TYPE_NAME##_minmax_step( \
+    knut_pair_##TYPE_NAME##_t minmax, const TYPE* values, uint64_t size) \
+{ \
+    for (uint64_t i = 0; i < size; ++i) \
+    { \
+        minmax.first = values[i] < minmax.first ? values[i] : minmax.first; \
+        minmax.second = values[i] > minmax.second ? values[i] : minmax.second; \
+    } \
+    return minmax; \
+} \
+\
+static knut_pair_##TYPE_NAME##_t knut_reduce_##TYPE_NAME##_minmax_scalar(const TYPE* values, \
+    uint64_t size) \
+{ \
+    KNUT_ASSERT(size > 0, "[knut_reduce_" #TYPE_NAME "_minmax] No values\n"); \
+    knut_pair_##TYPE_NAME##_t minmax = { values[0], values[0] }; \
+    return knut_reduce_##TYPE_NAME##_minmax_step(minmax, values + 1, size - 1); \
+} \
+\
+static uint64_t knut_reduce_##TYPE_NAME##_count_equal_scalar(const TYPE* values, \
+    uint64_t size, TYPE value) \
+{ \
+    uint64_t count = 0; \
+    for (uint64_t i = 0; i < size; ++i) \
+    { \
+        count += values[i] == value ? 1 : 0; \
+    } \
+    return count; \
+} \
+
+KNUT_DEFINE_REDUCE_SCALAR(int32_t, i32, int64_t)
+KNUT_DEFINE_REDUCE_SCALAR(uint32_t, u32, uint64_t)
+KNUT_DEFINE_REDUCE_SCALAR(int64_t, i64, int64_t)
+KNUT_DEFINE_REDUCE_SCALAR(uint64_t, u64, uint64_t)
+
+#ifdef KNUT_ARCH_X86
+
+/* The vector versions widen every lane to 64 bits, so one set of kernels covers all types.
+ * Unsigned 64 bit lanes get their sign bit flipped before comparing, AVX2 only compares
+ * signed. */
+#define KNUT_REDUCE_SIGN_BIAS ((int64_t)0x8000000000000000ull)
+
+#define KNUT_REDUCE_LOAD_I32_SSE42(ptr) _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i*)(ptr)))
+#define KNUT_REDUCE_LOAD_U32_SSE42(ptr) _mm_cvtepu32_epi64(_mm_loadl_epi64((const __m128i*)(ptr)))
+#define KNUT_REDUCE_LOAD_64_SSE42(ptr) _mm_loadu_si128((const __m128i*)(ptr))
+
+#define KNUT_REDUCE_LOAD_I32_AVX2(ptr) \
+    _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)(ptr)))
+#define KNUT_REDUCE_LOAD_U32_AVX2(ptr) \
+    _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)(ptr)))
+#define KNUT_REDUCE_LOAD_64_AVX2(ptr) _mm256_loadu_si256((const __m256i*)(ptr))
+
+KNUT_TARGET_SSE42 static uint64_t knut_reduce_hsum_sse42(__m128i sum)
+{
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, sum);
+    return lanes[0] + lanes[1];
+}
+
+/* Low 64 bits of the product from three 32 bit multiplies */
+KNUT_TARGET_SSE42 static __m128i knut_reduce_mullo_sse42(__m128i a, __m128i b)
+{
+    const __m128i cross = _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+        _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+    return _mm_add_epi64(_mm_mul_epu32(a, b), _mm_slli_epi64(cross, 32));
+}
+
+KNUT_TARGET_SSE42 static __m128i knut_reduce_ramp_sse42()
+{
+    return _mm_set_epi64x(1, 0);
+}
+
+KNUT_TARGET_SSE42 static __m128i knut_reduce_greater_sse42(__m128i a, __m128i b, __m128i bias)
+{
+    return _mm_cmpgt_epi64(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+
+KNUT_TARGET_AVX2 static uint64_t knut_reduce_hsum_avx2(__m256i sum)
+{
+    uint64_t lanes[4];
+    _mm256_storeu_si256((__m256i*)lanes, sum);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+KNUT_TARGET_AVX2 static __m256i knut_reduce_mullo_avx2(__m256i a, __m256i b)
+{
+    const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+        _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+    return _mm256_add_epi64(_mm256_mul_epu32(a, b), _mm256_slli_epi64(cross, 32));
+}
+
+KNUT_TARGET_AVX2 static __m256i knut_reduce_ramp_avx2()
+{
+    return _mm256_setr_epi64x(0, 1, 2, 3);
+}
+
+KNUT_TARGET_AVX2 static __m256i knut_reduce_greater_avx2(__m256i a, __m256i b, __m256i bias)
+{
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(a, bias), _mm256_xor_si256(b, bias));
+}
+
+/* ISA is sse42 or avx2, VEC the matching vector type of BITS bits and P its intrinsic
+ * prefix */
+#define KNUT_DEFINE_REDUCE_SIMD(TYPE, TYPE_NAME, SUM_TYPE, ISA, VEC, P, BITS, LOAD, BIAS, \
+    TARGET) \
+TARGET static SUM_TYPE knut_reduce_##TYPE_NAME##_sum_##ISA(const TYPE* values, uint64_t size) \
+{ \
+    VEC sum = P##_setzero_si##BITS(); \
+    uint64_t i = 0; \
+    for (; i + (BITS / 64) <= size; i += (BITS / 64)) \
+    { \
+        sum = P##_add_epi64(sum, LOAD(values + i)); \
+    } \
+    return (SUM_TYPE)(knut_reduce_hsum_##ISA(sum) + \
+        (uint64_t)knut_reduce_##TYPE_NAME##_sum_scalar(values + i, size - i)); \
+} \
+\
+TARGET static SUM_TYPE knut_reduce_##TYPE_NAME##_dot_index_##ISA(const TYPE* values, \
+    uint64_t size, uint64_t first_index) \
+{ \
+    const VEC step = P##_set1_epi64x((BITS / 64)); \
+    VEC index = P##_add_epi64(P##_set1_epi64x((int64_t)first_index), knut_reduce_ramp_##ISA()); \
+    VEC sum = P##_setzero_si##BITS(); \
+    uint64_t i = 0; \
+    for (; i + (BITS / 64) <= size; i += (BITS / 64)) \
+    { \
+        sum = P##_add_epi64(sum, knut_reduce_mullo_##ISA(LOAD(values + i), index)); \
+        index = P##_add_epi64(index, step); \
+    } \
+    return (SUM_TYPE)(knut_reduce_hsum_##ISA(sum) + (uint64_t) \
+        knut_reduce_##TYPE_NAME##_dot_index_scalar(values + i, size - i, first_index + i)); \
+} \
+\
+TARGET static uint64_t knut_reduce_##TYPE_NAME##_abs_diff_##ISA(const TYPE* a, const TYPE* b, \
+    uint64_t size) \
+{ \
+    const VEC bias = P##_set1_epi64x(BIAS); \
+    VEC sum = P##_setzero_si##BITS(); \
+    uint64_t i = 0; \
+    for (; i + (BITS / 64) <= size; i += (BITS / 64)) \
+    { \
+        const VEC left = LOAD(a + i); \
+        const VEC right = LOAD(b + i); \
+        const VEC greater = knut_reduce_greater_##ISA(left, right, bias); \
+        sum = P##_add_epi64(sum, P##_blendv_epi8(P##_sub_epi64(right, left), \
+            P##_sub_epi64(left, right), greater)); \
+    } \
+    return knut_reduce_hsum_##ISA(sum) + \
+        knut_reduce_##TYPE_NAME##_abs_diff_scalar(a + i, b + i, size - i); \
+} \
+\
+TARGET static knut_pair_##TYPE_NAME##_t knut_reduce_##TYPE_NAME##_minmax_##ISA( \
+    const TYPE* values, uint64_t size) \
+{ \
+    if (size < (BITS / 64)) \
+    { \
+        return knut_reduce_##TYPE_NAME##_minmax_scalar(values, size); \
+    } \
+    const VEC bias = P##_set1_epi64x(BIAS); \
+    VEC min = LOAD(values); \
+    VEC max = min; \
+    uint64_t i = (BITS / 64); \
+    for (; i + (BITS / 64) <= size; i += (BITS / 64)) \
+    { \
+        const VEC current = LOAD(values + i); \
+        min = P##_blendv_epi8(min, current, knut_reduce_greater_##ISA(min, current, bias)); \
+        max = P##_blendv_epi8(max, current, knut_reduce_greater_##ISA(current, max, bias)); \
+    } \
+    int64_t min_lanes[(BITS / 64)]; \
+    int64_t max_lanes[(BITS / 64)]; \
+    P##_storeu_si##BITS((VEC*)min_lanes, min); \
+    P##_storeu_si##BITS((VEC*)max_lanes, max); \
+    knut_pair_##TYPE_NAME##_t minmax = { (TYPE)min_lanes[0], (TYPE)max_lanes[0] }; \
+    for (uint32_t lane = 1; lane < (BITS / 64); ++lane) \
+    { \
+        minmax.first = (TYPE)min_lanes[lane] < minmax.first ? \
+            (TYPE)min_lanes[lane] : minmax.first; \
+        minmax.second = (TYPE)max_lanes[lane] > minmax.second ? \
+            (TYPE)max_lanes[lane] : minmax.second; \
+    } \
+    return knut_reduce_##TYPE_NAME##_minmax_step(minmax, values + i, size - i); \
+} \
+\
+TARGET static uint64_t knut_reduce_##TYPE_NAME##_count_equal_##ISA(const TYPE* values, \
+    uint64_t size, TYPE value) \
+{ \
+    const VEC target = P##_set1_epi64x((int64_t)value); \
+    uint64_t count = 0; \
+    uint64_t i = 0; \
+    for (; i + (BITS / 64) <= size; i += (BITS / 64)) \
+    { \
+        const VEC equal = P##_cmpeq_epi64(LOAD(values + i), target); \
+        count += knut_popcount_u64( \
+            (uint32_t)P##_movemask_pd(P##_castsi##BITS##_pd(equal))); \
+    } \
+    return count + knut_reduce_##TYPE_NAME##_count_equal_scalar(values + i, size - i, value); \
+} \
+
+KNUT_DEFINE_REDUCE_SIMD(int32_t, i32, int64_t, sse42, __m128i, _mm, 128,
+    KNUT_REDUCE_LOAD_I32_SSE42, 0, KNUT_TARGET_SSE42)
+KNUT_DEFINE_REDUCE_SIMD(uint32_t, u32, uint64_t, sse42, __m128i, _mm, 128,
+    KNUT_REDUCE_LOAD_U32_SSE42, 0, KNUT_TARGET_SSE42)
+KNUT_DEFINE_REDUCE_SIMD(int64_t, i64, int64_t, sse42, __m128i, _mm, 128,
+    KNUT_REDUCE_LOAD_64_SSE42, 0, KNUT_TARGET_SSE42)
+KNUT_DEFINE_REDUCE_SIMD(uint64_t, u64, uint64_t, sse42, __m128i, _mm, 128,
+    KNUT_REDUCE_LOAD_64_SSE42, KNUT_REDUCE_SIGN_BIAS, KNUT_TARGET_SSE42)
+
+KNUT_DEFINE_REDUCE_SIMD(int32_t, i32, int64_t, avx2, __m256i, _mm256, 256,
+    KNUT_REDUCE_LOAD_I32_AVX2, 0, KNUT_TARGET_AVX2)
+KNUT_DEFINE_REDUCE_SIMD(uint32_t, u32, uint64_t, avx2, __m256i, _mm256, 256,
+    KNUT_REDUCE_LOAD_U32_AVX2, 0, KNUT_TARGET_AVX2)
+KNUT_DEFINE_REDUCE_SIMD(int64_t, i64, int64_t, avx2, __m256i, _mm256, 256,
+    KNUT_REDUCE_LOAD_64_AVX2, 0, KNUT_TARGET_AVX2)
+KNUT_DEFINE_REDUCE_SIMD(uint64_t, u64, uint64_t, avx2, __m256i, _mm256, 256,
+    KNUT_REDUCE_LOAD_64_AVX2, KNUT_REDUCE_SIGN_BIAS, KNUT_TARGET_AVX2)
+
+/* AVX-512 has 64 bit multiplies, min/max and unsigned compares, so its kernels need none of the
+ * emulation above */
+#define KNUT_REDUCE_LOAD_I32_AVX512(ptr) \
+    _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i*)(ptr)))
+#define KNUT_REDUCE_LOAD_U32_AVX512(ptr) \
+    _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*)(ptr)))
+#define KNUT_REDUCE_LOAD_64_AVX512(ptr) _mm512_loadu_si512((const void*)(ptr))
+
+/* _mm512_reduce_add_epi64 adds as signed, which may overflow */
+KNUT_TARGET_AVX512 static uint64_t knut_reduce_hsum_avx512(__m512i sum)
+{
+    return knut_reduce_hsum_avx2(_mm256_add_epi64(_mm512_castsi512_si256(sum),
+        _mm512_extracti64x4_epi64(sum, 1)));
+}
+
+/* SIGN is epi for signed and epu for unsigned lanes */
+#define KNUT_DEFINE_REDUCE_AVX512(TYPE, TYPE_NAME, SUM_TYPE, LOAD, SIGN) \
+KNUT_TARGET_AVX512 static SUM_TYPE knut_reduce_##TYPE_NAME##_sum_avx512(const TYPE* values, \
+    uint64_t size) \
+{ \
+    __m512i sum = _mm512_setzero_si512(); \
+    uint64_t i = 0; \
+    for (; i + 8 <= size; i += 8) \
+    { \
+        sum = _mm512_add_epi64(sum, LOAD(values + i)); \
+    } \
+    return (SUM_TYPE)(knut_reduce_hsum_avx512(sum) + \
+        (uint64_t)knut_reduce_##TYPE_NAME##_sum_scalar(values + i, size - i)); \
+} \
+\
+KNUT_TARGET_AVX512 static SUM_TYPE knut_reduce_##TYPE_NAME##_dot_index_avx512( \
+    const TYPE* values, uint64_t size, uint64_t first_index) \
+{ \
+    const __m512i step = _mm512_set1_epi64(8); \
+    __m512i index = _mm512_add_epi64(_mm512_set1_epi64((int64_t)first_index), \
+        _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7)); \
+    __m512i sum = _mm512_setzero_si512(); \
+    uint64_t i = 0; \
+    for (; i + 8 <= size; i += 8) \
+    { \
+        sum = _mm512_add_epi64(sum, _mm512_mullo_epi64(LOAD(values + i), index)); \
+        index = _mm512_add_epi64(index, step); \
+    } \
+    return (SUM_TYPE)(knut_reduce_hsum_avx512(sum) + (uint64_t) \
+        knut_reduce_##TYPE_NAME##_dot_index_scalar(values + i, size - i, first_index + i)); \
+} \
+\
+KNUT_TARGET_AVX512 static uint64_t knut_reduce_##TYPE_NAME##_abs_diff_avx512(const TYPE* a, \
+    const TYPE* b, uint64_t size) \
+{ \
+    __m512i sum = _mm512_setzero_si512(); \
+    uint64_t i = 0; \
+    for (; i + 8 <= size; i += 8) \
+    { \
+        const __m512i left = LOAD(a + i); \
+        const __m512i right = LOAD(b + i); \
+        sum = _mm512_add_epi64(sum, _mm512_sub_epi64(_mm512_max_##SIGN##64(left, right), \
+            _mm512_min_##SIGN##64(left, right))); \
+    } \
+    return knut_reduce_hsum_avx512(sum) + \
+        knut_reduce_##TYPE_NAME##_abs_diff_scalar(a + i, b + i, size - i); \
+} \
+\
+KNUT_TARGET_AVX512 static knut_pair_##TYPE_NAME##_t knut_reduce_##TYPE_NAME##_minmax_avx512( \
+    const TYPE* values, uint64_t size) \
+{ \
+    if (size < 8) \
+    { \
+        return knut_reduce_##TYPE_NAME##_minmax_scalar(values, size); \
+    } \
+    __m512i min = LOAD(values); \
+    __m512i max = min; \
+    uint64_t i = 8; \
+    for (; i + 8 <= size; i += 8) \
+    { \
+        const __m512i current = LOAD(values + i); \
+        min = _mm512_min_##SIGN##64(min, current); \
+        max = _mm512_max_##SIGN##64(max, current); \
+    } \
+    const knut_pair_##TYPE_NAME##_t minmax = { \
+        (TYPE)_mm512_reduce_min_##SIGN##64(min), (TYPE)_mm512_reduce_max_##SIGN##64(max) \
+    }; \
+    return knut_reduce_##TYPE_NAME##_minmax_step(minmax, values + i, size - i); \
+} \
+\
+KNUT_TARGET_AVX512 static uint64_t knut_reduce_##TYPE_NAME##_count_equal_avx512( \
+    const TYPE* values, uint64_t size, TYPE value) \
+{ \
+    const __m512i target = _mm512_set1_epi64((int64_t)value); \
+    uint64_t count = 0; \
+    uint64_t i = 0; \
+    for (; i + 8 <= size; i += 8) \
+    { \
+        count += knut_popcount_u64(_mm512_cmpeq_epi64_mask(LOAD(values + i), target)); \
+    } \
+    return count + knut_reduce_##TYPE_NAME##_count_equal_scalar(values + i, size - i, value); \
+} \
+
+KNUT_DEFINE_REDUCE_AVX512(int32_t, i32, int64_t, KNUT_REDUCE_LOAD_I32_AVX512, epi)
+KNUT_DEFINE_REDUCE_AVX512(uint32_t, u32, uint64_t, KNUT_REDUCE_LOAD_U32_AVX512, epi)
+KNUT_DEFINE_REDUCE_AVX512(int64_t, i64, int64_t, KNUT_REDUCE_LOAD_64_AVX512, epi)
+KNUT_DEFINE_REDUCE_AVX512(uint64_t, u64, uint64_t, KNUT_REDUCE_LOAD_64_AVX512, epu)
+
+#endif // ifdef KNUT_ARCH_X86
+
+#define KNUT_REDUCE_DISPATCH(RETURN_TYPE, NAME, PARAMS, ARGS) \
+    KNUT_CPU_DEFINE_DISPATCH(RETURN_TYPE, NAME, PARAMS, ARGS, NAME##_scalar, \
+        KNUT_CPU_X86(NAME##_sse42), KNUT_CPU_X86(NAME##_avx2), KNUT_CPU_X86(NAME##_avx512))
+
+#define KNUT_DEFINE_REDUCE(TYPE, TYPE_NAME, SUM_TYPE) \
+KNUT_REDUCE_DISPATCH(SUM_TYPE, knut_reduce_##TYPE_NAME##_sum, \
+    (const TYPE* values, uint64_t size), (values, size)) \
+KNUT_REDUCE_DISPATCH(SUM_TYPE, knut_reduce_##TYPE_NAME##_dot_index, \
+    (const TYPE* values, uint64_t size, uint64_t first_index), (values, size, first_index)) \
+KNUT_REDUCE_DISPATCH(uint64_t, knut_reduce_##TYPE_NAME##_abs_diff, \
+    (const TYPE* a, const TYPE* b, uint64_t size), (a, b, size)) \
+KNUT_REDUCE_DISPATCH(knut_pair_##TYPE_NAME##_t, knut_reduce_##TYPE_NAME##_minmax, \
+    (const TYPE* values, uint64_t size), (values, size)) \
+KNUT_REDUCE_DISPATCH(uint64_t, knut_reduce_##TYPE_NAME##_count_equal, \
+    (const TYPE* values, uint64_t size, TYPE value), (values, size, value)) \
+
+KNUT_DEFINE_REDUCE(int32_t, i32, int64_t)
+KNUT_DEFINE_REDUCE(uint32_t, u32, uint64_t)
+KNUT_DEFINE_REDUCE(int64_t, i64, int64_t)
+KNUT_DEFINE_REDUCE(uint64_t, u64, uint64_t)
 
 #ifdef __cplusplus
 }
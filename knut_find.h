@@ -0,0 +1,234 @@
+#ifndef KNUT_FIND_INCLUDE_H
+#define KNUT_FIND_INCLUDE_H
+
+#include "knut.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KNUT_FIND_MAX_NEEDLES 8
+
+/* The needles aren't copied and have to outlive the finder */
+typedef struct {
+    const char* needles[KNUT_FIND_MAX_NEEDLES];
+    uint64_t lengths[KNUT_FIND_MAX_NEEDLES];
+    uint32_t num_needles;
+    uint64_t max_length;
+    bool use_avx2;
+} knut_find_t;
+
+typedef struct {
+    uint64_t offset;
+    uint32_t needle;
+} knut_find_match_t;
+
+void knut_find_init(knut_find_t* find, const char* const* needles, uint32_t num_needles);
+
+/* Fills 'matches' with the next occurrences starting at 'position', ordered by offset and then
+ * by needle, overlapping occurrences are all reported. 'position' is moved past the reported
+ * matches, 0 is returned once the buffer is exhausted. 'max_matches' must be at least the
+ * number of needles. */
+uint64_t knut_find_next(const knut_find_t* find, const char* data, uint64_t size,
+    uint64_t* position, knut_find_match_t* matches, uint64_t max_matches);
+
+/* Adds the number of occurrences of every needle to 'counts' and returns their sum */
+uint64_t knut_find_count(const knut_find_t* find, const char* data, uint64_t size,
+    uint64_t* counts);
+
+#endif // KNUT_FIND_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_FIND_IMPLEMENTATION) && !defined(KNUT_FIND_IMPLEMENTATION_DONE)
+#define KNUT_FIND_IMPLEMENTATION_DONE
+
+#ifndef KNUT_IMPLEMENTATION_DONE
+#error "'knut.h' must be included with KNUT_IMPLEMENTATION before this header can be used"
+#endif
+
+#include <string.h>
+
+#ifdef KNUT_ARCH_X86
+#include <immintrin.h>
+#endif
+
+#define KNUT_FIND_BATCH_SIZE 256
+
+void knut_find_init(knut_find_t* find, const char* const* needles, uint32_t num_needles)
+{
+    KNUT_ASSERT(num_needles > 0 && num_needles <= KNUT_FIND_MAX_NEEDLES,
+        "[knut_find_init] Invalid number of needles\n");
+
+    find->num_needles = num_needles;
+    find->max_length = 0;
+    find->use_avx2 = knut_cpu_isa() >= KNUT_CPU_ISA_AVX2;
+
+    for (uint32_t i = 0; i < num_needles; ++i)
+    {
+        find->needles[i] = needles[i];
+        find->lengths[i] = strlen(needles[i]);
+        KNUT_ASSERT(find->lengths[i] > 0, "[knut_find_init] Empty needle\n");
+        find->max_length = find->lengths[i] > find->max_length ?
+            find->lengths[i] : find->max_length;
+    }
+}
+
+/* First and last byte are already known to match */
+static bool knut_find_verify(const knut_find_t* find, uint32_t needle, const char* candidate)
+{
+    const uint64_t length = find->lengths[needle];
+    return length <= 2 || memcmp(candidate + 1, find->needles[needle] + 1, length - 2) == 0;
+}
+
+static uint64_t knut_find_next_scalar(const knut_find_t* find, const char* data, uint64_t size,
+    uint64_t* position, knut_find_match_t* matches, uint64_t max_matches, uint64_t count)
+{
+    uint64_t i = *position;
+
+    for (; i < size; ++i)
+    {
+        if (count + find->num_needles > max_matches)
+        {
+            break;
+        }
+
+        for (uint32_t n = 0; n < find->num_needles; ++n)
+        {
+            const uint64_t length = find->lengths[n];
+
+            if (i + length <= size && data[i] == find->needles[n][0] &&
+                data[i + length - 1] == find->needles[n][length - 1] &&
+                knut_find_verify(find, n, data + i))
+            {
+                const knut_find_match_t match = { i, n };
+                matches[count++] = match;
+            }
+        }
+    }
+
+    *position = i;
+    return count;
+}
+
+#ifdef KNUT_ARCH_X86
+
+/* Compares the first and the last byte of every needle against 32 positions at once and only
+ * verifies the middle of the positions where both matched */
+KNUT_TARGET_AVX2 static uint64_t knut_find_next_avx2(const knut_find_t* find,
+    const char* data, uint64_t size, uint64_t* position, knut_find_match_t* matches,
+    uint64_t max_matches)
+{
+    __m256i firsts[KNUT_FIND_MAX_NEEDLES];
+    __m256i lasts[KNUT_FIND_MAX_NEEDLES];
+    const uint32_t num_needles = find->num_needles;
+
+    for (uint32_t n = 0; n < num_needles; ++n)
+    {
+        firsts[n] = _mm256_set1_epi8(find->needles[n][0]);
+        lasts[n] = _mm256_set1_epi8(find->needles[n][find->lengths[n] - 1]);
+    }
+
+    uint64_t count = 0;
+    uint64_t i = *position;
+
+    for (; i + 32 + find->max_length - 1 <= size; i += 32)
+    {
+        const __m256i block = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i hits[KNUT_FIND_MAX_NEEDLES];
+        __m256i any_hit = _mm256_setzero_si256();
+
+        for (uint32_t n = 0; n < num_needles; ++n)
+        {
+            const __m256i last_block =
+                _mm256_loadu_si256((const __m256i*)(data + i + find->lengths[n] - 1));
+            hits[n] = _mm256_and_si256(_mm256_cmpeq_epi8(block, firsts[n]),
+                _mm256_cmpeq_epi8(last_block, lasts[n]));
+            any_hit = _mm256_or_si256(any_hit, hits[n]);
+        }
+
+        if (_mm256_testz_si256(any_hit, any_hit))
+        {
+            continue;
+        }
+
+        uint32_t masks[KNUT_FIND_MAX_NEEDLES];
+        uint32_t candidates = (uint32_t)_mm256_movemask_epi8(any_hit);
+
+        for (uint32_t n = 0; n < num_needles; ++n)
+        {
+            masks[n] = (uint32_t)_mm256_movemask_epi8(hits[n]);
+        }
+
+        while (candidates != 0)
+        {
+            const uint32_t bit = (uint32_t)knut_ctz_u64(candidates);
+
+            if (count + num_needles > max_matches)
+            {
+                *position = i + bit;
+                return count;
+            }
+
+            for (uint32_t n = 0; n < num_needles; ++n)
+            {
+                if ((masks[n] >> bit & 1) != 0 && knut_find_verify(find, n, data + i + bit))
+                {
+                    const knut_find_match_t match = { i + bit, n };
+                    matches[count++] = match;
+                }
+            }
+
+            candidates &= candidates - 1;
+        }
+    }
+
+    *position = i;
+    return knut_find_next_scalar(find, data, size, position, matches, max_matches, count);
+}
+
+#endif // ifdef KNUT_ARCH_X86
+
+uint64_t knut_find_next(const knut_find_t* find, const char* data, uint64_t size,
+    uint64_t* position, knut_find_match_t* matches, uint64_t max_matches)
+{
+    KNUT_ASSERT(max_matches >= find->num_needles,
+        "[knut_find_next] Matches can't hold one match of every needle\n");
+
+#ifdef KNUT_ARCH_X86
+    if (find->use_avx2)
+    {
+        return knut_find_next_avx2(find, data, size, position, matches, max_matches);
+    }
+#endif
+
+    return knut_find_next_scalar(find, data, size, position, matches, max_matches, 0);
+}
+
+uint64_t knut_find_count(const knut_find_t* find, const char* data, uint64_t size,
+    uint64_t* counts)
+{
+    knut_find_match_t matches[KNUT_FIND_BATCH_SIZE];
+    uint64_t position = 0;
+    uint64_t num_matches;
+    uint64_t total = 0;
+
+    while ((num_matches = knut_find_next(find, data, size, &position, matches,
+        KNUT_FIND_BATCH_SIZE)) > 0)
+    {
+        for (uint64_t i = 0; i < num_matches; ++i)
+        {
+            ++counts[matches[i].needle];
+        }
+
+        total += num_matches;
+    }
+
+    return total;
+}
+
+#endif // KNUT_FIND_IMPLEMENTATION
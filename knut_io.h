@@ -9,16 +9,22 @@
 int knut_io_init();
 int knut_io_cleanup();
 
+/* UNSPEC only asks getaddrinfo for both IPv4 and IPv6 entries */
 typedef enum {
-    KNUT_IO_ADDR_FAMILY_IPV4 = 0
+    KNUT_IO_ADDR_FAMILY_IPV4 = 0,
+    KNUT_IO_ADDR_FAMILY_UNIX,
+    KNUT_IO_ADDR_FAMILY_IPV6,
+    KNUT_IO_ADDR_FAMILY_UNSPEC
 } knut_io_addr_family_t;
 
 typedef enum {
-    KNUT_IO_SOCKET_TYPE_STREAM = 0
+    KNUT_IO_SOCKET_TYPE_STREAM = 0,
+    KNUT_IO_SOCKET_TYPE_DGRAM
 } knut_io_socket_type_t;
 
 typedef enum {
-    KNUT_IO_PROTOCOL_TYPE_TCP = 0
+    KNUT_IO_PROTOCOL_TYPE_TCP = 0,
+    KNUT_IO_PROTOCOL_TYPE_UDP
 } knut_io_protocol_type_t;
 
 typedef struct {
@@ -29,20 +35,22 @@ typedef struct {
     uint32_t value[4];
 } knut_io_ipv6_addr_t;
 
+/* Addresses and port are in network byte order, 'scope_id' picks the interface of link local
+ * IPv6 addresses */
 typedef struct {
     union {
         knut_io_ipv4_addr_t ipv4;
         knut_io_ipv6_addr_t ipv6;
     } addr;
     uint16_t port;
+    uint32_t scope_id;
 } knut_io_endpoint_t;
 
-#define KNUT_IO_MAX_NUM_ADDRINFO 8
-
+/* Holds every entry the resolver returned in its order */
 typedef struct {
-    knut_io_endpoint_t endpoints[KNUT_IO_MAX_NUM_ADDRINFO];
-    knut_io_addr_family_t families[KNUT_IO_MAX_NUM_ADDRINFO];
-    uint8_t num_entires;
+    knut_io_endpoint_t* endpoints;
+    knut_io_addr_family_t* families;
+    uint64_t num_entires;
 } knut_io_addrinfo_t;
 
 typedef struct {
@@ -54,6 +62,7 @@ typedef struct {
 } knut_io_getadddrinfo_args_t;
 
 int knut_io_getaddrinfo(const knut_io_getadddrinfo_args_t* args, knut_io_addrinfo_t* info);
+void knut_io_addrinfo_destroy(knut_io_addrinfo_t* info);
 
 #ifdef _WIN32
 
@@ -62,6 +71,7 @@ int knut_io_getaddrinfo(const knut_io_getadddrinfo_args_t* args, knut_io_addrinf
 #include <winsock2.h>
 #pragma warning(pop)
 #include <ws2tcpip.h>
+#include <afunix.h>
 #pragma comment(lib, "Ws2_32.lib")
 
 // TODO: struct not neeeded?
@@ -69,17 +79,25 @@ typedef struct {
     SOCKET handle;
 } knut_io_socket_t;
 
+typedef WSAPOLLFD knut_io_pollfd_t;
+
 #else
 
+#include <poll.h>
+
 typedef struct {
     int handle;
 } knut_io_socket_t;
 
+typedef struct pollfd knut_io_pollfd_t;
+
 #endif
 
 knut_io_socket_t knut_io_socket(knut_io_addr_family_t family, knut_io_socket_type_t socktype, knut_io_protocol_type_t protocol);
 bool knut_io_socket_is_valid(knut_io_socket_t socket);
 int knut_io_close(knut_io_socket_t socket);
+/* Stops both directions, wakes up threads blocked on the socket without releasing it */
+int knut_io_shutdown(knut_io_socket_t socket);
 int knut_io_connect(knut_io_socket_t socket, knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint);
 int knut_io_bind(knut_io_socket_t socket, knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint);
 int knut_io_listen(knut_io_socket_t socket);
@@ -87,8 +105,169 @@ knut_io_socket_t knut_io_accept(knut_io_socket_t socket);
 int knut_io_send(knut_io_socket_t socket, const char* buffer, int buffer_size);
 int knut_io_recv(knut_io_socket_t socket, char* buffer, int buffer_size);
 
+/* Unix domain sockets are created with KNUT_IO_ADDR_FAMILY_UNIX, the protocol is ignored */
+int knut_io_bind_unix(knut_io_socket_t socket, const char* path);
+int knut_io_connect_unix(knut_io_socket_t socket, const char* path);
+
+/* Loop until every byte went through, return -1 on errors and if the peer closed early */
+int knut_io_send_all(knut_io_socket_t socket, const char* buffer, uint64_t size);
+int knut_io_recv_all(knut_io_socket_t socket, char* buffer, uint64_t size);
+
+/* Lets several sockets bind the same address with the kernel spreading new connections across
+ * them, returns -1 where SO_REUSEPORT doesn't exist */
+int knut_io_set_reuse_port(knut_io_socket_t socket);
+int knut_io_set_nonblocking(knut_io_socket_t socket, bool nonblocking);
+/* TCP_NODELAY turns Nagle off so small writes leave right away. A corked socket holds partial
+ * segments until it is uncorked (TCP_CORK, TCP_NOPUSH on BSD), returns -1 where neither
+ * exists. */
+int knut_io_set_nodelay(knut_io_socket_t socket, bool nodelay);
+int knut_io_set_cork(knut_io_socket_t socket, bool cork);
+/* Lets an IPv6 socket also take IPv4 connections as v4 mapped addresses, has to be set before
+ * bind */
+int knut_io_set_dual_stack(knut_io_socket_t socket, bool dual_stack);
+/* True if the last failed call on a non-blocking socket only had to wait */
+bool knut_io_would_block();
+
+#define KNUT_IO_ACCEPT_NONBLOCK 0x1
+#define KNUT_IO_ACCEPT_CLOEXEC 0x2
+
+/* Applies the flags in the accept call itself where accept4 exists. 'family' and 'endpoint'
+ * may be NULL, the endpoint is only filled for IPv4 and IPv6 peers. */
+knut_io_socket_t knut_io_accept_with(knut_io_socket_t socket, uint32_t flags,
+    knut_io_addr_family_t* family, knut_io_endpoint_t* endpoint);
+
+/* poll/WSAPoll, events are POLLIN, POLLOUT etc. */
+int knut_io_poll(knut_io_pollfd_t* fds, uint64_t count, int timeout_ms);
+
+typedef struct {
+    char* data;
+    uint64_t size;
+} knut_io_iovec_t;
+
+#define KNUT_IO_MAX_IOVECS 64
+
+/* One sendmsg/WSASend or recvmsg/WSARecv over the buffers, returns the number of bytes or -1.
+ * A call takes at most KNUT_IO_MAX_IOVECS buffers and 1 GiB, larger buffers are cut. */
+int64_t knut_io_sendv(knut_io_socket_t socket, const knut_io_iovec_t* iovecs, uint64_t count);
+int64_t knut_io_recvv(knut_io_socket_t socket, const knut_io_iovec_t* iovecs, uint64_t count);
+/* Loops until all buffers went through, 'iovecs' is advanced in place */
+int knut_io_sendv_all(knut_io_socket_t socket, knut_io_iovec_t* iovecs, uint64_t count);
+
+/* One datagram, 'endpoint' is the IPv4 or IPv6 peer it came from or goes to if 'has_endpoint'
+ * is set */
+typedef struct {
+    char* data;
+    uint64_t size;
+    knut_io_endpoint_t endpoint;
+    knut_io_addr_family_t family;
+    bool has_endpoint;
+} knut_io_packet_t;
+
+#define KNUT_IO_MAX_BATCH_SIZE 64
+
+/* Equally sized packet buffers and the message headers pointing at them, allocated once and
+ * reused by every batch call */
+typedef struct {
+    char* buffer;
+    knut_io_packet_t* packets;
+    void* native;
+    uint32_t num_packets;
+    uint32_t packet_size;
+} knut_io_packet_batch_t;
+
+void knut_io_packet_batch_init(knut_io_packet_batch_t* batch, uint32_t num_packets,
+    uint32_t packet_size);
+void knut_io_packet_batch_destroy(knut_io_packet_batch_t* batch);
+
+/* Waits for the first datagram and takes whatever else is queued with one recvmmsg, at most
+ * 'num_packets'. Packet i of the batch holds datagram i afterwards, longer datagrams are cut to
+ * 'packet_size'. Returns the number of datagrams or -1. */
+int64_t knut_io_recv_batch(knut_io_socket_t socket, knut_io_packet_batch_t* batch);
+/* Sends the first 'count' packets of the batch with one sendmmsg, their data may point anywhere.
+ * Connected sockets send packets without an endpoint. Returns the number of packets sent, which
+ * may be less than 'count', or -1. */
+int64_t knut_io_send_batch(knut_io_socket_t socket, knut_io_packet_batch_t* batch,
+    uint64_t count);
+
 int knut_io_read_binary(knut_buffer_char_t* buffer, const char* path);
 
+/* Read only view of a whole file unless it comes from knut_io_map_file_writable, empty files
+ * map to a NULL pointer */
+typedef struct {
+    const char* ptr;
+    uint64_t size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int fd;
+#endif
+} knut_io_mapped_file_t;
+
+int knut_io_map_file(knut_io_mapped_file_t* file, const char* path);
+/* Writable view whose stores stay private to the process, pages are only copied once they are
+ * written to */
+int knut_io_map_file_private(knut_io_mapped_file_t* file, const char* path);
+/* Shared writable view of the first 'size' bytes, the file is created or grown with zeros if it
+ * is smaller. Stores through the pointer go to the file. */
+int knut_io_map_file_writable(knut_io_mapped_file_t* file, const char* path, uint64_t size);
+void knut_io_unmap_file(knut_io_mapped_file_t* file);
+
+/* Streams part of a mapped file to a blocking socket, the kernel reads it straight from the
+ * page cache through sendfile/TransmitFile. Linux' sendfile takes no MSG_NOSIGNAL, so writing
+ * to a closed peer raises SIGPIPE there. */
+int knut_io_sendfile(knut_io_socket_t socket, const knut_io_mapped_file_t* file, uint64_t offset,
+    uint64_t size);
+
+/* MSG_ZEROCOPY sends on Linux pin the pages instead of copying them, so a buffer must stay
+ * unchanged until its send completed. Elsewhere, or if the socket refuses SO_ZEROCOPY, sends
+ * copy and complete right away. TCP completes sends in order, so one counter is enough. */
+typedef struct {
+    knut_io_socket_t socket;
+    uint32_t next_id;
+    uint32_t completed;
+    bool enabled;
+    bool copied;
+} knut_io_zerocopy_t;
+
+void knut_io_zerocopy_init(knut_io_zerocopy_t* zerocopy, knut_io_socket_t socket);
+/* Sends the whole buffer, 'id' gets the id of the send that has to complete before the buffer
+ * may be reused */
+int knut_io_zerocopy_send(knut_io_zerocopy_t* zerocopy, const char* buffer, uint64_t size,
+    uint32_t* id);
+/* Reads the completions that already arrived without blocking. 'copied' is set once the kernel
+ * had to copy after all, zero copy is only worth it if it stays false. */
+void knut_io_zerocopy_poll(knut_io_zerocopy_t* zerocopy);
+bool knut_io_zerocopy_is_done(const knut_io_zerocopy_t* zerocopy, uint32_t id);
+int knut_io_zerocopy_wait(knut_io_zerocopy_t* zerocopy, uint32_t id);
+
+/* starts[i] is the offset of line i, starts[num_lines] is one past the line break that would
+ * end the last line, so every line is starts[i + 1] - starts[i] - 1 characters long */
+typedef struct {
+    uint64_t* starts;
+    uint64_t num_lines;
+} knut_io_line_index_t;
+
+#define KNUT_IO_PARALLEL_INDEX_MIN_SIZE (4 * 1024 * 1024)
+
+/* Runs all tasks and returns once they are done, knut_thread_run_all runs them in parallel */
+typedef void (*knut_io_run_tasks_t)(const knut_function_t* tasks, uint32_t num_tasks);
+
+/* Splits the buffer into 'num_chunks' chunks that are scanned by 'run_tasks'. Buffers below
+ * KNUT_IO_PARALLEL_INDEX_MIN_SIZE and a NULL 'run_tasks' are scanned as one chunk. */
+int knut_io_index_lines(knut_io_line_index_t* index, const char* data, uint64_t size, 
+    uint32_t num_chunks, knut_io_run_tasks_t run_tasks);
+void knut_io_line_index_destroy(knut_io_line_index_t* index);
+uint64_t knut_io_line_length(const knut_io_line_index_t* index, uint64_t line);
+
+/* Width shared by all lines without line breaks or -1 if they differ */
+int64_t knut_io_grid_width(const knut_io_line_index_t* index, const char* data);
+
+/* Reads a grid without its line breaks and null terminated, returns -1 if the file can't be
+ * read and -2 if the lines aren't all of the same width */
+int knut_io_read_grid(knut_buffer_char_t* grid, uint64_t* width, uint64_t* height, 
+    const char* path);
+
 #endif // KNUT_IO_INCLUDE_H
 
 // ==============================================================================
@@ -109,6 +288,46 @@ int knut_io_read_binary(knut_buffer_char_t* buffer, const char* path);
 #include <assert.h>
 #include <stdio.h>
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <mswsock.h>
+#pragma comment(lib, "Mswsock.lib")
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/errqueue.h>
+#include <sys/sendfile.h>
+#endif
+
+/* recvmmsg/sendmmsg move a whole batch of datagrams per call */
+#ifdef __linux__
+#define KNUT_IO_HAS_MMSG
+#endif
+
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+#define KNUT_IO_HAS_ZEROCOPY
+#endif
+
+#ifdef KNUT_ARCH_X86
+#include <immintrin.h>
+#endif
+
 #ifdef _WIN32
 
 int knut_io_init()
@@ -122,6 +341,166 @@ int knut_io_cleanup()
     return WSACleanup();
 }
 
+bool knut_io_socket_is_valid(knut_io_socket_t socket)
+{
+    return socket.handle != INVALID_SOCKET;
+}
+
+int knut_io_close(knut_io_socket_t socket)
+{
+    return closesocket(socket.handle);
+}
+
+int knut_io_shutdown(knut_io_socket_t socket)
+{
+    return shutdown(socket.handle, SD_BOTH);
+}
+
+int knut_io_set_reuse_port(knut_io_socket_t socket)
+{
+    (void)socket;
+    return -1;
+}
+
+int knut_io_set_nonblocking(knut_io_socket_t socket, bool nonblocking)
+{
+    u_long mode = nonblocking ? 1 : 0;
+    return ioctlsocket(socket.handle, FIONBIO, &mode);
+}
+
+int knut_io_set_nodelay(knut_io_socket_t socket, bool nodelay)
+{
+    const DWORD enable = nodelay ? 1 : 0;
+    return setsockopt(socket.handle, IPPROTO_TCP, TCP_NODELAY, (const char*)&enable,
+        sizeof(enable));
+}
+
+int knut_io_set_cork(knut_io_socket_t socket, bool cork)
+{
+    (void)socket;
+    (void)cork;
+    return -1;
+}
+
+int knut_io_set_dual_stack(knut_io_socket_t socket, bool dual_stack)
+{
+    const DWORD v6_only = dual_stack ? 0 : 1;
+    return setsockopt(socket.handle, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&v6_only,
+        sizeof(v6_only));
+}
+
+bool knut_io_would_block()
+{
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+int knut_io_poll(knut_io_pollfd_t* fds, uint64_t count, int timeout_ms)
+{
+    return WSAPoll(fds, (ULONG)count, timeout_ms);
+}
+
+typedef int knut_io_socklen_t;
+typedef WSABUF knut_io_native_iovec_t;
+#define KNUT_IO_SEND_FLAGS 0
+
+#else
+
+int knut_io_init()
+{
+    return 0;
+}
+
+int knut_io_cleanup()
+{
+    return 0;
+}
+
+bool knut_io_socket_is_valid(knut_io_socket_t socket)
+{
+    return socket.handle >= 0;
+}
+
+int knut_io_close(knut_io_socket_t socket)
+{
+    return close(socket.handle);
+}
+
+int knut_io_shutdown(knut_io_socket_t socket)
+{
+    return shutdown(socket.handle, SHUT_RDWR);
+}
+
+int knut_io_set_reuse_port(knut_io_socket_t socket)
+{
+#ifdef SO_REUSEPORT
+    const int enable = 1;
+    return setsockopt(socket.handle, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+#else
+    (void)socket;
+    return -1;
+#endif
+}
+
+int knut_io_set_nonblocking(knut_io_socket_t socket, bool nonblocking)
+{
+    const int flags = fcntl(socket.handle, F_GETFL, 0);
+
+    if (flags < 0)
+    {
+        return -1;
+    }
+
+    return fcntl(socket.handle, F_SETFL, nonblocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+}
+
+int knut_io_set_nodelay(knut_io_socket_t socket, bool nodelay)
+{
+    const int enable = nodelay ? 1 : 0;
+    return setsockopt(socket.handle, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+}
+
+int knut_io_set_cork(knut_io_socket_t socket, bool cork)
+{
+    const int enable = cork ? 1 : 0;
+#if defined(TCP_CORK)
+    return setsockopt(socket.handle, IPPROTO_TCP, TCP_CORK, &enable, sizeof(enable));
+#elif defined(TCP_NOPUSH)
+    return setsockopt(socket.handle, IPPROTO_TCP, TCP_NOPUSH, &enable, sizeof(enable));
+#else
+    (void)socket;
+    (void)enable;
+    return -1;
+#endif
+}
+
+int knut_io_set_dual_stack(knut_io_socket_t socket, bool dual_stack)
+{
+    const int v6_only = dual_stack ? 0 : 1;
+    return setsockopt(socket.handle, IPPROTO_IPV6, IPV6_V6ONLY, &v6_only, sizeof(v6_only));
+}
+
+bool knut_io_would_block()
+{
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
+int knut_io_poll(knut_io_pollfd_t* fds, uint64_t count, int timeout_ms)
+{
+    return poll(fds, (nfds_t)count, timeout_ms);
+}
+
+typedef socklen_t knut_io_socklen_t;
+typedef struct iovec knut_io_native_iovec_t;
+
+/* Writing to a closed connection must fail instead of killing the process */
+#ifdef MSG_NOSIGNAL
+#define KNUT_IO_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define KNUT_IO_SEND_FLAGS 0
+#endif
+
+#endif // ifdef _WIN32
+
 static int to_ai_family(knut_io_addr_family_t family)
 {
     switch (family)
@@ -130,8 +509,20 @@ static int to_ai_family(knut_io_addr_family_t family)
     {
         return AF_INET;
     }
+    case KNUT_IO_ADDR_FAMILY_UNIX:
+    {
+        return AF_UNIX;
+    }
+    case KNUT_IO_ADDR_FAMILY_IPV6:
+    {
+        return AF_INET6;
+    }
+    case KNUT_IO_ADDR_FAMILY_UNSPEC:
+    {
+        return AF_UNSPEC;
+    }
     default:
-        knut_exit_if(false, "TODO");
+        knut_exit_if(true, "[to_ai_family] Unknown address family\n");
         break;
     }
 
@@ -146,12 +537,19 @@ static knut_io_addr_family_t to_addr_family(int family)
     {
         return KNUT_IO_ADDR_FAMILY_IPV4;
     }
+    case AF_INET6:
+    {
+        return KNUT_IO_ADDR_FAMILY_IPV6;
+    }
+    case AF_UNIX:
+    {
+        return KNUT_IO_ADDR_FAMILY_UNIX;
+    }
     default:
-        knut_exit_if(false, "TODO");
         break;
     }
 
-    return KNUT_IO_ADDR_FAMILY_IPV4;
+    return KNUT_IO_ADDR_FAMILY_UNSPEC;
 }
 
 static int to_ai_socktype(knut_io_socket_type_t type)
@@ -162,8 +560,12 @@ static int to_ai_socktype(knut_io_socket_type_t type)
     {
         return SOCK_STREAM;
     }
+    case KNUT_IO_SOCKET_TYPE_DGRAM:
+    {
+        return SOCK_DGRAM;
+    }
     default:
-        knut_exit_if(false, "TODO");
+        knut_exit_if(true, "[to_ai_socktype] Unknown socket type\n");
         break;
     }
 
@@ -178,20 +580,87 @@ static int to_ai_protocol(knut_io_protocol_type_t type)
     {
         return IPPROTO_TCP;
     }
+    case KNUT_IO_PROTOCOL_TYPE_UDP:
+    {
+        return IPPROTO_UDP;
+    }
     default:
-        knut_exit_if(false, "TODO");
+        knut_exit_if(true, "[to_ai_protocol] Unknown protocol\n");
         break;
     }
 
     return -1;
 }
 
+typedef union {
+    struct sockaddr_in ipv4;
+    struct sockaddr_in6 ipv6;
+    struct sockaddr_un local;
+} sockaddr_union_t;
+
+sockaddr_union_t to_sockaddr_union(knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
+{
+    sockaddr_union_t sockaddrs = {0};
+
+    if (family == KNUT_IO_ADDR_FAMILY_IPV4)
+    {
+        struct sockaddr_in* addr = &sockaddrs.ipv4;
+        addr->sin_family = AF_INET;
+        addr->sin_addr.s_addr = endpoint->addr.ipv4.value;
+        addr->sin_port = endpoint->port;
+    }
+    else
+    {
+        KNUT_ASSERT(family == KNUT_IO_ADDR_FAMILY_IPV6,
+            "[to_sockaddr_union] Endpoints are either IPv4 or IPv6\n");
+        struct sockaddr_in6* addr = &sockaddrs.ipv6;
+        addr->sin6_family = AF_INET6;
+        memcpy(&addr->sin6_addr, endpoint->addr.ipv6.value, sizeof(addr->sin6_addr));
+        addr->sin6_port = endpoint->port;
+        addr->sin6_scope_id = endpoint->scope_id;
+    }
+
+    return sockaddrs;
+}
+
+static knut_io_socklen_t knut_io_sockaddr_size(knut_io_addr_family_t family)
+{
+    return family == KNUT_IO_ADDR_FAMILY_IPV4 ?
+        sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+}
+
+/* Returns false for peers that are neither IPv4 nor IPv6 */
+static bool knut_io_from_sockaddr(const sockaddr_union_t* peer, knut_io_addr_family_t* family,
+    knut_io_endpoint_t* endpoint)
+{
+    memset(endpoint, 0, sizeof(*endpoint));
+    *family = to_addr_family(peer->ipv4.sin_family);
+
+    if (*family == KNUT_IO_ADDR_FAMILY_IPV4)
+    {
+        endpoint->addr.ipv4.value = peer->ipv4.sin_addr.s_addr;
+        endpoint->port = peer->ipv4.sin_port;
+        return true;
+    }
+
+    if (*family == KNUT_IO_ADDR_FAMILY_IPV6)
+    {
+        memcpy(endpoint->addr.ipv6.value, &peer->ipv6.sin6_addr,
+            sizeof(endpoint->addr.ipv6.value));
+        endpoint->port = peer->ipv6.sin6_port;
+        endpoint->scope_id = peer->ipv6.sin6_scope_id;
+        return true;
+    }
+
+    return false;
+}
+
 int knut_io_getaddrinfo(const knut_io_getadddrinfo_args_t* args, knut_io_addrinfo_t* info)
 {
     struct addrinfo* _info = NULL;
     struct addrinfo hints;
 
-    ZeroMemory(&hints, sizeof(hints));
+    memset(&hints, 0, sizeof(hints));
     hints.ai_family = to_ai_family(args->family);
     hints.ai_socktype = to_ai_socktype(args->socket_type);
     hints.ai_protocol = to_ai_protocol(args->protocol);
@@ -201,106 +670,70 @@ int knut_io_getaddrinfo(const knut_io_getadddrinfo_args_t* args, knut_io_addrinf
         hints.ai_flags = AI_PASSIVE;
     }
     
+    memset(info, 0, sizeof(*info));
     const int result = getaddrinfo(args->node_name, args->service_name, &hints, &_info);
 
     if (result != 0)
     {
-        freeaddrinfo(_info);
         return result;
     }
 
-    struct addrinfo* current = _info;
-    ZeroMemory(info, sizeof(*info));
+    uint64_t capacity = 0;
 
-    for (uint64_t i = 0; current != NULL && i <= KNUT_IO_MAX_NUM_ADDRINFO; ++i)
+    for (struct addrinfo* current = _info; current != NULL; current = current->ai_next)
     {
-        knut_exit_if(i >= KNUT_IO_MAX_NUM_ADDRINFO, "TODO");
-        const knut_io_addr_family_t family = to_addr_family(current->ai_family);
+        ++capacity;
+    }
 
-        switch (family)
-        {
-        case KNUT_IO_ADDR_FAMILY_IPV4:
+    info->endpoints = (knut_io_endpoint_t*)calloc(capacity, sizeof(*info->endpoints));
+    info->families = (knut_io_addr_family_t*)calloc(capacity, sizeof(*info->families));
+    knut_exit_if(capacity > 0 && (!info->endpoints || !info->families),
+        "[knut_io_getaddrinfo] Failed to alloc entries\n");
+
+    for (struct addrinfo* current = _info; current != NULL; current = current->ai_next)
+    {
+        const uint64_t i = info->num_entires;
+
+        if (knut_io_from_sockaddr((const sockaddr_union_t*)current->ai_addr,
+            &info->families[i], &info->endpoints[i]))
         {
-            struct sockaddr_in* addr = (struct sockaddr_in*)current->ai_addr;
-            info->endpoints[i].addr.ipv4.value = addr->sin_addr.s_addr;
-            info->endpoints[i].port = addr->sin_port;
-            info->families[i] = family;
-            break;
+            ++info->num_entires;
         }
-        default:
-            knut_exit_if(false, "TODO");
-            break;
-        }
-
-        ++info->num_entires;
-        current = current->ai_next;
     }
 
     freeaddrinfo(_info);
     return result;
 }
 
+void knut_io_addrinfo_destroy(knut_io_addrinfo_t* info)
+{
+    free(info->endpoints);
+    free(info->families);
+    memset(info, 0, sizeof(*info));
+}
+
 knut_io_socket_t knut_io_socket(knut_io_addr_family_t family, knut_io_socket_type_t socktype, knut_io_protocol_type_t protocol)
 {
+    const int ai_protocol = family == KNUT_IO_ADDR_FAMILY_UNIX ? 0 : to_ai_protocol(protocol);
     knut_io_socket_t sock = {
-        .handle = socket(to_ai_family(family), to_ai_socktype(socktype), to_ai_protocol(protocol))
+        .handle = socket(to_ai_family(family), to_ai_socktype(socktype), ai_protocol)
     };
 
     return sock;
 }
 
-bool knut_io_socket_is_valid(knut_io_socket_t socket)
-{
-    return socket.handle != INVALID_SOCKET;
-}
-
-int knut_io_close(knut_io_socket_t socket)
-{
-    return closesocket(socket.handle);
-}
-
-typedef union {
-    struct sockaddr_in ipv4;
-    struct sockaddr_in6 ipv6;
-} sockaddr_union_t;
-
-sockaddr_union_t to_sockaddr_union(knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
-{
-    sockaddr_union_t sockaddrs = {0};
-
-    if (family == KNUT_IO_ADDR_FAMILY_IPV4)
-    {
-        struct sockaddr_in* addr = &sockaddrs.ipv4;
-        addr->sin_family = AF_INET;
-        addr->sin_addr.s_addr = endpoint->addr.ipv4.value;
-        addr->sin_port = endpoint->port;
-    }
-    else
-    {
-        knut_exit_if(false, "TODO");
-    }
-
-    return sockaddrs;
-}
-
 int knut_io_connect(knut_io_socket_t socket, knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
 {
     sockaddr_union_t sockaddrStorage = to_sockaddr_union(family, endpoint);
-    const bool is_ipv4 = family == KNUT_IO_ADDR_FAMILY_IPV4;
-    struct sockaddr* sockaddr = is_ipv4 ? (struct sockaddr*)&sockaddrStorage.ipv4 : (struct sockaddr*)&sockaddrStorage.ipv6;
-    int namelen = is_ipv4 ? sizeof(sockaddrStorage.ipv4) : sizeof(sockaddrStorage.ipv6);
-
-    return connect(socket.handle, sockaddr, namelen);
+    return connect(socket.handle, (struct sockaddr*)&sockaddrStorage,
+        knut_io_sockaddr_size(family));
 }
 
 int knut_io_bind(knut_io_socket_t socket, knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
 {
     sockaddr_union_t sockaddrStorage = to_sockaddr_union(family, endpoint);
-    const bool is_ipv4 = family == KNUT_IO_ADDR_FAMILY_IPV4;
-    struct sockaddr* sockaddr = is_ipv4 ? (struct sockaddr*)&sockaddrStorage.ipv4 : (struct sockaddr*)&sockaddrStorage.ipv6;
-    int namelen = is_ipv4 ? sizeof(sockaddrStorage.ipv4) : sizeof(sockaddrStorage.ipv6);
-
-    return bind(socket.handle, sockaddr, namelen);
+    return bind(socket.handle, (struct sockaddr*)&sockaddrStorage,
+        knut_io_sockaddr_size(family));
 }
 
 int knut_io_listen(knut_io_socket_t socket)
@@ -316,31 +749,628 @@ knut_io_socket_t knut_io_accept(knut_io_socket_t socket)
     return s;
 }
 
-int knut_io_send(knut_io_socket_t socket, const char* buffer, int buffer_size)
-{
-    return send(socket.handle, buffer, buffer_size, 0);
-}
-
-int knut_io_recv(knut_io_socket_t socket, char* buffer, int buffer_size)
+knut_io_socket_t knut_io_accept_with(knut_io_socket_t socket, uint32_t flags,
+    knut_io_addr_family_t* family, knut_io_endpoint_t* endpoint)
 {
-    return recv(socket.handle, buffer, buffer_size, 0);
-}
+    sockaddr_union_t peer;
+    knut_io_socklen_t peer_size = sizeof(peer);
+    memset(&peer, 0, sizeof(peer));
 
+#ifdef __linux__
+    const int accept_flags = ((flags & KNUT_IO_ACCEPT_NONBLOCK) != 0 ? SOCK_NONBLOCK : 0) |
+        ((flags & KNUT_IO_ACCEPT_CLOEXEC) != 0 ? SOCK_CLOEXEC : 0);
+    knut_io_socket_t s = {
+        .handle = accept4(socket.handle, (struct sockaddr*)&peer, &peer_size, accept_flags)
+    };
 #else
-    #error "TODO: impl non win"
-#endif // ifdef _WIN32
+    knut_io_socket_t s = {
+        .handle = accept(socket.handle, (struct sockaddr*)&peer, &peer_size)
+    };
 
-#define KNUT_IO_DEFAULT_BUFFER_SIZE 1024
+    if (knut_io_socket_is_valid(s) && (flags & KNUT_IO_ACCEPT_NONBLOCK) != 0)
+    {
+        knut_io_set_nonblocking(s, true);
+    }
 
-int knut_io_read_binary(knut_buffer_char_t* buffer, const char* path)
-{
-    uint16_t capacity = KNUT_IO_DEFAULT_BUFFER_SIZE;
-    buffer->ptr = calloc(capacity, sizeof(*buffer->ptr));
-    buffer->size = 0;
+    /* Winsock handles aren't inherited by child processes unless asked for */
+#ifndef _WIN32
+    if (knut_io_socket_is_valid(s) && (flags & KNUT_IO_ACCEPT_CLOEXEC) != 0)
+    {
+        fcntl(s.handle, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+#endif // ifdef __linux__
 
-    char batch_buffer[KNUT_IO_DEFAULT_BUFFER_SIZE] = {0};
-    uint64_t write_pos = 0;
-    int result = 0;
+    if (!knut_io_socket_is_valid(s))
+    {
+        return s;
+    }
+
+    knut_io_addr_family_t peer_family;
+    knut_io_endpoint_t peer_endpoint;
+    knut_io_from_sockaddr(&peer, &peer_family, &peer_endpoint);
+
+    if (family != NULL)
+    {
+        /* Unix peers of unbound sockets come without an address family */
+        *family = peer_family == KNUT_IO_ADDR_FAMILY_UNSPEC ?
+            KNUT_IO_ADDR_FAMILY_UNIX : peer_family;
+    }
+
+    if (endpoint != NULL)
+    {
+        *endpoint = peer_endpoint;
+    }
+
+    return s;
+}
+
+int knut_io_send(knut_io_socket_t socket, const char* buffer, int buffer_size)
+{
+    return (int)send(socket.handle, buffer, buffer_size, KNUT_IO_SEND_FLAGS);
+}
+
+int knut_io_recv(knut_io_socket_t socket, char* buffer, int buffer_size)
+{
+    return (int)recv(socket.handle, buffer, buffer_size, 0);
+}
+
+static int knut_io_unix_address(struct sockaddr_un* addr, const char* path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+
+    const uint64_t length = strlen(path);
+
+    if (length >= sizeof(addr->sun_path))
+    {
+        return -1;
+    }
+
+    memcpy(addr->sun_path, path, length);
+    return 0;
+}
+
+int knut_io_bind_unix(knut_io_socket_t socket, const char* path)
+{
+    struct sockaddr_un addr;
+
+    if (knut_io_unix_address(&addr, path) != 0)
+    {
+        return -1;
+    }
+
+    return bind(socket.handle, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+int knut_io_connect_unix(knut_io_socket_t socket, const char* path)
+{
+    struct sockaddr_un addr;
+
+    if (knut_io_unix_address(&addr, path) != 0)
+    {
+        return -1;
+    }
+
+    return connect(socket.handle, (struct sockaddr*)&addr, sizeof(addr));
+}
+
+#define KNUT_IO_MAX_CALL_SIZE (1 << 30)
+
+int knut_io_send_all(knut_io_socket_t socket, const char* buffer, uint64_t size)
+{
+    while (size > 0)
+    {
+        const int chunk = size < KNUT_IO_MAX_CALL_SIZE ? (int)size : KNUT_IO_MAX_CALL_SIZE;
+        const int sent = knut_io_send(socket, buffer, chunk);
+
+        if (sent <= 0)
+        {
+            return -1;
+        }
+
+        buffer += sent;
+        size -= sent;
+    }
+
+    return 0;
+}
+
+int knut_io_recv_all(knut_io_socket_t socket, char* buffer, uint64_t size)
+{
+    while (size > 0)
+    {
+        const int chunk = size < KNUT_IO_MAX_CALL_SIZE ? (int)size : KNUT_IO_MAX_CALL_SIZE;
+        const int received = knut_io_recv(socket, buffer, chunk);
+
+        if (received <= 0)
+        {
+            return -1;
+        }
+
+        buffer += received;
+        size -= received;
+    }
+
+    return 0;
+}
+
+/* Fills at most KNUT_IO_MAX_IOVECS native buffers with at most KNUT_IO_MAX_CALL_SIZE bytes */
+static uint64_t knut_io_fill_iovecs(const knut_io_iovec_t* iovecs, uint64_t count,
+    knut_io_native_iovec_t* native)
+{
+    uint64_t num_native = 0;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < count && num_native < KNUT_IO_MAX_IOVECS &&
+        total < KNUT_IO_MAX_CALL_SIZE; ++i)
+    {
+        const uint64_t left = KNUT_IO_MAX_CALL_SIZE - total;
+        const uint64_t size = iovecs[i].size < left ? iovecs[i].size : left;
+
+        if (size == 0)
+        {
+            continue;
+        }
+
+#ifdef _WIN32
+        native[num_native].buf = iovecs[i].data;
+        native[num_native].len = (ULONG)size;
+#else
+        native[num_native].iov_base = iovecs[i].data;
+        native[num_native].iov_len = (size_t)size;
+#endif
+        ++num_native;
+        total += size;
+    }
+
+    return num_native;
+}
+
+int64_t knut_io_sendv(knut_io_socket_t socket, const knut_io_iovec_t* iovecs, uint64_t count)
+{
+    knut_io_native_iovec_t native[KNUT_IO_MAX_IOVECS];
+    const uint64_t num_native = knut_io_fill_iovecs(iovecs, count, native);
+
+    if (num_native == 0)
+    {
+        return 0;
+    }
+
+#ifdef _WIN32
+    DWORD sent;
+    if (WSASend(socket.handle, native, (DWORD)num_native, &sent, 0, NULL, NULL) != 0)
+    {
+        return -1;
+    }
+    return (int64_t)sent;
+#else
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = native;
+    message.msg_iovlen = num_native;
+    return (int64_t)sendmsg(socket.handle, &message, KNUT_IO_SEND_FLAGS);
+#endif
+}
+
+int64_t knut_io_recvv(knut_io_socket_t socket, const knut_io_iovec_t* iovecs, uint64_t count)
+{
+    knut_io_native_iovec_t native[KNUT_IO_MAX_IOVECS];
+    const uint64_t num_native = knut_io_fill_iovecs(iovecs, count, native);
+
+    if (num_native == 0)
+    {
+        return 0;
+    }
+
+#ifdef _WIN32
+    DWORD received;
+    DWORD flags = 0;
+    if (WSARecv(socket.handle, native, (DWORD)num_native, &received, &flags, NULL, NULL) != 0)
+    {
+        return -1;
+    }
+    return (int64_t)received;
+#else
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = native;
+    message.msg_iovlen = num_native;
+    return (int64_t)recvmsg(socket.handle, &message, 0);
+#endif
+}
+
+int knut_io_sendv_all(knut_io_socket_t socket, knut_io_iovec_t* iovecs, uint64_t count)
+{
+    while (count > 0)
+    {
+        if (iovecs->size == 0)
+        {
+            ++iovecs;
+            --count;
+            continue;
+        }
+
+        int64_t sent = knut_io_sendv(socket, iovecs, count);
+
+        if (sent <= 0)
+        {
+            return -1;
+        }
+
+        for (; sent > 0 && (uint64_t)sent >= iovecs->size; --count)
+        {
+            sent -= iovecs->size;
+            ++iovecs;
+        }
+
+        if (sent > 0)
+        {
+            iovecs->data += sent;
+            iovecs->size -= sent;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct {
+#ifdef KNUT_IO_HAS_MMSG
+    struct mmsghdr messages[KNUT_IO_MAX_BATCH_SIZE];
+#endif
+    knut_io_native_iovec_t iovecs[KNUT_IO_MAX_BATCH_SIZE];
+    sockaddr_union_t peers[KNUT_IO_MAX_BATCH_SIZE];
+} knut_io_packet_native_t;
+
+void knut_io_packet_batch_init(knut_io_packet_batch_t* batch, uint32_t num_packets,
+    uint32_t packet_size)
+{
+    KNUT_ASSERT(num_packets > 0 && num_packets <= KNUT_IO_MAX_BATCH_SIZE,
+        "[knut_io_packet_batch_init] Invalid number of packets\n");
+
+    batch->buffer = (char*)malloc((uint64_t)num_packets * packet_size);
+    batch->packets = (knut_io_packet_t*)calloc(num_packets, sizeof(*batch->packets));
+    batch->native = calloc(1, sizeof(knut_io_packet_native_t));
+    knut_exit_if(!batch->buffer || !batch->packets || !batch->native,
+        "[knut_io_packet_batch_init] Failed to alloc packets\n");
+    batch->num_packets = num_packets;
+    batch->packet_size = packet_size;
+
+    for (uint32_t i = 0; i < num_packets; ++i)
+    {
+        batch->packets[i].data = batch->buffer + (uint64_t)i * packet_size;
+    }
+
+#ifdef KNUT_IO_HAS_MMSG
+    knut_io_packet_native_t* native = (knut_io_packet_native_t*)batch->native;
+
+    for (uint32_t i = 0; i < num_packets; ++i)
+    {
+        native->messages[i].msg_hdr.msg_iov = &native->iovecs[i];
+        native->messages[i].msg_hdr.msg_iovlen = 1;
+    }
+#endif
+}
+
+void knut_io_packet_batch_destroy(knut_io_packet_batch_t* batch)
+{
+    free(batch->buffer);
+    free(batch->packets);
+    free(batch->native);
+    memset(batch, 0, sizeof(*batch));
+}
+
+static void knut_io_set_iovec(knut_io_native_iovec_t* iovec, char* data, uint64_t size)
+{
+#ifdef _WIN32
+    iovec->buf = data;
+    iovec->len = (ULONG)size;
+#else
+    iovec->iov_base = data;
+    iovec->iov_len = (size_t)size;
+#endif
+}
+
+int64_t knut_io_recv_batch(knut_io_socket_t socket, knut_io_packet_batch_t* batch)
+{
+    knut_io_packet_native_t* native = (knut_io_packet_native_t*)batch->native;
+
+#ifdef KNUT_IO_HAS_MMSG
+    for (uint32_t i = 0; i < batch->num_packets; ++i)
+    {
+        knut_io_set_iovec(&native->iovecs[i], batch->buffer + (uint64_t)i * batch->packet_size,
+            batch->packet_size);
+        native->messages[i].msg_hdr.msg_name = &native->peers[i];
+        native->messages[i].msg_hdr.msg_namelen = sizeof(native->peers[i]);
+    }
+
+    const int received = recvmmsg(socket.handle, native->messages, batch->num_packets,
+        MSG_WAITFORONE, NULL);
+
+    for (int i = 0; i < received; ++i)
+    {
+        knut_io_packet_t* packet = &batch->packets[i];
+        packet->data = batch->buffer + (uint64_t)i * batch->packet_size;
+        packet->size = native->messages[i].msg_len;
+        packet->has_endpoint = native->messages[i].msg_hdr.msg_namelen > 0 &&
+            knut_io_from_sockaddr(&native->peers[i], &packet->family, &packet->endpoint);
+    }
+
+    return received;
+#else
+    /* Only the first datagram is waited for, the rest is taken while the socket is readable */
+    int64_t received = 0;
+
+    for (; received < batch->num_packets; ++received)
+    {
+        if (received > 0)
+        {
+            knut_io_pollfd_t fd = { socket.handle, POLLIN, 0 };
+
+            if (knut_io_poll(&fd, 1, 0) <= 0 || (fd.revents & POLLIN) == 0)
+            {
+                break;
+            }
+        }
+
+        knut_io_packet_t* packet = &batch->packets[received];
+        sockaddr_union_t* peer = &native->peers[received];
+        knut_io_socklen_t peer_size = sizeof(*peer);
+        packet->data = batch->buffer + (uint64_t)received * batch->packet_size;
+        int64_t size = (int64_t)recvfrom(socket.handle, packet->data, (int)batch->packet_size,
+            0, (struct sockaddr*)peer, &peer_size);
+
+#ifdef _WIN32
+        /* Winsock reports cut datagrams as errors */
+        if (size < 0 && WSAGetLastError() == WSAEMSGSIZE)
+        {
+            size = batch->packet_size;
+        }
+#endif
+
+        if (size < 0)
+        {
+            return received > 0 ? received : -1;
+        }
+
+        packet->size = (uint64_t)size;
+        packet->has_endpoint = peer_size > 0 &&
+            knut_io_from_sockaddr(peer, &packet->family, &packet->endpoint);
+    }
+
+    return received;
+#endif // ifdef KNUT_IO_HAS_MMSG
+}
+
+int64_t knut_io_send_batch(knut_io_socket_t socket, knut_io_packet_batch_t* batch,
+    uint64_t count)
+{
+    KNUT_ASSERT(count <= batch->num_packets, "[knut_io_send_batch] Batch is too small\n");
+    knut_io_packet_native_t* native = (knut_io_packet_native_t*)batch->native;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const knut_io_packet_t* packet = &batch->packets[i];
+
+        if (packet->has_endpoint)
+        {
+            native->peers[i] = to_sockaddr_union(packet->family, &packet->endpoint);
+        }
+    }
+
+#ifdef KNUT_IO_HAS_MMSG
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        const knut_io_packet_t* packet = &batch->packets[i];
+        knut_io_set_iovec(&native->iovecs[i], packet->data, packet->size);
+        native->messages[i].msg_hdr.msg_name = packet->has_endpoint ? &native->peers[i] : NULL;
+        native->messages[i].msg_hdr.msg_namelen = packet->has_endpoint ?
+            knut_io_sockaddr_size(packet->family) : 0;
+    }
+
+    return count == 0 ? 0 :
+        (int64_t)sendmmsg(socket.handle, native->messages, (unsigned int)count,
+            KNUT_IO_SEND_FLAGS);
+#else
+    uint64_t sent = 0;
+
+    for (; sent < count; ++sent)
+    {
+        const knut_io_packet_t* packet = &batch->packets[sent];
+        const struct sockaddr* peer = packet->has_endpoint ?
+            (const struct sockaddr*)&native->peers[sent] : NULL;
+        const knut_io_socklen_t peer_size = packet->has_endpoint ?
+            knut_io_sockaddr_size(packet->family) : 0;
+
+        if (sendto(socket.handle, packet->data, (int)packet->size, KNUT_IO_SEND_FLAGS, peer,
+            peer_size) < 0)
+        {
+            return sent > 0 ? (int64_t)sent : -1;
+        }
+    }
+
+    return (int64_t)sent;
+#endif // ifdef KNUT_IO_HAS_MMSG
+}
+
+int knut_io_sendfile(knut_io_socket_t socket, const knut_io_mapped_file_t* file, uint64_t offset,
+    uint64_t size)
+{
+    KNUT_ASSERT(offset <= file->size && size <= file->size - offset,
+        "[knut_io_sendfile] Range is outside of the file\n");
+
+#if defined(_WIN32)
+    while (size > 0)
+    {
+        const DWORD chunk = size < KNUT_IO_MAX_CALL_SIZE ? (DWORD)size : KNUT_IO_MAX_CALL_SIZE;
+        LARGE_INTEGER position;
+        position.QuadPart = (LONGLONG)offset;
+
+        if (!SetFilePointerEx((HANDLE)file->file_handle, position, NULL, FILE_BEGIN) ||
+            !TransmitFile(socket.handle, (HANDLE)file->file_handle, chunk, 0, NULL, NULL, 0))
+        {
+            return -1;
+        }
+
+        offset += chunk;
+        size -= chunk;
+    }
+
+    return 0;
+#elif defined(__linux__)
+    off_t position = (off_t)offset;
+
+    while (size > 0)
+    {
+        const size_t chunk = size < KNUT_IO_MAX_CALL_SIZE ? (size_t)size : KNUT_IO_MAX_CALL_SIZE;
+        const ssize_t sent = sendfile(socket.handle, file->fd, &position, chunk);
+
+        if (sent <= 0)
+        {
+            return -1;
+        }
+
+        size -= (uint64_t)sent;
+    }
+
+    return 0;
+#else
+    return knut_io_send_all(socket, file->ptr + offset, size);
+#endif
+}
+
+void knut_io_zerocopy_init(knut_io_zerocopy_t* zerocopy, knut_io_socket_t socket)
+{
+    memset(zerocopy, 0, sizeof(*zerocopy));
+    zerocopy->socket = socket;
+
+#ifdef KNUT_IO_HAS_ZEROCOPY
+    const int enable = 1;
+    zerocopy->enabled = setsockopt(socket.handle, SOL_SOCKET, SO_ZEROCOPY, &enable,
+        sizeof(enable)) == 0;
+#endif
+}
+
+int knut_io_zerocopy_send(knut_io_zerocopy_t* zerocopy, const char* buffer, uint64_t size,
+    uint32_t* id)
+{
+    if (!zerocopy->enabled)
+    {
+        *id = zerocopy->next_id;
+        zerocopy->completed = ++zerocopy->next_id;
+        return knut_io_send_all(zerocopy->socket, buffer, size);
+    }
+
+#ifdef KNUT_IO_HAS_ZEROCOPY
+    /* Every successful call takes the next id, the whole buffer is done with the last one */
+    while (size > 0)
+    {
+        const size_t chunk = size < KNUT_IO_MAX_CALL_SIZE ? (size_t)size : KNUT_IO_MAX_CALL_SIZE;
+        const ssize_t sent = send(zerocopy->socket.handle, buffer, chunk,
+            MSG_ZEROCOPY | KNUT_IO_SEND_FLAGS);
+
+        if (sent < 0 && errno == ENOBUFS && zerocopy->completed != zerocopy->next_id)
+        {
+            /* Too many pages pinned, wait for older sends to give some back */
+            if (knut_io_zerocopy_wait(zerocopy, zerocopy->next_id - 1) != 0)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        if (sent <= 0)
+        {
+            return -1;
+        }
+
+        *id = zerocopy->next_id++;
+        buffer += sent;
+        size -= (uint64_t)sent;
+    }
+#endif
+
+    return 0;
+}
+
+void knut_io_zerocopy_poll(knut_io_zerocopy_t* zerocopy)
+{
+#ifdef KNUT_IO_HAS_ZEROCOPY
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+
+    while (zerocopy->enabled)
+    {
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        if (recvmsg(zerocopy->socket.handle, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            return;
+        }
+
+        for (struct cmsghdr* header = CMSG_FIRSTHDR(&message); header != NULL;
+            header = CMSG_NXTHDR(&message, header))
+        {
+            const struct sock_extended_err* error =
+                (const struct sock_extended_err*)CMSG_DATA(header);
+
+            if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+
+            /* ee_info to ee_data is the range of ids that completed */
+            if ((int32_t)(error->ee_data + 1 - zerocopy->completed) > 0)
+            {
+                zerocopy->completed = error->ee_data + 1;
+            }
+
+            zerocopy->copied |= (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+        }
+    }
+#else
+    (void)zerocopy;
+#endif
+}
+
+bool knut_io_zerocopy_is_done(const knut_io_zerocopy_t* zerocopy, uint32_t id)
+{
+    return (int32_t)(zerocopy->completed - id) > 0;
+}
+
+int knut_io_zerocopy_wait(knut_io_zerocopy_t* zerocopy, uint32_t id)
+{
+    knut_io_zerocopy_poll(zerocopy);
+
+    while (!knut_io_zerocopy_is_done(zerocopy, id))
+    {
+        /* Pending completions show up as POLLERR */
+        knut_io_pollfd_t fd = { zerocopy->socket.handle, 0, 0 };
+
+        if (knut_io_poll(&fd, 1, -1) < 0 || (fd.revents & POLLERR) == 0)
+        {
+            return -1;
+        }
+
+        knut_io_zerocopy_poll(zerocopy);
+    }
+
+    return 0;
+}
+
+#define KNUT_IO_DEFAULT_BUFFER_SIZE 1024
+
+int knut_io_read_binary(knut_buffer_char_t* buffer, const char* path)
+{
+    uint64_t capacity = KNUT_IO_DEFAULT_BUFFER_SIZE;
+    buffer->ptr = calloc(capacity, sizeof(*buffer->ptr));
+    buffer->size = 0;
+
+    char batch_buffer[KNUT_IO_DEFAULT_BUFFER_SIZE] = {0};
+    uint64_t write_pos = 0;
+    int result = 0;
 
     FILE* file_handle = fopen(path, "rb");
 
@@ -384,4 +1414,445 @@ done:
     return result;
 }
 
+#ifdef _WIN32
+
+static int knut_io_map_file_with(knut_io_mapped_file_t* file, const char* path,
+    bool copy_on_write)
+{
+    memset(file, 0, sizeof(*file));
+
+    HANDLE file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file_handle, &size))
+    {
+        CloseHandle(file_handle);
+        return -1;
+    }
+
+    if (size.QuadPart == 0)
+    {
+        CloseHandle(file_handle);
+        return 0;
+    }
+
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL,
+        copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    const char* ptr = mapping_handle != NULL ? (const char*)MapViewOfFile(mapping_handle,
+        copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+
+    if (ptr == NULL)
+    {
+        if (mapping_handle != NULL) { CloseHandle(mapping_handle); }
+        CloseHandle(file_handle);
+        return -1;
+    }
+
+    file->ptr = ptr;
+    file->size = (uint64_t)size.QuadPart;
+    file->file_handle = file_handle;
+    file->mapping_handle = mapping_handle;
+    return 0;
+}
+
+int knut_io_map_file(knut_io_mapped_file_t* file, const char* path)
+{
+    return knut_io_map_file_with(file, path, false);
+}
+
+int knut_io_map_file_private(knut_io_mapped_file_t* file, const char* path)
+{
+    return knut_io_map_file_with(file, path, true);
+}
+
+int knut_io_map_file_writable(knut_io_mapped_file_t* file, const char* path, uint64_t size)
+{
+    memset(file, 0, sizeof(*file));
+    KNUT_ASSERT(size > 0, "[knut_io_map_file_writable] Size must not be 0\n");
+
+    HANDLE file_handle = CreateFileA(path, GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file_handle == INVALID_HANDLE_VALUE)
+    {
+        return -1;
+    }
+
+    /* A mapping larger than the file grows it */
+    HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READWRITE,
+        (DWORD)(size >> 32), (DWORD)size, NULL);
+    const char* ptr = mapping_handle != NULL ? (const char*)MapViewOfFile(mapping_handle,
+        FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, (SIZE_T)size) : NULL;
+
+    if (ptr == NULL)
+    {
+        if (mapping_handle != NULL) { CloseHandle(mapping_handle); }
+        CloseHandle(file_handle);
+        return -1;
+    }
+
+    file->ptr = ptr;
+    file->size = size;
+    file->file_handle = file_handle;
+    file->mapping_handle = mapping_handle;
+    return 0;
+}
+
+void knut_io_unmap_file(knut_io_mapped_file_t* file)
+{
+    if (file->ptr != NULL)
+    {
+        UnmapViewOfFile(file->ptr);
+        CloseHandle(file->mapping_handle);
+        CloseHandle(file->file_handle);
+    }
+
+    memset(file, 0, sizeof(*file));
+}
+
+#else
+
+static int knut_io_map_file_with(knut_io_mapped_file_t* file, const char* path,
+    bool copy_on_write)
+{
+    memset(file, 0, sizeof(*file));
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    const int protection = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* ptr = mmap(NULL, (size_t)info.st_size, protection, MAP_PRIVATE, fd, 0);
+
+    if (ptr == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    /* Stays open for knut_io_sendfile */
+    madvise(ptr, (size_t)info.st_size, MADV_SEQUENTIAL);
+    file->ptr = (const char*)ptr;
+    file->size = (uint64_t)info.st_size;
+    file->fd = fd;
+    return 0;
+}
+
+int knut_io_map_file(knut_io_mapped_file_t* file, const char* path)
+{
+    return knut_io_map_file_with(file, path, false);
+}
+
+int knut_io_map_file_private(knut_io_mapped_file_t* file, const char* path)
+{
+    return knut_io_map_file_with(file, path, true);
+}
+
+int knut_io_map_file_writable(knut_io_mapped_file_t* file, const char* path, uint64_t size)
+{
+    memset(file, 0, sizeof(*file));
+    KNUT_ASSERT(size > 0, "[knut_io_map_file_writable] Size must not be 0\n");
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    struct stat info;
+
+    if (fstat(fd, &info) != 0 ||
+        ((uint64_t)info.st_size < size && ftruncate(fd, (off_t)size) != 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void* ptr = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (ptr == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    file->ptr = (const char*)ptr;
+    file->size = size;
+    file->fd = fd;
+    return 0;
+}
+
+void knut_io_unmap_file(knut_io_mapped_file_t* file)
+{
+    if (file->ptr != NULL)
+    {
+        munmap((void*)file->ptr, file->size);
+        close(file->fd);
+    }
+
+    memset(file, 0, sizeof(*file));
+}
+
+#endif // ifdef _WIN32
+
+/* Writes the start of the line after every line break in [begin, end) to 'starts' if it isn't
+ * NULL and returns the number of line breaks */
+static uint64_t knut_io_find_line_starts(const char* data, uint64_t begin, uint64_t end, 
+    uint64_t* starts)
+{
+    uint64_t count = 0;
+    const char* current = data + begin;
+    const char* const last = data + end;
+
+    while (current < last && (current = (const char*)memchr(current, '\n', last - current)))
+    {
+        if (starts != NULL) { starts[count] = current - data + 1; }
+        ++count;
+        ++current;
+    }
+
+    return count;
+}
+
+#ifdef KNUT_ARCH_X86
+
+KNUT_TARGET_AVX2 static uint64_t knut_io_find_line_starts_avx2(const char* data, 
+    uint64_t begin, uint64_t end, uint64_t* starts)
+{
+    const __m256i line_break = _mm256_set1_epi8('\n');
+    uint64_t count = 0;
+    uint64_t i = begin;
+
+    for (; i + 64 <= end; i += 64)
+    {
+        const __m256i low = _mm256_loadu_si256((const __m256i*)(data + i));
+        const __m256i high = _mm256_loadu_si256((const __m256i*)(data + i + 32));
+        uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, line_break)) | 
+            (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, line_break)) << 32;
+
+        if (starts == NULL)
+        {
+            count += knut_popcount_u64(mask);
+            continue;
+        }
+
+        while (mask != 0)
+        {
+            starts[count++] = i + knut_ctz_u64(mask) + 1;
+            mask &= mask - 1;
+        }
+    }
+
+    return count + knut_io_find_line_starts(data, i, end, starts ? starts + count : NULL);
+}
+
+#endif // ifdef KNUT_ARCH_X86
+
+typedef struct {
+    const char* data;
+    uint64_t begin;
+    uint64_t end;
+    uint64_t* starts;
+    uint64_t count;
+    bool use_avx2;
+} knut_io_line_chunk_t;
+
+static void knut_io_scan_chunk(void* arg)
+{
+    knut_io_line_chunk_t* chunk = (knut_io_line_chunk_t*)arg;
+
+#ifdef KNUT_ARCH_X86
+    if (chunk->use_avx2)
+    {
+        chunk->count = knut_io_find_line_starts_avx2(chunk->data, chunk->begin, chunk->end, 
+            chunk->starts);
+        return;
+    }
+#endif
+
+    chunk->count = knut_io_find_line_starts(chunk->data, chunk->begin, chunk->end, 
+        chunk->starts);
+}
+
+static void knut_io_scan_chunks(knut_io_line_chunk_t* chunks, uint32_t num_chunks, 
+    knut_io_run_tasks_t run_tasks)
+{
+    if (num_chunks == 1)
+    {
+        knut_io_scan_chunk(&chunks[0]);
+        return;
+    }
+
+    knut_function_t tasks[64];
+
+    for (uint32_t i = 0; i < num_chunks; ++i)
+    {
+        tasks[i] = (knut_function_t){ knut_io_scan_chunk, &chunks[i] };
+    }
+
+    run_tasks(tasks, num_chunks);
+}
+
+/* Counts the line breaks of every chunk first, then each chunk writes its starts at its own
+ * offset of the final array */
+int knut_io_index_lines(knut_io_line_index_t* index, const char* data, uint64_t size, 
+    uint32_t num_chunks, knut_io_run_tasks_t run_tasks)
+{
+    num_chunks = run_tasks != NULL && size >= KNUT_IO_PARALLEL_INDEX_MIN_SIZE ? num_chunks : 1;
+    num_chunks = num_chunks < 64 ? num_chunks : 64;
+    num_chunks = num_chunks > 0 && size / num_chunks >= 64 ? num_chunks : 1;
+
+    knut_io_line_chunk_t chunks[64];
+    const bool use_avx2 = knut_cpu_isa() >= KNUT_CPU_ISA_AVX2;
+
+    for (uint32_t i = 0; i < num_chunks; ++i)
+    {
+        const knut_io_line_chunk_t chunk = {
+            data, size * i / num_chunks, size * (i + 1) / num_chunks, NULL, 0, use_avx2
+        };
+        chunks[i] = chunk;
+    }
+
+    knut_io_scan_chunks(chunks, num_chunks, run_tasks);
+
+    uint64_t num_line_breaks = 0;
+
+    for (uint32_t i = 0; i < num_chunks; ++i)
+    {
+        num_line_breaks += chunks[i].count;
+    }
+
+    index->starts = (uint64_t*)malloc((num_line_breaks + 2) * sizeof(*index->starts));
+
+    if (index->starts == NULL)
+    {
+        index->num_lines = 0;
+        return -1;
+    }
+
+    index->starts[0] = 0;
+    uint64_t offset = 1;
+
+    for (uint32_t i = 0; i < num_chunks; ++i)
+    {
+        chunks[i].starts = index->starts + offset;
+        offset += chunks[i].count;
+    }
+
+    knut_io_scan_chunks(chunks, num_chunks, run_tasks);
+
+    /* A missing trailing line break still ends the last line */
+    if (index->starts[num_line_breaks] != size)
+    {
+        index->starts[++num_line_breaks] = size + 1;
+    }
+
+    index->num_lines = num_line_breaks;
+    return 0;
+}
+
+void knut_io_line_index_destroy(knut_io_line_index_t* index)
+{
+    free(index->starts);
+    index->starts = NULL;
+    index->num_lines = 0;
+}
+
+uint64_t knut_io_line_length(const knut_io_line_index_t* index, uint64_t line)
+{
+    KNUT_ASSERT(line < index->num_lines, "[knut_io_line_length] Line out of range\n");
+    return index->starts[line + 1] - index->starts[line] - 1;
+}
+
+int64_t knut_io_grid_width(const knut_io_line_index_t* index, const char* data)
+{
+    if (index->num_lines == 0)
+    {
+        return 0;
+    }
+
+    const uint64_t width = knut_io_line_length(index, 0);
+
+    for (uint64_t i = 1; i < index->num_lines; ++i)
+    {
+        if (knut_io_line_length(index, i) != width)
+        {
+            return -1;
+        }
+    }
+
+    /* Windows line breaks leave a '\r' at the end of every line */
+    return width > 0 && data[width - 1] == '\r' ? (int64_t)width - 1 : (int64_t)width;
+}
+
+int knut_io_read_grid(knut_buffer_char_t* grid, uint64_t* width, uint64_t* height, 
+    const char* path)
+{
+    knut_io_mapped_file_t file;
+
+    if (knut_io_map_file(&file, path) != 0)
+    {
+        return -1;
+    }
+
+    knut_io_line_index_t lines;
+
+    if (knut_io_index_lines(&lines, file.ptr, file.size, 1, NULL) != 0)
+    {
+        knut_io_unmap_file(&file);
+        return -1;
+    }
+
+    const int64_t grid_width = knut_io_grid_width(&lines, file.ptr);
+    int result = grid_width >= 0 ? 0 : -2;
+
+    if (result == 0)
+    {
+        *width = (uint64_t)grid_width;
+        *height = lines.num_lines;
+        grid->size = *width * *height;
+        grid->ptr = (char*)malloc(grid->size + 1);
+        result = grid->ptr != NULL ? 0 : -1;
+    }
+
+    for (uint64_t i = 0; result == 0 && i < lines.num_lines; ++i)
+    {
+        memcpy(grid->ptr + i * *width, file.ptr + lines.starts[i], *width);
+    }
+
+    if (result == 0)
+    {
+        grid->ptr[grid->size] = '\0';
+    }
+
+    knut_io_line_index_destroy(&lines);
+    knut_io_unmap_file(&file);
+    return result;
+}
+
 #endif // KNUT_IO_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,405 @@
+#ifndef KNUT_IO_CLIENT_INCLUDE_H
+#define KNUT_IO_CLIENT_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+#include "knut_io.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Responses start with a header of 'header_size' bytes that tells how many bytes follow it */
+typedef struct {
+    uint64_t header_size;
+    uint64_t (*body_size)(void* ctx, const char* header);
+    void* ctx;
+} knut_io_client_framing_t;
+
+/* Persistent TCP connection with Nagle turned off. Requests written between two flushes are
+ * corked and leave together, responses come back in request order. Where the socket can't be
+ * corked the requests are buffered until the flush instead. */
+typedef struct {
+    knut_io_socket_t socket;
+    const knut_io_client_framing_t* framing;
+    knut_array_char_t input;
+    uint64_t input_start;
+    knut_array_char_t output;
+    uint64_t in_flight;
+    uint32_t pool;
+    bool can_cork;
+    bool corked;
+    bool broken;
+} knut_io_client_connection_t;
+
+typedef knut_io_client_connection_t* knut_io_client_connection_ptr_t;
+
+KNUT_DEFINE_ARRAY(knut_io_client_connection_ptr_t, io_client_connection)
+
+typedef struct {
+    knut_io_addr_family_t family;
+    knut_io_endpoint_t endpoint;
+    knut_array_io_client_connection_t idle;
+    uint32_t num_open;
+} knut_io_client_pool_t;
+
+KNUT_DEFINE_ARRAY(knut_io_client_pool_t, io_client_pool)
+
+/* One pool of connections per endpoint, connections are opened on demand and kept open until
+ * the client is destroyed. Acquire and release may be called from several threads, a single
+ * connection belongs to one thread at a time. */
+typedef struct {
+    knut_io_client_framing_t framing;
+    knut_array_io_client_pool_t pools;
+    uint32_t max_connections;
+    atomic_flag lock;
+} knut_io_client_t;
+
+/* 'max_connections' limits the open connections per endpoint */
+void knut_io_client_init(knut_io_client_t* client, const knut_io_client_framing_t* framing,
+    uint32_t max_connections);
+/* Every connection must have been released */
+void knut_io_client_destroy(knut_io_client_t* client);
+
+/* Reuses an idle connection to the endpoint or opens a new one, returns NULL if the pool is
+ * exhausted or the endpoint can't be reached */
+knut_io_client_connection_t* knut_io_client_acquire(knut_io_client_t* client,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint);
+/* Broken connections and connections with unread responses are closed instead of pooled */
+void knut_io_client_release(knut_io_client_t* client, knut_io_client_connection_t* connection);
+
+/* Queues one request made of the buffers, at most KNUT_IO_MAX_IOVECS of them */
+int knut_io_client_write(knut_io_client_connection_t* connection, const knut_io_iovec_t* iovecs,
+    uint64_t count);
+/* Uncorks the connection so everything written so far goes out */
+int knut_io_client_flush(knut_io_client_connection_t* connection);
+/* Flushes and waits for the next response. 'response' points into the connection and stays
+ * valid until the next read. */
+int knut_io_client_read(knut_io_client_connection_t* connection, const char** response,
+    uint64_t* size);
+
+#endif // KNUT_IO_CLIENT_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_IO_CLIENT_IMPLEMENTATION) && !defined(KNUT_IO_CLIENT_IMPLEMENTATION_DONE)
+#define KNUT_IO_CLIENT_IMPLEMENTATION_DONE
+
+#if !defined(KNUT_DS_IMPLEMENTATION_DONE) || !defined(KNUT_IO_IMPLEMENTATION_DONE)
+#error "'knut_ds.h' and 'knut_io.h' must be implemented before this header can be used"
+#endif
+
+#include <string.h>
+
+#define KNUT_IO_CLIENT_RECV_SIZE (64 * 1024)
+
+static void knut_io_client_lock(knut_io_client_t* client)
+{
+    while (atomic_flag_test_and_set_explicit(&client->lock, memory_order_acquire)) {}
+}
+
+static void knut_io_client_unlock(knut_io_client_t* client)
+{
+    atomic_flag_clear_explicit(&client->lock, memory_order_release);
+}
+
+void knut_io_client_init(knut_io_client_t* client, const knut_io_client_framing_t* framing,
+    uint32_t max_connections)
+{
+    KNUT_ASSERT(max_connections > 0, "[knut_io_client_init] Need at least one connection\n");
+    KNUT_ASSERT(framing->header_size > 0, "[knut_io_client_init] Responses need a header\n");
+
+    client->framing = *framing;
+    client->pools = knut_array_io_client_pool_create_with(4, NULL);
+    client->max_connections = max_connections;
+    atomic_flag_clear(&client->lock);
+}
+
+static void knut_io_client_connection_close(knut_io_client_connection_t* connection)
+{
+    knut_io_close(connection->socket);
+    knut_array_char_destroy(&connection->input);
+    knut_array_char_destroy(&connection->output);
+    free(connection);
+}
+
+void knut_io_client_destroy(knut_io_client_t* client)
+{
+    for (uint64_t i = 0; i < client->pools.size; ++i)
+    {
+        knut_io_client_pool_t* pool = &client->pools.buffer[i];
+        KNUT_ASSERT(pool->idle.size == pool->num_open,
+            "[knut_io_client_destroy] Connections are still in use\n");
+
+        for (uint64_t j = 0; j < pool->idle.size; ++j)
+        {
+            knut_io_client_connection_close(pool->idle.buffer[j]);
+        }
+
+        knut_array_io_client_connection_destroy(&pool->idle);
+    }
+
+    knut_array_io_client_pool_destroy(&client->pools);
+}
+
+static bool knut_io_client_same_endpoint(const knut_io_client_pool_t* pool,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
+{
+    return pool->family == family && pool->endpoint.port == endpoint->port &&
+        pool->endpoint.scope_id == endpoint->scope_id &&
+        memcmp(&pool->endpoint.addr, &endpoint->addr, sizeof(endpoint->addr)) == 0;
+}
+
+static uint32_t knut_io_client_find_pool(knut_io_client_t* client,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
+{
+    for (uint64_t i = 0; i < client->pools.size; ++i)
+    {
+        if (knut_io_client_same_endpoint(&client->pools.buffer[i], family, endpoint))
+        {
+            return (uint32_t)i;
+        }
+    }
+
+    knut_io_client_pool_t pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.family = family;
+    pool.endpoint = *endpoint;
+    pool.idle = knut_array_io_client_connection_create_with(client->max_connections, NULL);
+    knut_array_io_client_pool_push(&client->pools, pool);
+    return (uint32_t)(client->pools.size - 1);
+}
+
+static knut_io_client_connection_t* knut_io_client_connect(knut_io_client_t* client,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
+{
+    knut_io_socket_t socket = knut_io_socket(family, KNUT_IO_SOCKET_TYPE_STREAM,
+        KNUT_IO_PROTOCOL_TYPE_TCP);
+
+    if (!knut_io_socket_is_valid(socket))
+    {
+        return NULL;
+    }
+
+    if (knut_io_connect(socket, family, endpoint) != 0)
+    {
+        knut_io_close(socket);
+        return NULL;
+    }
+
+    knut_io_client_connection_t* connection =
+        (knut_io_client_connection_t*)calloc(1, sizeof(*connection));
+    knut_exit_if(connection == NULL, "[knut_io_client_connect] Failed to alloc connection\n");
+
+    connection->socket = socket;
+    connection->framing = &client->framing;
+    connection->input = knut_array_char_create_with(KNUT_IO_CLIENT_RECV_SIZE, NULL);
+    connection->output = knut_array_char_create_with(0, NULL);
+    connection->can_cork = knut_io_set_cork(socket, false) == 0;
+    knut_io_set_nodelay(socket, true);
+
+    return connection;
+}
+
+knut_io_client_connection_t* knut_io_client_acquire(knut_io_client_t* client,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint)
+{
+    knut_io_client_lock(client);
+    const uint32_t index = knut_io_client_find_pool(client, family, endpoint);
+    knut_io_client_pool_t* pool = &client->pools.buffer[index];
+
+    if (pool->idle.size > 0)
+    {
+        knut_io_client_connection_t* connection = pool->idle.buffer[pool->idle.size - 1];
+        knut_array_io_client_connection_pop(&pool->idle);
+        knut_io_client_unlock(client);
+        return connection;
+    }
+
+    if (pool->num_open == client->max_connections)
+    {
+        knut_io_client_unlock(client);
+        return NULL;
+    }
+
+    /* The slot is taken before connecting, so the lock isn't held during the handshake */
+    ++pool->num_open;
+    knut_io_client_unlock(client);
+
+    knut_io_client_connection_t* connection = knut_io_client_connect(client, family, endpoint);
+
+    if (connection == NULL)
+    {
+        knut_io_client_lock(client);
+        --client->pools.buffer[index].num_open;
+        knut_io_client_unlock(client);
+        return NULL;
+    }
+
+    connection->pool = index;
+    return connection;
+}
+
+void knut_io_client_release(knut_io_client_t* client, knut_io_client_connection_t* connection)
+{
+    const bool reusable = !connection->broken && connection->in_flight == 0 &&
+        knut_io_client_flush(connection) == 0;
+
+    knut_io_client_lock(client);
+    knut_io_client_pool_t* pool = &client->pools.buffer[connection->pool];
+
+    if (reusable)
+    {
+        knut_array_io_client_connection_push(&pool->idle, connection);
+    }
+    else
+    {
+        --pool->num_open;
+    }
+
+    knut_io_client_unlock(client);
+
+    if (!reusable)
+    {
+        knut_io_client_connection_close(connection);
+    }
+}
+
+int knut_io_client_write(knut_io_client_connection_t* connection, const knut_io_iovec_t* iovecs,
+    uint64_t count)
+{
+    KNUT_ASSERT(count <= KNUT_IO_MAX_IOVECS, "[knut_io_client_write] Too many buffers\n");
+
+    if (connection->broken)
+    {
+        return -1;
+    }
+
+    if (!connection->corked)
+    {
+        connection->corked = true;
+
+        if (connection->can_cork && knut_io_set_cork(connection->socket, true) != 0)
+        {
+            connection->can_cork = false;
+        }
+    }
+
+    ++connection->in_flight;
+
+    if (!connection->can_cork)
+    {
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            knut_array_char_push_slice(&connection->output, iovecs[i].data, iovecs[i].size);
+        }
+
+        return 0;
+    }
+
+    knut_io_iovec_t pending[KNUT_IO_MAX_IOVECS];
+    memcpy(pending, iovecs, count * sizeof(*iovecs));
+
+    if (knut_io_sendv_all(connection->socket, pending, count) != 0)
+    {
+        connection->broken = true;
+        return -1;
+    }
+
+    return 0;
+}
+
+int knut_io_client_flush(knut_io_client_connection_t* connection)
+{
+    if (!connection->corked)
+    {
+        return connection->broken ? -1 : 0;
+    }
+
+    connection->corked = false;
+
+    if (connection->output.size > 0)
+    {
+        const int result = knut_io_send_all(connection->socket, connection->output.buffer,
+            connection->output.size);
+        knut_array_char_clear(&connection->output);
+        connection->broken |= result != 0;
+    }
+
+    if (connection->can_cork && knut_io_set_cork(connection->socket, false) != 0)
+    {
+        connection->broken = true;
+    }
+
+    return connection->broken ? -1 : 0;
+}
+
+int knut_io_client_read(knut_io_client_connection_t* connection, const char** response,
+    uint64_t* size)
+{
+    KNUT_ASSERT(connection->in_flight > 0, "[knut_io_client_read] No request is waiting\n");
+
+    if (knut_io_client_flush(connection) != 0)
+    {
+        return -1;
+    }
+
+    const knut_io_client_framing_t* framing = connection->framing;
+    knut_array_char_t* input = &connection->input;
+
+    /* The previous response is only dropped now, it had to stay valid until this call */
+    if (connection->input_start > 0)
+    {
+        memmove(input->buffer, input->buffer + connection->input_start,
+            input->size - connection->input_start);
+        input->size -= connection->input_start;
+        connection->input_start = 0;
+    }
+
+    while (true)
+    {
+        uint64_t total = framing->header_size;
+
+        if (input->size >= framing->header_size)
+        {
+            total += framing->body_size(framing->ctx, input->buffer);
+
+            if (input->size >= total)
+            {
+                *response = input->buffer;
+                *size = total;
+                connection->input_start = total;
+                --connection->in_flight;
+                return 0;
+            }
+        }
+
+        const uint64_t wanted = total > input->size + KNUT_IO_CLIENT_RECV_SIZE ?
+            total : input->size + KNUT_IO_CLIENT_RECV_SIZE;
+
+        if (input->capacity < wanted)
+        {
+            knut_array_char_reserve(input, wanted > 2 * input->capacity ?
+                wanted : 2 * input->capacity);
+        }
+
+        const uint64_t space = input->capacity - input->size;
+        const int received = knut_io_recv(connection->socket, input->buffer + input->size,
+            space < INT32_MAX ? (int)space : INT32_MAX);
+
+        if (received <= 0)
+        {
+            connection->broken = true;
+            return -1;
+        }
+
+        input->size += received;
+    }
+}
+
+#endif // KNUT_IO_CLIENT_IMPLEMENTATION
@@ -0,0 +1,766 @@
+#ifndef KNUT_IO_URING_INCLUDE_H
+#define KNUT_IO_URING_INCLUDE_H
+
+#include "knut.h"
+#include "knut_io.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#error "'knut_io_uring.h' needs a POSIX system"
+#endif
+
+/* Asynchronous file reads and socket calls. On Linux they go through io_uring, everywhere else
+ * and on kernels without it through a readiness loop (epoll on Linux, poll elsewhere) that
+ * reads files right away and retries socket calls once they can't block. */
+typedef enum {
+    KNUT_IO_URING_OP_READ = 0,
+    KNUT_IO_URING_OP_RECV,
+    KNUT_IO_URING_OP_SEND,
+    KNUT_IO_URING_OP_ACCEPT
+} knut_io_uring_op_t;
+
+/* 'file' is an index into the registered files instead of a descriptor */
+#define KNUT_IO_URING_FIXED_FILE 0x1
+/* 'buffer' lies inside registered buffer 'buffer_index', only reads make use of it */
+#define KNUT_IO_URING_FIXED_BUFFER 0x2
+
+/* READ reads at 'offset', ACCEPT ignores the buffer and completes with the new descriptor */
+typedef struct {
+    knut_io_uring_op_t op;
+    uint32_t flags;
+    int32_t file;
+    uint16_t buffer_index;
+    char* buffer;
+    uint32_t size;
+    uint64_t offset;
+    uint64_t user_data;
+} knut_io_uring_request_t;
+
+/* 'result' is the number of bytes or the accepted descriptor, or -errno */
+typedef struct {
+    uint64_t user_data;
+    int64_t result;
+} knut_io_uring_completion_t;
+
+typedef void (*knut_io_uring_callback_t)(void* ctx, const knut_io_uring_completion_t* completion);
+
+/* Init flag that skips io_uring even where it exists */
+#define KNUT_IO_URING_NO_NATIVE 0x1
+
+typedef struct {
+    bool native;
+    uint32_t capacity;
+    uint32_t in_flight;
+
+    int ring_fd;
+    void* sq_ring;
+    uint64_t sq_ring_size;
+    void* cq_ring;
+    uint64_t cq_ring_size;
+    void* sqes;
+    uint64_t sqes_size;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t cq_mask;
+    void* cqes;
+
+    int epoll_fd;
+    knut_io_uring_request_t* pending;
+    uint32_t num_pending;
+    knut_io_uring_completion_t* ready;
+    uint32_t num_ready;
+    int* files;
+    uint32_t num_files;
+} knut_io_uring_t;
+
+/* At most 'entries' requests can be in flight, returns -1 if neither backend is usable */
+int knut_io_uring_init(knut_io_uring_t* ring, uint32_t entries, uint32_t flags);
+void knut_io_uring_destroy(knut_io_uring_t* ring);
+
+/* Both can only be done once and only while nothing is in flight */
+int knut_io_uring_register_buffers(knut_io_uring_t* ring, const knut_io_iovec_t* buffers,
+    uint32_t count);
+int knut_io_uring_register_files(knut_io_uring_t* ring, const int* fds, uint32_t count);
+
+/* Queues the requests and submits them with one system call, returns how many were taken.
+ * Fewer than 'count' are taken once the ring is full. */
+uint32_t knut_io_uring_submit(knut_io_uring_t* ring, const knut_io_uring_request_t* requests,
+    uint32_t count);
+
+/* Collects up to 'max' completions, waits up to 'timeout_ms' for the first one (-1 waits until
+ * one arrives, 0 doesn't wait) */
+uint32_t knut_io_uring_poll(knut_io_uring_t* ring, knut_io_uring_completion_t* completions,
+    uint32_t max, int timeout_ms);
+/* Like poll but hands every completion to 'callback' */
+uint32_t knut_io_uring_dispatch(knut_io_uring_t* ring, knut_io_uring_callback_t callback,
+    void* ctx, int timeout_ms);
+
+#endif // KNUT_IO_URING_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_IO_URING_IMPLEMENTATION) && !defined(KNUT_IO_URING_IMPLEMENTATION_DONE)
+#define KNUT_IO_URING_IMPLEMENTATION_DONE
+
+#ifndef KNUT_IO_IMPLEMENTATION_DONE
+#error "'knut_io.h' must be implemented before this header can be used"
+#endif
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define KNUT_IO_URING_HAS_NATIVE
+#endif
+
+#define KNUT_IO_URING_BATCH_SIZE 64
+
+static void knut_io_uring_complete(knut_io_uring_t* ring, uint64_t user_data, int64_t result)
+{
+    const knut_io_uring_completion_t completion = { user_data, result };
+    ring->ready[ring->num_ready++] = completion;
+}
+
+static int32_t knut_io_uring_resolve_file(const knut_io_uring_t* ring,
+    const knut_io_uring_request_t* request)
+{
+    if ((request->flags & KNUT_IO_URING_FIXED_FILE) == 0)
+    {
+        return request->file;
+    }
+
+    KNUT_ASSERT((uint32_t)request->file < ring->num_files,
+        "[knut_io_uring_resolve_file] File isn't registered\n");
+    return ring->files[request->file];
+}
+
+// ==============================================================================
+// io_uring
+
+#ifdef KNUT_IO_URING_HAS_NATIVE
+
+static int knut_io_uring_setup(uint32_t entries, struct io_uring_params* params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int knut_io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete,
+    uint32_t flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int knut_io_uring_register(int fd, uint32_t opcode, const void* arg, uint32_t count)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static uint32_t knut_io_uring_load_acquire(const uint32_t* value)
+{
+    return atomic_load_explicit((const _Atomic(uint32_t)*)value, memory_order_acquire);
+}
+
+static void knut_io_uring_store_release(uint32_t* value, uint32_t new_value)
+{
+    atomic_store_explicit((_Atomic(uint32_t)*)value, new_value, memory_order_release);
+}
+
+static int knut_io_uring_init_native(knut_io_uring_t* ring, uint32_t entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    /* Twice as many completion slots as requests, so completions can't overflow */
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = 2 * entries;
+
+    const int fd = knut_io_uring_setup(entries, &params);
+
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    ring->ring_fd = fd;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    if (single_mmap)
+    {
+        ring->sq_ring_size = ring->sq_ring_size > ring->cq_ring_size ?
+            ring->sq_ring_size : ring->cq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_ring = single_mmap ? ring->sq_ring : mmap(NULL, ring->cq_ring_size,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        if (ring->sqes != MAP_FAILED) { munmap(ring->sqes, ring->sqes_size); }
+        if (!single_mmap && ring->cq_ring != MAP_FAILED)
+        {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sq_ring != MAP_FAILED) { munmap(ring->sq_ring, ring->sq_ring_size); }
+        close(fd);
+        return -1;
+    }
+
+    char* sq = (char*)ring->sq_ring;
+    char* cq = (char*)ring->cq_ring;
+    ring->sq_head = (uint32_t*)(sq + params.sq_off.head);
+    ring->sq_tail = (uint32_t*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(uint32_t*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (uint32_t*)(sq + params.sq_off.array);
+    ring->cq_head = (uint32_t*)(cq + params.cq_off.head);
+    ring->cq_tail = (uint32_t*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(uint32_t*)(cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+    ring->capacity = params.sq_entries;
+    ring->native = true;
+    return 0;
+}
+
+static void knut_io_uring_destroy_native(knut_io_uring_t* ring)
+{
+    munmap(ring->sqes, ring->sqes_size);
+
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->ring_fd);
+}
+
+static void knut_io_uring_prepare(struct io_uring_sqe* sqe,
+    const knut_io_uring_request_t* request)
+{
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = request->file;
+    sqe->addr = (uint64_t)(uintptr_t)request->buffer;
+    sqe->len = request->size;
+    sqe->user_data = request->user_data;
+
+    if ((request->flags & KNUT_IO_URING_FIXED_FILE) != 0)
+    {
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+
+    switch (request->op)
+    {
+    case KNUT_IO_URING_OP_READ:
+    {
+        const bool fixed = (request->flags & KNUT_IO_URING_FIXED_BUFFER) != 0;
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->off = request->offset;
+        sqe->buf_index = fixed ? request->buffer_index : 0;
+        break;
+    }
+    case KNUT_IO_URING_OP_RECV:
+    {
+        sqe->opcode = IORING_OP_RECV;
+        break;
+    }
+    case KNUT_IO_URING_OP_SEND:
+    {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+        break;
+    }
+    case KNUT_IO_URING_OP_ACCEPT:
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = 0;
+        sqe->len = 0;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        break;
+    }
+    default:
+        knut_exit_if(true, "[knut_io_uring_prepare] Unknown op\n");
+        break;
+    }
+}
+
+static uint32_t knut_io_uring_submit_native(knut_io_uring_t* ring,
+    const knut_io_uring_request_t* requests, uint32_t count)
+{
+    const uint32_t head = knut_io_uring_load_acquire(ring->sq_head);
+    uint32_t tail = *ring->sq_tail;
+    uint32_t queued = 0;
+
+    for (; queued < count && tail - head < ring->capacity; ++queued, ++tail)
+    {
+        const uint32_t index = tail & ring->sq_mask;
+        knut_io_uring_prepare((struct io_uring_sqe*)ring->sqes + index, &requests[queued]);
+        ring->sq_array[index] = index;
+    }
+
+    knut_io_uring_store_release(ring->sq_tail, tail);
+
+    /* Requests the kernel didn't take yet stay queued for the next enter */
+    if (queued > 0)
+    {
+        knut_io_uring_enter(ring->ring_fd, tail - head, 0, 0);
+    }
+
+    return queued;
+}
+
+static uint32_t knut_io_uring_reap_native(knut_io_uring_t* ring,
+    knut_io_uring_completion_t* completions, uint32_t max)
+{
+    uint32_t head = *ring->cq_head;
+    const uint32_t tail = knut_io_uring_load_acquire(ring->cq_tail);
+    uint32_t count = 0;
+
+    for (; count < max && head != tail; ++count, ++head)
+    {
+        const struct io_uring_cqe* cqe = (const struct io_uring_cqe*)ring->cqes +
+            (head & ring->cq_mask);
+        completions[count].user_data = cqe->user_data;
+        completions[count].result = cqe->res;
+    }
+
+    knut_io_uring_store_release(ring->cq_head, head);
+    return count;
+}
+
+static uint32_t knut_io_uring_poll_native(knut_io_uring_t* ring,
+    knut_io_uring_completion_t* completions, uint32_t max, int timeout_ms)
+{
+    uint32_t count = knut_io_uring_reap_native(ring, completions, max);
+
+    if (count > 0 || timeout_ms == 0 || ring->in_flight == 0)
+    {
+        return count;
+    }
+
+    /* The ring descriptor polls readable once completions are there */
+    if (timeout_ms > 0)
+    {
+        knut_io_pollfd_t fd = { ring->ring_fd, POLLIN, 0 };
+        knut_io_poll(&fd, 1, timeout_ms);
+    }
+    else
+    {
+        knut_io_uring_enter(ring->ring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+    }
+
+    return knut_io_uring_reap_native(ring, completions, max);
+}
+
+#endif // ifdef KNUT_IO_URING_HAS_NATIVE
+
+// ==============================================================================
+// Readiness fallback
+
+static bool knut_io_uring_wants_output(knut_io_uring_op_t op)
+{
+    return op == KNUT_IO_URING_OP_SEND;
+}
+
+/* Returns false if the call would have blocked. Reads have nothing to wait for, so they always
+ * complete, errors included. */
+static bool knut_io_uring_try(knut_io_uring_t* ring, const knut_io_uring_request_t* request)
+{
+    const int32_t fd = knut_io_uring_resolve_file(ring, request);
+    int64_t result = 0;
+
+    switch (request->op)
+    {
+    case KNUT_IO_URING_OP_READ:
+    {
+        do
+        {
+            result = pread(fd, request->buffer, request->size, (off_t)request->offset);
+        } while (result < 0 && errno == EINTR);
+        break;
+    }
+    case KNUT_IO_URING_OP_RECV:
+    {
+        result = recv(fd, request->buffer, request->size, MSG_DONTWAIT);
+        break;
+    }
+    case KNUT_IO_URING_OP_SEND:
+    {
+        result = send(fd, request->buffer, request->size, MSG_DONTWAIT | KNUT_IO_SEND_FLAGS);
+        break;
+    }
+    case KNUT_IO_URING_OP_ACCEPT:
+    {
+        /* The listener may be blocking, so only accept once it has a connection waiting */
+        knut_io_pollfd_t listener = { fd, POLLIN, 0 };
+
+        if (knut_io_poll(&listener, 1, 0) <= 0)
+        {
+            return false;
+        }
+
+        const knut_io_socket_t socket = { fd };
+        result = knut_io_accept_with(socket, KNUT_IO_ACCEPT_CLOEXEC, NULL, NULL).handle;
+        break;
+    }
+    default:
+        knut_exit_if(true, "[knut_io_uring_try] Unknown op\n");
+        break;
+    }
+
+    if (result < 0 && request->op != KNUT_IO_URING_OP_READ &&
+        (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return false;
+    }
+
+    knut_io_uring_complete(ring, request->user_data, result < 0 ? -errno : result);
+    return true;
+}
+
+#ifdef __linux__
+
+static uint32_t knut_io_uring_interest(const knut_io_uring_t* ring, int32_t fd)
+{
+    uint32_t events = 0;
+
+    for (uint32_t i = 0; i < ring->num_pending; ++i)
+    {
+        if (knut_io_uring_resolve_file(ring, &ring->pending[i]) == fd)
+        {
+            events |= knut_io_uring_wants_output(ring->pending[i].op) ? EPOLLOUT : EPOLLIN;
+        }
+    }
+
+    return events;
+}
+
+/* Brings the epoll registration of 'fd' in line with its pending requests */
+static void knut_io_uring_watch(knut_io_uring_t* ring, int32_t fd, uint32_t old_events)
+{
+    const uint32_t events = knut_io_uring_interest(ring, fd);
+
+    if (events == old_events)
+    {
+        return;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+
+    const int operation = old_events == 0 ? EPOLL_CTL_ADD :
+        events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    epoll_ctl(ring->epoll_fd, operation, fd, &event);
+}
+
+#endif // ifdef __linux__
+
+/* Retries the pending requests on 'fd', every fd if it is -1 */
+static void knut_io_uring_retry(knut_io_uring_t* ring, int32_t fd)
+{
+#ifdef __linux__
+    const uint32_t old_events = fd >= 0 ? knut_io_uring_interest(ring, fd) : 0;
+#endif
+
+    for (uint32_t i = 0; i < ring->num_pending;)
+    {
+        knut_io_uring_request_t* request = &ring->pending[i];
+
+        if ((fd < 0 || knut_io_uring_resolve_file(ring, request) == fd) &&
+            knut_io_uring_try(ring, request))
+        {
+            /* Order between requests on the same descriptor is kept */
+            memmove(request, request + 1, (ring->num_pending - i - 1) * sizeof(*request));
+            --ring->num_pending;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+#ifdef __linux__
+    if (fd >= 0)
+    {
+        knut_io_uring_watch(ring, fd, old_events);
+    }
+#endif
+}
+
+static uint32_t knut_io_uring_submit_fallback(knut_io_uring_t* ring,
+    const knut_io_uring_request_t* requests, uint32_t count)
+{
+    uint32_t queued = 0;
+
+    for (; queued < count && ring->in_flight + queued < ring->capacity; ++queued)
+    {
+        const knut_io_uring_request_t* request = &requests[queued];
+
+        if (request->op == KNUT_IO_URING_OP_READ)
+        {
+            knut_io_uring_try(ring, request);
+            continue;
+        }
+
+        const int32_t fd = knut_io_uring_resolve_file(ring, request);
+#ifdef __linux__
+        const uint32_t old_events = knut_io_uring_interest(ring, fd);
+#endif
+        ring->pending[ring->num_pending++] = *request;
+        knut_io_uring_retry(ring, fd);
+#ifdef __linux__
+        knut_io_uring_watch(ring, fd, old_events);
+#endif
+    }
+
+    return queued;
+}
+
+static void knut_io_uring_wait_fallback(knut_io_uring_t* ring, int timeout_ms)
+{
+#ifdef __linux__
+    struct epoll_event events[KNUT_IO_URING_BATCH_SIZE];
+    const int count = epoll_wait(ring->epoll_fd, events, KNUT_IO_URING_BATCH_SIZE, timeout_ms);
+
+    for (int i = 0; i < count; ++i)
+    {
+        knut_io_uring_retry(ring, events[i].data.fd);
+    }
+#else
+    knut_io_pollfd_t* fds = (knut_io_pollfd_t*)calloc(ring->num_pending, sizeof(*fds));
+    knut_exit_if(fds == NULL, "[knut_io_uring_wait_fallback] Failed to alloc fds\n");
+
+    for (uint32_t i = 0; i < ring->num_pending; ++i)
+    {
+        fds[i].fd = knut_io_uring_resolve_file(ring, &ring->pending[i]);
+        fds[i].events = knut_io_uring_wants_output(ring->pending[i].op) ? POLLOUT : POLLIN;
+    }
+
+    const uint32_t num_fds = ring->num_pending;
+
+    if (knut_io_poll(fds, num_fds, timeout_ms) > 0)
+    {
+        knut_io_uring_retry(ring, -1);
+    }
+
+    free(fds);
+#endif
+}
+
+static uint32_t knut_io_uring_reap_fallback(knut_io_uring_t* ring,
+    knut_io_uring_completion_t* completions, uint32_t max)
+{
+    const uint32_t count = ring->num_ready < max ? ring->num_ready : max;
+    memcpy(completions, ring->ready, count * sizeof(*completions));
+    memmove(ring->ready, ring->ready + count, (ring->num_ready - count) * sizeof(*ring->ready));
+    ring->num_ready -= count;
+    return count;
+}
+
+static uint32_t knut_io_uring_poll_fallback(knut_io_uring_t* ring,
+    knut_io_uring_completion_t* completions, uint32_t max, int timeout_ms)
+{
+    uint32_t count = knut_io_uring_reap_fallback(ring, completions, max);
+
+    while (count == 0 && timeout_ms != 0 && ring->num_pending > 0)
+    {
+        knut_io_uring_wait_fallback(ring, timeout_ms);
+        count = knut_io_uring_reap_fallback(ring, completions, max);
+
+        if (timeout_ms > 0)
+        {
+            break;
+        }
+    }
+
+    return count;
+}
+
+// ==============================================================================
+
+int knut_io_uring_init(knut_io_uring_t* ring, uint32_t entries, uint32_t flags)
+{
+    KNUT_ASSERT(entries > 0, "[knut_io_uring_init] Need at least one entry\n");
+    memset(ring, 0, sizeof(*ring));
+    ring->ring_fd = -1;
+    ring->epoll_fd = -1;
+
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if ((flags & KNUT_IO_URING_NO_NATIVE) == 0 && knut_io_uring_init_native(ring, entries) == 0)
+    {
+        return 0;
+    }
+#else
+    (void)flags;
+#endif
+
+#ifdef __linux__
+    ring->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (ring->epoll_fd < 0)
+    {
+        return -1;
+    }
+#endif
+
+    ring->capacity = entries;
+    ring->pending = (knut_io_uring_request_t*)calloc(entries, sizeof(*ring->pending));
+    ring->ready = (knut_io_uring_completion_t*)calloc(entries, sizeof(*ring->ready));
+    knut_exit_if(!ring->pending || !ring->ready,
+        "[knut_io_uring_init] Failed to alloc fallback queues\n");
+    return 0;
+}
+
+void knut_io_uring_destroy(knut_io_uring_t* ring)
+{
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if (ring->native)
+    {
+        knut_io_uring_destroy_native(ring);
+    }
+#endif
+
+    if (ring->epoll_fd >= 0)
+    {
+        close(ring->epoll_fd);
+    }
+
+    free(ring->pending);
+    free(ring->ready);
+    free(ring->files);
+    memset(ring, 0, sizeof(*ring));
+}
+
+int knut_io_uring_register_buffers(knut_io_uring_t* ring, const knut_io_iovec_t* buffers,
+    uint32_t count)
+{
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if (ring->native)
+    {
+        struct iovec* iovecs = (struct iovec*)calloc(count, sizeof(*iovecs));
+        knut_exit_if(iovecs == NULL, "[knut_io_uring_register_buffers] Failed to alloc\n");
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            iovecs[i].iov_base = buffers[i].data;
+            iovecs[i].iov_len = (size_t)buffers[i].size;
+        }
+
+        const int result = knut_io_uring_register(ring->ring_fd, IORING_REGISTER_BUFFERS,
+            iovecs, count);
+        free(iovecs);
+        return result < 0 ? -1 : 0;
+    }
+#endif
+
+    /* Plain reads get along without them */
+    (void)ring;
+    (void)buffers;
+    (void)count;
+    return 0;
+}
+
+int knut_io_uring_register_files(knut_io_uring_t* ring, const int* fds, uint32_t count)
+{
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if (ring->native &&
+        knut_io_uring_register(ring->ring_fd, IORING_REGISTER_FILES, fds, count) < 0)
+    {
+        return -1;
+    }
+#endif
+
+    /* Kept for the fallback and for resolving indices */
+    ring->files = (int*)calloc(count, sizeof(*ring->files));
+    knut_exit_if(ring->files == NULL, "[knut_io_uring_register_files] Failed to alloc\n");
+    memcpy(ring->files, fds, count * sizeof(*fds));
+    ring->num_files = count;
+    return 0;
+}
+
+uint32_t knut_io_uring_submit(knut_io_uring_t* ring, const knut_io_uring_request_t* requests,
+    uint32_t count)
+{
+    uint32_t queued;
+    const uint32_t room = ring->capacity - ring->in_flight;
+    count = count < room ? count : room;
+
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if (ring->native)
+    {
+        queued = knut_io_uring_submit_native(ring, requests, count);
+        ring->in_flight += queued;
+        return queued;
+    }
+#endif
+
+    queued = knut_io_uring_submit_fallback(ring, requests, count);
+    ring->in_flight += queued;
+    return queued;
+}
+
+uint32_t knut_io_uring_poll(knut_io_uring_t* ring, knut_io_uring_completion_t* completions,
+    uint32_t max, int timeout_ms)
+{
+    uint32_t count;
+
+#ifdef KNUT_IO_URING_HAS_NATIVE
+    if (ring->native)
+    {
+        count = knut_io_uring_poll_native(ring, completions, max, timeout_ms);
+        ring->in_flight -= count;
+        return count;
+    }
+#endif
+
+    count = knut_io_uring_poll_fallback(ring, completions, max, timeout_ms);
+    ring->in_flight -= count;
+    return count;
+}
+
+uint32_t knut_io_uring_dispatch(knut_io_uring_t* ring, knut_io_uring_callback_t callback,
+    void* ctx, int timeout_ms)
+{
+    knut_io_uring_completion_t completions[KNUT_IO_URING_BATCH_SIZE];
+    const uint32_t count = knut_io_uring_poll(ring, completions, KNUT_IO_URING_BATCH_SIZE,
+        timeout_ms);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        callback(ctx, &completions[i]);
+    }
+
+    return count;
+}
+
+#endif // KNUT_IO_URING_IMPLEMENTATION
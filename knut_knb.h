@@ -0,0 +1,232 @@
+#ifndef KNUT_KNB_INCLUDE_H
+#define KNUT_KNB_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+#include "knut_io.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Pre-parsed puzzle input, written once by a day's -knb mode and mapped on every later run
+ *   header   char magic[8] "KNUTKNB", u32 version, u32 day, u32 num_columns, u32 byte order
+ *            mark, padded to 64 bytes
+ *   columns  num_columns entries of u32 type, u32 value size, u64 count, u64 offset, u64
+ *            reserved
+ *   values   every column starts at a multiple of KNUT_KNB_ALIGNMENT from the file start
+ * Values are in host byte order, files written on the other byte order are rejected. */
+#define KNUT_KNB_VERSION 1
+#define KNUT_KNB_ALIGNMENT 64
+#define KNUT_KNB_MAX_COLUMNS 16
+#define KNUT_KNB_BYTE_ORDER 0x01020304u
+
+typedef enum {
+    KNUT_KNB_TYPE_I32 = 1,
+    KNUT_KNB_TYPE_I64,
+    KNUT_KNB_TYPE_U64,
+    KNUT_KNB_TYPE_U8,
+    KNUT_KNB_TYPE_COUNT
+} knut_knb_type_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t day;
+    uint32_t num_columns;
+    uint32_t byte_order;
+    uint64_t reserved[5];
+} knut_knb_header_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t value_size;
+    uint64_t count;
+    uint64_t offset;
+    uint64_t reserved;
+} knut_knb_column_t;
+
+/* One column for knut_knb_write */
+typedef struct {
+    knut_knb_type_t type;
+    const void* values;
+    uint64_t count;
+} knut_knb_source_t;
+
+typedef struct {
+    knut_io_mapped_file_t file;
+    const knut_knb_header_t* header;
+    const knut_knb_column_t* columns;
+} knut_knb_t;
+
+/* True for paths ending in .knb */
+bool knut_knb_is_path(const char* path);
+int knut_knb_write(const char* path, uint32_t day, const knut_knb_source_t* columns,
+    uint32_t num_columns);
+/* Maps the file copy on write, so the columns can be sorted or overwritten in place. Returns -1
+ * unless it is a valid container of 'num_columns' columns for 'day'. */
+int knut_knb_open(knut_knb_t* knb, const char* path, uint32_t day, uint32_t num_columns);
+void knut_knb_close(knut_knb_t* knb);
+
+/* Views into the mapping, they live as long as the knut_knb_t */
+#define KNUT_KNB_DEFINE_VIEW(TYPE, TYPE_NAME, KNB_TYPE) \
+static knut_array_##TYPE_NAME##_data_t knut_knb_##TYPE_NAME(const knut_knb_t* knb, \
+    uint32_t column) \
+{ \
+    KNUT_ASSERT(column < knb->header->num_columns && knb->columns[column].type == KNB_TYPE, \
+        "[knut_knb_" #TYPE_NAME "] Column has another type\n"); \
+    knut_array_##TYPE_NAME##_data_t data = { \
+        (TYPE*)(knb->file.ptr + knb->columns[column].offset), \
+        knb->columns[column].count \
+    }; \
+    return data; \
+} \
+
+KNUT_KNB_DEFINE_VIEW(int, int, KNUT_KNB_TYPE_I32)
+KNUT_KNB_DEFINE_VIEW(int32_t, i32, KNUT_KNB_TYPE_I32)
+KNUT_KNB_DEFINE_VIEW(int64_t, i64, KNUT_KNB_TYPE_I64)
+KNUT_KNB_DEFINE_VIEW(uint64_t, u64, KNUT_KNB_TYPE_U64)
+KNUT_KNB_DEFINE_VIEW(uint8_t, u8, KNUT_KNB_TYPE_U8)
+
+#endif // KNUT_KNB_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_KNB_IMPLEMENTATION) && !defined(KNUT_KNB_IMPLEMENTATION_DONE)
+#define KNUT_KNB_IMPLEMENTATION_DONE
+
+#ifndef KNUT_IO_IMPLEMENTATION_DONE
+#error "'knut_io.h' must be implemented before this header can be used"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+static const char knut_knb_magic[8] = { 'K', 'N', 'U', 'T', 'K', 'N', 'B', '\0' };
+static const uint32_t knut_knb_value_sizes[KNUT_KNB_TYPE_COUNT] = { 0, 4, 8, 8, 1 };
+
+static uint64_t knut_knb_align(uint64_t offset)
+{
+    return (offset + KNUT_KNB_ALIGNMENT - 1) & ~(uint64_t)(KNUT_KNB_ALIGNMENT - 1);
+}
+
+bool knut_knb_is_path(const char* path)
+{
+    const uint64_t length = strlen(path);
+    return length >= 4 && strcmp(path + length - 4, ".knb") == 0;
+}
+
+int knut_knb_write(const char* path, uint32_t day, const knut_knb_source_t* columns,
+    uint32_t num_columns)
+{
+    KNUT_ASSERT(num_columns <= KNUT_KNB_MAX_COLUMNS, "[knut_knb_write] Too many columns\n");
+
+    knut_knb_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, knut_knb_magic, sizeof(knut_knb_magic));
+    header.version = KNUT_KNB_VERSION;
+    header.day = day;
+    header.num_columns = num_columns;
+    header.byte_order = KNUT_KNB_BYTE_ORDER;
+
+    knut_knb_column_t table[KNUT_KNB_MAX_COLUMNS];
+    memset(table, 0, sizeof(table));
+    uint64_t offset = sizeof(header) + num_columns * sizeof(knut_knb_column_t);
+
+    for (uint32_t i = 0; i < num_columns; ++i)
+    {
+        KNUT_ASSERT(columns[i].type > 0 && columns[i].type < KNUT_KNB_TYPE_COUNT,
+            "[knut_knb_write] Unknown column type\n");
+        table[i].type = columns[i].type;
+        table[i].value_size = knut_knb_value_sizes[columns[i].type];
+        table[i].count = columns[i].count;
+        table[i].offset = knut_knb_align(offset);
+        offset = table[i].offset + table[i].count * table[i].value_size;
+    }
+
+    FILE* file = fopen(path, "wb");
+
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    static const char padding[KNUT_KNB_ALIGNMENT] = { 0 };
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(table, sizeof(*table), num_columns, file) == num_columns;
+    offset = sizeof(header) + num_columns * sizeof(knut_knb_column_t);
+
+    for (uint32_t i = 0; i < num_columns && written; ++i)
+    {
+        const uint64_t size = table[i].count * table[i].value_size;
+        written = fwrite(padding, 1, table[i].offset - offset, file) == table[i].offset - offset &&
+            (size == 0 || fwrite(columns[i].values, 1, size, file) == size);
+        offset = table[i].offset + size;
+    }
+
+    written &= fclose(file) == 0;
+    return written ? 0 : -1;
+}
+
+static bool knut_knb_valid(const knut_knb_t* knb, uint32_t day, uint32_t num_columns)
+{
+    const uint64_t size = knb->file.size;
+    const knut_knb_header_t* header = knb->header;
+
+    if (size < sizeof(*header) ||
+        memcmp(header->magic, knut_knb_magic, sizeof(knut_knb_magic)) != 0 ||
+        header->version != KNUT_KNB_VERSION || header->byte_order != KNUT_KNB_BYTE_ORDER ||
+        header->day != day || header->num_columns != num_columns ||
+        size - sizeof(*header) < num_columns * sizeof(knut_knb_column_t))
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < num_columns; ++i)
+    {
+        const knut_knb_column_t* column = &knb->columns[i];
+
+        if (column->type == 0 || column->type >= KNUT_KNB_TYPE_COUNT ||
+            column->value_size != knut_knb_value_sizes[column->type] ||
+            column->offset % KNUT_KNB_ALIGNMENT != 0 || column->offset > size ||
+            column->count > (size - column->offset) / column->value_size)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int knut_knb_open(knut_knb_t* knb, const char* path, uint32_t day, uint32_t num_columns)
+{
+    memset(knb, 0, sizeof(*knb));
+
+    if (knut_io_map_file_private(&knb->file, path) != 0)
+    {
+        return -1;
+    }
+
+    knb->header = (const knut_knb_header_t*)knb->file.ptr;
+    knb->columns = (const knut_knb_column_t*)(knb->header + 1);
+
+    if (knb->file.ptr == NULL || !knut_knb_valid(knb, day, num_columns))
+    {
+        knut_knb_close(knb);
+        return -1;
+    }
+
+    return 0;
+}
+
+void knut_knb_close(knut_knb_t* knb)
+{
+    knut_io_unmap_file(&knb->file);
+    memset(knb, 0, sizeof(*knb));
+}
+
+#endif // KNUT_KNB_IMPLEMENTATION
@@ -0,0 +1,450 @@
+#ifndef KNUT_PIPELINE_INCLUDE_H
+#define KNUT_PIPELINE_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+#include "knut_thread.h"
+
+#ifndef _WIN32
+#include "knut_io_uring.h"
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KNUT_PIPELINE_CHUNK_SIZE (1024 * 1024)
+/* Longest line that can span two chunks */
+#define KNUT_PIPELINE_CARRY_SIZE (256 * 1024)
+/* Chunk reads kept in flight ahead of the parser */
+#define KNUT_PIPELINE_READ_AHEAD 4
+#define KNUT_PIPELINE_BATCH_SIZE 256
+
+/* Reads a file in large chunks, parses its lines into fixed size records on one thread and
+ * fans batches of records out to solver workers.
+ *
+ * parse:  gets every line null terminated and without the line break, returns true if it
+ *         filled 'record'. It runs on a single thread and may update 'ctx', solvers see every
+ *         update made before their record was parsed.
+ * solve:  adds one record to the worker's totals, records are handed out in no fixed order.
+ * reduce: merges one worker's totals into the final totals once all workers are done. */
+typedef struct {
+    uint64_t record_size;
+    uint64_t totals_size;
+    bool (*parse)(void* ctx, char* line, uint64_t length, void* record);
+    void (*solve)(void* ctx, void* record, void* totals);
+    void (*reduce)(void* ctx, void* totals, const void* worker_totals);
+    void* ctx;
+    uint32_t num_workers;
+} knut_pipeline_t;
+
+/* Worker totals start zeroed, 'totals' is only touched by reduce. Returns -1 if the file can't
+ * be opened. */
+int knut_pipeline_run(const knut_pipeline_t* pipeline, const char* path, void* totals);
+
+#endif // KNUT_PIPELINE_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_PIPELINE_IMPLEMENTATION) && !defined(KNUT_PIPELINE_IMPLEMENTATION_DONE)
+#define KNUT_PIPELINE_IMPLEMENTATION_DONE
+
+#if !defined(KNUT_DS_IMPLEMENTATION_DONE) || !defined(KNUT_THREAD_IMPLEMENTATION_DONE)
+#error "'knut_ds.h' and 'knut_thread.h' must be implemented before this header can be used"
+#endif
+
+#if !defined(_WIN32) && !defined(KNUT_IO_URING_IMPLEMENTATION_DONE)
+#error "'knut_io_uring.h' must be implemented before this header can be used"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* Reads land behind the carry area, the unfinished last line of the previous chunk is copied
+ * right in front of them */
+typedef struct {
+    char* begin;
+    uint64_t size;
+    char data[KNUT_PIPELINE_CARRY_SIZE + KNUT_PIPELINE_CHUNK_SIZE + 1];
+} knut_pipeline_chunk_t;
+
+typedef struct {
+    uint64_t count;
+    _Alignas(16) unsigned char records[];
+} knut_pipeline_batch_t;
+
+typedef knut_pipeline_chunk_t* knut_pipeline_chunk_ptr_t;
+typedef knut_pipeline_batch_t* knut_pipeline_batch_ptr_t;
+
+KNUT_DEFINE_SPSC_RING(knut_pipeline_chunk_ptr_t, pipeline_chunk)
+KNUT_DEFINE_MPMC_RING(knut_pipeline_batch_ptr_t, pipeline_batch)
+
+typedef struct {
+    const knut_pipeline_t* pipeline;
+    knut_pool_t chunks;
+    knut_pool_t batches;
+    knut_spsc_pipeline_chunk_t chunk_ring;
+    knut_mpmc_pipeline_batch_t batch_ring;
+} knut_pipeline_state_t;
+
+typedef struct {
+    knut_pipeline_state_t* state;
+    void* totals;
+} knut_pipeline_worker_t;
+
+static knut_pipeline_batch_t* knut_pipeline_new_batch(knut_pipeline_state_t* state)
+{
+    knut_pipeline_batch_t* batch = (knut_pipeline_batch_t*)knut_pool_alloc(&state->batches);
+    batch->count = 0;
+    return batch;
+}
+
+static void knut_pipeline_parser(void* arg)
+{
+    knut_pipeline_state_t* state = (knut_pipeline_state_t*)arg;
+    const knut_pipeline_t* pipeline = state->pipeline;
+    knut_pipeline_batch_t* batch = knut_pipeline_new_batch(state);
+    knut_pipeline_chunk_t* chunk;
+
+    while (knut_spsc_pipeline_chunk_pop(&state->chunk_ring, &chunk))
+    {
+        char* line = chunk->begin;
+        char* const end = chunk->begin + chunk->size;
+        *end = '\0';
+
+        while (line < end)
+        {
+            char* line_end = (char*)memchr(line, '\n', end - line);
+            line_end = line_end != NULL ? line_end : end;
+            char* next_line = line_end < end ? line_end + 1 : end;
+
+            if (line_end > line && line_end[-1] == '\r') { --line_end; }
+            *line_end = '\0';
+
+            void* record = batch->records + batch->count * pipeline->record_size;
+
+            if (pipeline->parse(pipeline->ctx, line, line_end - line, record) &&
+                ++batch->count == KNUT_PIPELINE_BATCH_SIZE)
+            {
+                knut_mpmc_pipeline_batch_push(&state->batch_ring, batch);
+                batch = knut_pipeline_new_batch(state);
+            }
+
+            line = next_line;
+        }
+
+        knut_pool_free(&state->chunks, chunk);
+    }
+
+    if (batch->count > 0)
+    {
+        knut_mpmc_pipeline_batch_push(&state->batch_ring, batch);
+    }
+    else
+    {
+        knut_pool_free(&state->batches, batch);
+    }
+
+    knut_mpmc_pipeline_batch_close(&state->batch_ring);
+}
+
+static void knut_pipeline_solver(void* arg)
+{
+    knut_pipeline_worker_t* worker = (knut_pipeline_worker_t*)arg;
+    knut_pipeline_state_t* state = worker->state;
+    const knut_pipeline_t* pipeline = state->pipeline;
+    knut_pipeline_batch_t* batches[4];
+    uint64_t num_batches;
+
+    while ((num_batches = 
+        knut_mpmc_pipeline_batch_pop_slice(&state->batch_ring, batches, 4)) > 0)
+    {
+        for (uint64_t i = 0; i < num_batches; ++i)
+        {
+            for (uint64_t j = 0; j < batches[i]->count; ++j)
+            {
+                pipeline->solve(pipeline->ctx,
+                    batches[i]->records + j * pipeline->record_size, worker->totals);
+            }
+        }
+
+        knut_pool_free_slice(&state->batches, (void**)batches, num_batches);
+    }
+}
+
+static knut_pipeline_chunk_t* knut_pipeline_new_chunk(knut_pipeline_state_t* state)
+{
+    knut_pipeline_chunk_t* chunk = (knut_pipeline_chunk_t*)knut_pool_alloc(&state->chunks);
+    chunk->begin = chunk->data + KNUT_PIPELINE_CARRY_SIZE;
+    chunk->size = 0;
+    return chunk;
+}
+
+/* 'chunk' already holds its carry and 'bytes_read' new bytes. Everything up to the last line
+ * break is handed to the parser and the rest is carried over into 'next', without a next chunk
+ * the whole chunk goes to the parser. */
+static void knut_pipeline_push_chunk(knut_pipeline_state_t* state, knut_pipeline_chunk_t* chunk,
+    uint64_t bytes_read, knut_pipeline_chunk_t* next)
+{
+    const uint64_t size = chunk->size + bytes_read;
+    uint64_t complete = size;
+
+    if (next != NULL)
+    {
+        while (complete > 0 && chunk->begin[complete - 1] != '\n') { --complete; }
+
+        const uint64_t carry = size - complete;
+        knut_exit_if(carry > KNUT_PIPELINE_CARRY_SIZE,
+            "[knut_pipeline_push_chunk] Line doesn't fit into the carry area\n");
+        next->begin = next->data + KNUT_PIPELINE_CARRY_SIZE - carry;
+        next->size = carry;
+        memcpy(next->begin, chunk->begin + complete, carry);
+    }
+
+    if (complete > 0)
+    {
+        chunk->size = complete;
+        knut_spsc_pipeline_chunk_push(&state->chunk_ring, chunk);
+    }
+    else
+    {
+        knut_pool_free(&state->chunks, chunk);
+    }
+}
+
+#ifdef _WIN32
+
+/* Runs on the calling thread, every chunk ends on a line break except for the last one */
+static void knut_pipeline_reader(knut_pipeline_state_t* state, FILE* file)
+{
+    knut_pipeline_chunk_t* chunk = knut_pipeline_new_chunk(state);
+    uint64_t bytes_read;
+
+    while ((bytes_read = fread(chunk->data + KNUT_PIPELINE_CARRY_SIZE, 1,
+        KNUT_PIPELINE_CHUNK_SIZE, file)) > 0)
+    {
+        knut_pipeline_chunk_t* next = knut_pipeline_new_chunk(state);
+        knut_pipeline_push_chunk(state, chunk, bytes_read, next);
+        chunk = next;
+    }
+
+    knut_pipeline_push_chunk(state, chunk, 0, NULL);
+    knut_spsc_pipeline_chunk_close(&state->chunk_ring);
+}
+
+#else
+
+typedef struct {
+    knut_pipeline_chunk_t* chunk;
+    int64_t result;
+    bool done;
+} knut_pipeline_read_t;
+
+typedef struct {
+    knut_io_uring_t ring;
+    knut_pipeline_read_t reads[KNUT_PIPELINE_READ_AHEAD];
+    int fd;
+    uint32_t file_flags;
+    int32_t file;
+    uint64_t submitted;
+    uint64_t processed;
+} knut_pipeline_file_t;
+
+static void knut_pipeline_submit_read(knut_pipeline_state_t* state, knut_pipeline_file_t* file)
+{
+    knut_pipeline_read_t* read = &file->reads[file->submitted % KNUT_PIPELINE_READ_AHEAD];
+    read->chunk = knut_pipeline_new_chunk(state);
+    read->done = false;
+
+    const knut_io_uring_request_t request = {
+        KNUT_IO_URING_OP_READ,
+        file->file_flags,
+        file->file,
+        0,
+        read->chunk->data + KNUT_PIPELINE_CARRY_SIZE,
+        KNUT_PIPELINE_CHUNK_SIZE,
+        file->submitted * KNUT_PIPELINE_CHUNK_SIZE,
+        file->submitted
+    };
+
+    knut_exit_if(knut_io_uring_submit(&file->ring, &request, 1) != 1,
+        "[knut_pipeline_submit_read] Failed to submit read\n");
+    ++file->submitted;
+}
+
+/* Keeps a few chunk reads in flight, so the disk stays busy while the parser catches up. Read
+ * errors end the file like fread would. */
+static void knut_pipeline_reader(knut_pipeline_state_t* state, int fd)
+{
+    knut_pipeline_file_t file;
+    memset(&file, 0, sizeof(file));
+    file.fd = fd;
+    knut_exit_if(knut_io_uring_init(&file.ring, KNUT_PIPELINE_READ_AHEAD, 0) != 0,
+        "[knut_pipeline_reader] Failed to init ring\n");
+
+    const int fds[1] = { file.fd };
+    const bool fixed = knut_io_uring_register_files(&file.ring, fds, 1) == 0;
+    file.file_flags = fixed ? KNUT_IO_URING_FIXED_FILE : 0;
+    file.file = fixed ? 0 : file.fd;
+
+    bool end_of_file = false;
+
+    while (!end_of_file || file.processed < file.submitted)
+    {
+        while (!end_of_file && file.submitted - file.processed < KNUT_PIPELINE_READ_AHEAD)
+        {
+            knut_pipeline_submit_read(state, &file);
+        }
+
+        knut_io_uring_completion_t completions[KNUT_PIPELINE_READ_AHEAD];
+        const uint32_t count = knut_io_uring_poll(&file.ring, completions,
+            KNUT_PIPELINE_READ_AHEAD, -1);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            knut_pipeline_read_t* read =
+                &file.reads[completions[i].user_data % KNUT_PIPELINE_READ_AHEAD];
+            read->result = completions[i].result;
+            read->done = true;
+        }
+
+        /* Chunks are handed on in file order, whatever order their reads finish in */
+        for (; file.processed < file.submitted; ++file.processed)
+        {
+            knut_pipeline_read_t* read =
+                &file.reads[file.processed % KNUT_PIPELINE_READ_AHEAD];
+
+            if (!read->done)
+            {
+                break;
+            }
+
+            if (end_of_file)
+            {
+                knut_pool_free(&state->chunks, read->chunk);
+                continue;
+            }
+
+            /* Short reads are topped up, only the end of the file leaves a chunk partly empty */
+            const uint64_t offset = file.processed * KNUT_PIPELINE_CHUNK_SIZE;
+            char* const buffer = read->chunk->data + KNUT_PIPELINE_CARRY_SIZE;
+            int64_t bytes_read = read->result > 0 ? read->result : 0;
+            end_of_file = read->result <= 0;
+
+            while (!end_of_file && bytes_read < KNUT_PIPELINE_CHUNK_SIZE)
+            {
+                const int64_t result = pread(file.fd, buffer + bytes_read,
+                    KNUT_PIPELINE_CHUNK_SIZE - bytes_read, (off_t)(offset + bytes_read));
+                end_of_file = result <= 0;
+                bytes_read += result > 0 ? result : 0;
+            }
+
+            if (!end_of_file && file.processed + 1 == file.submitted)
+            {
+                knut_pipeline_submit_read(state, &file);
+            }
+
+            knut_pipeline_chunk_t* next = end_of_file ? NULL :
+                file.reads[(file.processed + 1) % KNUT_PIPELINE_READ_AHEAD].chunk;
+            knut_pipeline_push_chunk(state, read->chunk, (uint64_t)bytes_read, next);
+        }
+    }
+
+    knut_spsc_pipeline_chunk_close(&state->chunk_ring);
+    knut_io_uring_destroy(&file.ring);
+}
+
+#endif // ifdef _WIN32
+
+int knut_pipeline_run(const knut_pipeline_t* pipeline, const char* path, void* totals)
+{
+#ifdef _WIN32
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL)
+    {
+        return -1;
+    }
+#else
+    const int file = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (file < 0)
+    {
+        return -1;
+    }
+#endif
+
+    uint32_t num_workers = pipeline->num_workers;
+
+    if (num_workers == 0)
+    {
+        const uint32_t hardware_threads = knut_thread_hardware_concurrency();
+        num_workers = hardware_threads > 3 ? hardware_threads - 2 : 1;
+    }
+
+    knut_pipeline_state_t state;
+    state.pipeline = pipeline;
+    knut_pool_init(&state.chunks, sizeof(knut_pipeline_chunk_t),
+        _Alignof(knut_pipeline_chunk_t), KNUT_PIPELINE_READ_AHEAD + 2);
+    knut_pool_init(&state.batches, sizeof(knut_pipeline_batch_t) +
+        KNUT_PIPELINE_BATCH_SIZE * pipeline->record_size, 16, 16);
+    knut_spsc_pipeline_chunk_init(&state.chunk_ring, 8);
+    knut_mpmc_pipeline_batch_init(&state.batch_ring, 8 * num_workers);
+
+    knut_pipeline_worker_t* workers =
+        (knut_pipeline_worker_t*)calloc(num_workers, sizeof(*workers));
+    knut_thread_t* threads = (knut_thread_t*)calloc(num_workers + 1, sizeof(*threads));
+    knut_exit_if(!workers || !threads, "[knut_pipeline_run] Failed to alloc workers\n");
+
+    knut_exit_if(knut_thread_create(&threads[0],
+        (knut_function_t){ knut_pipeline_parser, &state }) != 0,
+        "[knut_pipeline_run] Failed to create parser thread\n");
+
+    for (uint32_t i = 0; i < num_workers; ++i)
+    {
+        workers[i].state = &state;
+        workers[i].totals = calloc(1, pipeline->totals_size);
+        knut_exit_if(!workers[i].totals, "[knut_pipeline_run] Failed to alloc totals\n");
+        knut_exit_if(knut_thread_create(&threads[i + 1],
+            (knut_function_t){ knut_pipeline_solver, &workers[i] }) != 0,
+            "[knut_pipeline_run] Failed to create solver thread\n");
+    }
+
+    knut_pipeline_reader(&state, file);
+#ifdef _WIN32
+    fclose(file);
+#else
+    close(file);
+#endif
+
+    for (uint32_t i = 0; i <= num_workers; ++i)
+    {
+        knut_thread_join(threads[i]);
+    }
+
+    for (uint32_t i = 0; i < num_workers; ++i)
+    {
+        pipeline->reduce(pipeline->ctx, totals, workers[i].totals);
+        free(workers[i].totals);
+    }
+
+    free(threads);
+    free(workers);
+    knut_mpmc_pipeline_batch_destroy(&state.batch_ring);
+    knut_spsc_pipeline_chunk_destroy(&state.chunk_ring);
+    knut_pool_destroy(&state.batches);
+    knut_pool_destroy(&state.chunks);
+
+    return 0;
+}
+
+#endif // KNUT_PIPELINE_IMPLEMENTATION
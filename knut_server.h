@@ -0,0 +1,746 @@
+#ifndef KNUT_SERVER_INCLUDE_H
+#define KNUT_SERVER_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+#include "knut_io.h"
+#include "knut_solve.h"
+#include "knut_thread.h"
+#include "knut_wire.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KNUT_SERVER_MAX_DAY 25
+
+/* Little endian on the wire
+ * request:  u32 day, u32 reserved, u64 input size, input bytes
+ * response: u32 status, u32 reserved, i64 part one, i64 part two
+ * Requests may be pipelined, responses come back in the same order. */
+#define KNUT_SERVER_REQUEST_HEADER_SIZE 16
+#define KNUT_SERVER_RESPONSE_SIZE 24
+
+typedef enum {
+    KNUT_SERVER_STATUS_OK = 0,
+    KNUT_SERVER_STATUS_UNKNOWN_DAY,
+    KNUT_SERVER_STATUS_TOO_LARGE,
+    KNUT_SERVER_STATUS_FAILED
+} knut_server_status_t;
+
+typedef struct {
+    knut_solve_t solvers[KNUT_SERVER_MAX_DAY + 1];
+    uint32_t num_workers;
+    uint64_t max_input_size;
+    uint64_t scratch_chunk_size;
+} knut_server_config_t;
+
+/* Defaults to one worker per hardware thread but at least four, since a worker is bound to its
+ * connection until the client closes it, 64 MiB inputs and 1 MiB scratch chunks */
+knut_server_config_t knut_server_default_config();
+
+KNUT_DEFINE_MPMC_RING(knut_io_socket_t, server_connection)
+
+struct knut_server_t;
+
+/* Serves one connection at a time, its scratch arena and buffers are kept between requests */
+typedef struct {
+    struct knut_server_t* server;
+    knut_thread_t thread;
+    knut_arena_t scratch;
+    knut_array_char_t input;
+    knut_array_char_t output;
+    knut_io_socket_t connection;
+    bool has_connection;
+    atomic_flag lock;
+} knut_server_worker_t;
+
+typedef struct {
+    struct knut_server_t* server;
+    knut_thread_t thread;
+    knut_io_socket_t listener;
+} knut_server_acceptor_t;
+
+/* Non-blocking connection owned by the shard that accepted it */
+typedef struct {
+    knut_io_socket_t socket;
+    knut_array_char_t input;
+    knut_array_char_t output;
+    uint64_t output_sent;
+    bool closing;
+} knut_server_session_t;
+
+KNUT_DEFINE_ARRAY(knut_server_session_t, server_session)
+KNUT_DEFINE_ARRAY(knut_io_pollfd_t, io_pollfd)
+
+/* Accepts and serves its own connections in one poll loop */
+typedef struct {
+    struct knut_server_t* server;
+    knut_thread_t thread;
+    knut_io_socket_t listener;
+    uint32_t cpu;
+    knut_arena_t scratch;
+    knut_array_server_session_t sessions;
+    knut_array_io_pollfd_t pollfds;
+} knut_server_shard_t;
+
+typedef struct knut_server_t {
+    knut_server_config_t config;
+    knut_server_acceptor_t* acceptors;
+    uint32_t num_acceptors;
+    knut_server_worker_t* workers;
+    uint32_t num_workers;
+    knut_mpmc_server_connection_t connections;
+    knut_server_shard_t* shards;
+    uint32_t num_shards;
+    knut_io_socket_t* listeners;
+    uint32_t num_listeners;
+    atomic_bool stopping;
+} knut_server_t;
+
+/* Takes ownership of the listening sockets, every listener gets its own accept thread */
+int knut_server_start(knut_server_t* server, const knut_server_config_t* config,
+    const knut_io_socket_t* listeners, uint32_t num_listeners);
+/* Binds one SO_REUSEPORT listener per shard so the kernel spreads the connections, shard i is
+ * pinned to CPU i. Without SO_REUSEPORT all shards poll one shared listener. 0 shards means
+ * one per hardware thread, config.num_workers is ignored. */
+int knut_server_start_sharded(knut_server_t* server, const knut_server_config_t* config,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint, uint32_t num_shards);
+/* Closes the listeners and all open connections and waits for the threads to finish */
+void knut_server_stop(knut_server_t* server);
+
+/* Client side, several requests can be sent before the first answer is read. Returns the
+ * status of the answer or -1 if the connection failed. */
+int knut_server_send_request(knut_io_socket_t socket, uint32_t day, const char* input,
+    uint64_t size);
+/* For clients that send the input themselves, e.g. with knut_io_sendfile */
+void knut_server_write_request_header(char* header, uint32_t day, uint64_t size);
+int knut_server_recv_answer(knut_io_socket_t socket, knut_answer_t* answer);
+/* Decodes a response of KNUT_SERVER_RESPONSE_SIZE bytes and returns its status */
+int knut_server_parse_answer(const char* response, knut_answer_t* answer);
+
+#endif // KNUT_SERVER_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_SERVER_IMPLEMENTATION) && !defined(KNUT_SERVER_IMPLEMENTATION_DONE)
+#define KNUT_SERVER_IMPLEMENTATION_DONE
+
+#if !defined(KNUT_DS_IMPLEMENTATION_DONE) || !defined(KNUT_IO_IMPLEMENTATION_DONE)
+#error "'knut_ds.h' and 'knut_io.h' must be implemented before this header can be used"
+#endif
+
+#include <string.h>
+
+#define KNUT_SERVER_RECV_SIZE (64 * 1024)
+
+knut_server_config_t knut_server_default_config()
+{
+    knut_server_config_t config;
+    memset(&config, 0, sizeof(config));
+    const uint32_t hardware_threads = knut_thread_hardware_concurrency();
+    config.num_workers = hardware_threads > 4 ? hardware_threads : 4;
+    config.max_input_size = 64 * 1024 * 1024;
+    config.scratch_chunk_size = 1024 * 1024;
+    return config;
+}
+
+static void knut_server_push_response(knut_array_char_t* output, knut_server_status_t status,
+    const knut_answer_t* answer)
+{
+    char response[KNUT_SERVER_RESPONSE_SIZE];
+    knut_wire_write_u32(response, (uint32_t)status);
+    knut_wire_write_u32(response + 4, 0);
+    knut_wire_write_u64(response + 8, (uint64_t)answer->part_one);
+    knut_wire_write_u64(response + 16, (uint64_t)answer->part_two);
+    knut_array_char_push_slice(output, response, KNUT_SERVER_RESPONSE_SIZE);
+}
+
+/* Answers the request at the start of 'data', returns the number of bytes it took, 0 if it
+ * isn't complete yet and -1 if the connection has to be dropped */
+static int64_t knut_server_handle_request(const knut_server_config_t* config,
+    knut_arena_t* scratch, knut_array_char_t* output, const char* data, uint64_t size)
+{
+    if (size < KNUT_SERVER_REQUEST_HEADER_SIZE)
+    {
+        return 0;
+    }
+
+    const uint32_t day = knut_wire_read_u32(data);
+    const uint64_t input_size = knut_wire_read_u64(data + 8);
+    knut_answer_t answer = { 0, 0 };
+
+    if (input_size > config->max_input_size)
+    {
+        knut_server_push_response(output, KNUT_SERVER_STATUS_TOO_LARGE, &answer);
+        return -1;
+    }
+
+    if (size - KNUT_SERVER_REQUEST_HEADER_SIZE < input_size)
+    {
+        return 0;
+    }
+
+    knut_server_status_t status = KNUT_SERVER_STATUS_UNKNOWN_DAY;
+
+    if (day <= KNUT_SERVER_MAX_DAY && config->solvers[day] != NULL)
+    {
+        const bool solved = config->solvers[day](data + KNUT_SERVER_REQUEST_HEADER_SIZE,
+            input_size, scratch, &answer) == 0;
+        status = solved ? KNUT_SERVER_STATUS_OK : KNUT_SERVER_STATUS_FAILED;
+        knut_arena_reset(scratch);
+    }
+
+    knut_server_push_response(output, status, &answer);
+    return (int64_t)(KNUT_SERVER_REQUEST_HEADER_SIZE + input_size);
+}
+
+/* Makes room for the next receive */
+static void knut_server_reserve_recv(knut_array_char_t* input)
+{
+    if (input->capacity - input->size < KNUT_SERVER_RECV_SIZE)
+    {
+        const uint64_t grown = 2 * input->capacity;
+        knut_array_char_reserve(input, grown > input->size + KNUT_SERVER_RECV_SIZE ?
+            grown : input->size + KNUT_SERVER_RECV_SIZE);
+    }
+}
+
+static int knut_server_recv(knut_io_socket_t connection, knut_array_char_t* input)
+{
+    knut_server_reserve_recv(input);
+    const uint64_t space = input->capacity - input->size;
+    const int received = knut_io_recv(connection, input->buffer + input->size,
+        space < INT32_MAX ? (int)space : INT32_MAX);
+    input->size += received > 0 ? received : 0;
+    return received;
+}
+
+/* Answers every complete request in 'input' and keeps the incomplete rest, returns false if
+ * the connection has to be dropped once the answers are sent */
+static bool knut_server_consume(const knut_server_config_t* config, knut_arena_t* scratch,
+    knut_array_char_t* input, knut_array_char_t* output)
+{
+    uint64_t consumed = 0;
+    int64_t request_size = 0;
+
+    while ((request_size = knut_server_handle_request(config, scratch, output,
+        input->buffer + consumed, input->size - consumed)) > 0)
+    {
+        consumed += request_size;
+    }
+
+    memmove(input->buffer, input->buffer + consumed, input->size - consumed);
+    input->size -= consumed;
+
+    if (request_size < 0)
+    {
+        return false;
+    }
+
+    /* Large inputs get their buffer in one go instead of doubling through the receives */
+    if (input->size >= KNUT_SERVER_REQUEST_HEADER_SIZE)
+    {
+        knut_array_char_reserve(input, KNUT_SERVER_REQUEST_HEADER_SIZE +
+            knut_wire_read_u64(input->buffer + 8));
+    }
+
+    return true;
+}
+
+/* Answers every complete request of one receive with a single send */
+static void knut_server_serve(knut_server_worker_t* worker, knut_io_socket_t connection)
+{
+    knut_array_char_t* input = &worker->input;
+    knut_array_char_t* output = &worker->output;
+    knut_array_char_clear(input);
+
+    while (knut_server_recv(connection, input) > 0)
+    {
+        const bool keep = knut_server_consume(&worker->server->config, &worker->scratch, input,
+            output);
+        const bool sent = output->size == 0 ||
+            knut_io_send_all(connection, output->buffer, output->size) == 0;
+        knut_array_char_clear(output);
+
+        if (!keep || !sent)
+        {
+            return;
+        }
+    }
+}
+
+static void knut_server_worker_lock(knut_server_worker_t* worker)
+{
+    while (atomic_flag_test_and_set_explicit(&worker->lock, memory_order_acquire)) {}
+}
+
+static void knut_server_worker_unlock(knut_server_worker_t* worker)
+{
+    atomic_flag_clear_explicit(&worker->lock, memory_order_release);
+}
+
+static void knut_server_worker(void* arg)
+{
+    knut_server_worker_t* worker = (knut_server_worker_t*)arg;
+    knut_server_t* server = worker->server;
+    knut_io_socket_t connection;
+
+    while (knut_mpmc_server_connection_pop(&server->connections, &connection))
+    {
+        knut_server_worker_lock(worker);
+        const bool stopping = atomic_load(&server->stopping);
+        worker->connection = connection;
+        worker->has_connection = !stopping;
+        knut_server_worker_unlock(worker);
+
+        if (!stopping)
+        {
+            knut_server_serve(worker, connection);
+        }
+
+        knut_server_worker_lock(worker);
+        worker->has_connection = false;
+        knut_server_worker_unlock(worker);
+        knut_io_close(connection);
+    }
+}
+
+static void knut_server_acceptor(void* arg)
+{
+    knut_server_acceptor_t* acceptor = (knut_server_acceptor_t*)arg;
+    knut_server_t* server = acceptor->server;
+
+    while (!atomic_load(&server->stopping))
+    {
+        const knut_io_socket_t connection = knut_io_accept(acceptor->listener);
+
+        if (!knut_io_socket_is_valid(connection))
+        {
+            continue;
+        }
+
+        if (!knut_mpmc_server_connection_push(&server->connections, connection))
+        {
+            knut_io_close(connection);
+        }
+    }
+}
+
+/* Closes the listeners no acceptor owns yet and stops what did start */
+static int knut_server_abort_start(knut_server_t* server, const knut_io_socket_t* listeners,
+    uint32_t first_listener, uint32_t num_listeners)
+{
+    for (uint32_t i = first_listener; i < num_listeners; ++i)
+    {
+        knut_io_close(listeners[i]);
+    }
+
+    knut_server_stop(server);
+    return -1;
+}
+
+int knut_server_start(knut_server_t* server, const knut_server_config_t* config,
+    const knut_io_socket_t* listeners, uint32_t num_listeners)
+{
+    memset(server, 0, sizeof(*server));
+    server->config = *config;
+    const uint32_t num_workers = config->num_workers > 0 ? config->num_workers : 1;
+    atomic_init(&server->stopping, false);
+    knut_mpmc_server_connection_init(&server->connections, 4 * num_workers + 4);
+
+    server->acceptors =
+        (knut_server_acceptor_t*)calloc(num_listeners, sizeof(*server->acceptors));
+    server->workers = (knut_server_worker_t*)calloc(num_workers, sizeof(*server->workers));
+    knut_exit_if(!server->acceptors || !server->workers,
+        "[knut_server_start] Failed to alloc threads\n");
+
+    /* Only running threads are counted, so stopping unwinds a partial start */
+    for (uint32_t i = 0; i < num_workers; ++i)
+    {
+        knut_server_worker_t* worker = &server->workers[i];
+        worker->server = server;
+        knut_arena_init(&worker->scratch, config->scratch_chunk_size);
+        worker->input = knut_array_char_create_with(KNUT_SERVER_RECV_SIZE, NULL);
+        worker->output = knut_array_char_create_with(KNUT_SERVER_RECV_SIZE, NULL);
+        atomic_flag_clear(&worker->lock);
+
+        if (knut_thread_create(&worker->thread,
+            (knut_function_t){ knut_server_worker, worker }) != 0)
+        {
+            knut_arena_destroy(&worker->scratch);
+            knut_array_char_destroy(&worker->input);
+            knut_array_char_destroy(&worker->output);
+            return knut_server_abort_start(server, listeners, 0, num_listeners);
+        }
+
+        ++server->num_workers;
+    }
+
+    for (uint32_t i = 0; i < num_listeners; ++i)
+    {
+        knut_server_acceptor_t* acceptor = &server->acceptors[i];
+        acceptor->server = server;
+        acceptor->listener = listeners[i];
+
+        if (knut_thread_create(&acceptor->thread,
+            (knut_function_t){ knut_server_acceptor, acceptor }) != 0)
+        {
+            return knut_server_abort_start(server, listeners, i, num_listeners);
+        }
+
+        ++server->num_acceptors;
+    }
+
+    return 0;
+}
+
+#define KNUT_SERVER_POLL_TIMEOUT_MS 100
+
+static void knut_server_session_close(knut_server_session_t* session)
+{
+    knut_io_close(session->socket);
+    knut_array_char_destroy(&session->input);
+    knut_array_char_destroy(&session->output);
+}
+
+/* Sends as much of the pending output as the socket takes without blocking */
+static bool knut_server_session_flush(knut_server_session_t* session)
+{
+    knut_array_char_t* output = &session->output;
+
+    while (session->output_sent < output->size)
+    {
+        const uint64_t left = output->size - session->output_sent;
+        const int sent = knut_io_send(session->socket, output->buffer + session->output_sent,
+            left < INT32_MAX ? (int)left : INT32_MAX);
+
+        if (sent <= 0)
+        {
+            return sent < 0 && knut_io_would_block();
+        }
+
+        session->output_sent += sent;
+    }
+
+    knut_array_char_clear(output);
+    session->output_sent = 0;
+    return true;
+}
+
+/* One receive per wakeup keeps a busy connection from starving the others, returns false once
+ * the session is done */
+static bool knut_server_session_update(knut_server_shard_t* shard, knut_server_session_t* session,
+    int16_t revents)
+{
+    const bool sending = session->output.size > 0;
+
+    if ((revents & (POLLERR | POLLNVAL)) != 0 || (sending && (revents & POLLHUP) != 0))
+    {
+        return false;
+    }
+
+    if ((revents & POLLOUT) != 0 && !knut_server_session_flush(session))
+    {
+        return false;
+    }
+
+    if ((revents & (POLLIN | POLLHUP)) != 0 && !sending)
+    {
+        const int received = knut_server_recv(session->socket, &session->input);
+
+        if (received == 0 || (received < 0 && !knut_io_would_block()))
+        {
+            return false;
+        }
+
+        session->closing = !knut_server_consume(&shard->server->config, &shard->scratch,
+            &session->input, &session->output);
+
+        if (!knut_server_session_flush(session))
+        {
+            return false;
+        }
+    }
+
+    return !session->closing || session->output.size > 0;
+}
+
+static void knut_server_shard_accept(knut_server_shard_t* shard)
+{
+    knut_io_socket_t connection;
+
+    while (knut_io_socket_is_valid(connection = knut_io_accept_with(shard->listener,
+        KNUT_IO_ACCEPT_NONBLOCK | KNUT_IO_ACCEPT_CLOEXEC, NULL, NULL)))
+    {
+        knut_server_session_t session;
+        memset(&session, 0, sizeof(session));
+        session.socket = connection;
+        knut_array_server_session_push(&shard->sessions, session);
+    }
+}
+
+static void knut_server_shard(void* arg)
+{
+    knut_server_shard_t* shard = (knut_server_shard_t*)arg;
+    knut_array_server_session_t* sessions = &shard->sessions;
+    knut_array_io_pollfd_t* pollfds = &shard->pollfds;
+    knut_thread_pin_current(shard->cpu);
+
+    while (!atomic_load(&shard->server->stopping))
+    {
+        knut_array_io_pollfd_clear(pollfds);
+        knut_io_pollfd_t listener_fd = { shard->listener.handle, POLLIN, 0 };
+        knut_array_io_pollfd_push(pollfds, listener_fd);
+
+        for (uint64_t i = 0; i < sessions->size; ++i)
+        {
+            const bool sending = sessions->buffer[i].output.size > 0;
+            knut_io_pollfd_t session_fd = {
+                sessions->buffer[i].socket.handle, sending ? POLLOUT : POLLIN, 0
+            };
+            knut_array_io_pollfd_push(pollfds, session_fd);
+        }
+
+        if (knut_io_poll(pollfds->buffer, pollfds->size, KNUT_SERVER_POLL_TIMEOUT_MS) <= 0)
+        {
+            continue;
+        }
+
+        /* Finished sessions are swapped with the last one, which was polled as well */
+        for (uint64_t i = sessions->size; i-- > 0;)
+        {
+            const int16_t revents = pollfds->buffer[i + 1].revents;
+
+            if (revents != 0 && !knut_server_session_update(shard, &sessions->buffer[i], revents))
+            {
+                knut_server_session_close(&sessions->buffer[i]);
+                sessions->buffer[i] = sessions->buffer[sessions->size - 1];
+                knut_array_server_session_pop(sessions);
+            }
+        }
+
+        if ((pollfds->buffer[0].revents & POLLIN) != 0)
+        {
+            knut_server_shard_accept(shard);
+        }
+    }
+
+    for (uint64_t i = 0; i < sessions->size; ++i)
+    {
+        knut_server_session_close(&sessions->buffer[i]);
+    }
+}
+
+static int knut_server_listen(knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint,
+    bool reuse_port, knut_io_socket_t* listener)
+{
+    *listener = knut_io_socket(family, KNUT_IO_SOCKET_TYPE_STREAM, KNUT_IO_PROTOCOL_TYPE_TCP);
+
+    if (!knut_io_socket_is_valid(*listener))
+    {
+        return -1;
+    }
+
+    /* IPv6 listeners take IPv4 clients as well where the system allows it */
+    if (family == KNUT_IO_ADDR_FAMILY_IPV6)
+    {
+        knut_io_set_dual_stack(*listener, true);
+    }
+
+    if ((reuse_port && knut_io_set_reuse_port(*listener) != 0) ||
+        knut_io_set_nonblocking(*listener, true) != 0 ||
+        knut_io_bind(*listener, family, endpoint) != 0 || knut_io_listen(*listener) != 0)
+    {
+        knut_io_close(*listener);
+        return -1;
+    }
+
+    return 0;
+}
+
+int knut_server_start_sharded(knut_server_t* server, const knut_server_config_t* config,
+    knut_io_addr_family_t family, const knut_io_endpoint_t* endpoint, uint32_t num_shards)
+{
+    memset(server, 0, sizeof(*server));
+    server->config = *config;
+    num_shards = num_shards > 0 ? num_shards : knut_thread_hardware_concurrency();
+    atomic_init(&server->stopping, false);
+
+    const uint32_t num_cpus = knut_thread_hardware_concurrency();
+    server->shards = (knut_server_shard_t*)calloc(num_shards, sizeof(*server->shards));
+    server->listeners = (knut_io_socket_t*)calloc(num_shards, sizeof(*server->listeners));
+    knut_exit_if(!server->shards || !server->listeners,
+        "[knut_server_start_sharded] Failed to alloc shards\n");
+
+    knut_io_socket_t listener;
+    const bool reuse_port = knut_server_listen(family, endpoint, true, &listener) == 0;
+
+    if (!reuse_port && knut_server_listen(family, endpoint, false, &listener) != 0)
+    {
+        knut_server_stop(server);
+        return -1;
+    }
+
+    server->listeners[server->num_listeners++] = listener;
+
+    /* num_shards only counts running shards, so stopping unwinds a partial start */
+    for (uint32_t i = 0; i < num_shards; ++i)
+    {
+        knut_server_shard_t* shard = &server->shards[i];
+
+        if (reuse_port && i > 0)
+        {
+            if (knut_server_listen(family, endpoint, true, &listener) != 0)
+            {
+                knut_server_stop(server);
+                return -1;
+            }
+
+            server->listeners[server->num_listeners++] = listener;
+        }
+
+        shard->server = server;
+        shard->listener = listener;
+        shard->cpu = i % num_cpus;
+        knut_arena_init(&shard->scratch, config->scratch_chunk_size);
+        shard->sessions = knut_array_server_session_create_with(16, NULL);
+        shard->pollfds = knut_array_io_pollfd_create_with(16, NULL);
+
+        if (knut_thread_create(&shard->thread,
+            (knut_function_t){ knut_server_shard, shard }) != 0)
+        {
+            knut_arena_destroy(&shard->scratch);
+            knut_array_server_session_destroy(&shard->sessions);
+            knut_array_io_pollfd_destroy(&shard->pollfds);
+            knut_server_stop(server);
+            return -1;
+        }
+
+        ++server->num_shards;
+    }
+
+    return 0;
+}
+
+void knut_server_stop(knut_server_t* server)
+{
+    atomic_store(&server->stopping, true);
+
+    /* Closing is what wakes up a blocked accept on Windows, everywhere else it's shutdown */
+    for (uint32_t i = 0; i < server->num_acceptors; ++i)
+    {
+#ifdef _WIN32
+        knut_io_close(server->acceptors[i].listener);
+#else
+        knut_io_shutdown(server->acceptors[i].listener);
+#endif
+    }
+
+    for (uint32_t i = 0; i < server->num_acceptors; ++i)
+    {
+        knut_thread_join(server->acceptors[i].thread);
+#ifndef _WIN32
+        knut_io_close(server->acceptors[i].listener);
+#endif
+    }
+
+    /* Shards notice the flag within one poll timeout */
+    for (uint32_t i = 0; i < server->num_shards; ++i)
+    {
+        knut_server_shard_t* shard = &server->shards[i];
+        knut_thread_join(shard->thread);
+        knut_arena_destroy(&shard->scratch);
+        knut_array_server_session_destroy(&shard->sessions);
+        knut_array_io_pollfd_destroy(&shard->pollfds);
+    }
+
+    for (uint32_t i = 0; i < server->num_listeners; ++i)
+    {
+        knut_io_close(server->listeners[i]);
+    }
+
+    if (server->workers != NULL)
+    {
+        knut_mpmc_server_connection_close(&server->connections);
+    }
+
+    for (uint32_t i = 0; i < server->num_workers; ++i)
+    {
+        knut_server_worker_t* worker = &server->workers[i];
+        knut_server_worker_lock(worker);
+
+        if (worker->has_connection)
+        {
+            knut_io_shutdown(worker->connection);
+        }
+
+        knut_server_worker_unlock(worker);
+    }
+
+    for (uint32_t i = 0; i < server->num_workers; ++i)
+    {
+        knut_server_worker_t* worker = &server->workers[i];
+        knut_thread_join(worker->thread);
+        knut_arena_destroy(&worker->scratch);
+        knut_array_char_destroy(&worker->input);
+        knut_array_char_destroy(&worker->output);
+    }
+
+    if (server->workers != NULL)
+    {
+        knut_mpmc_server_connection_destroy(&server->connections);
+    }
+
+    free(server->workers);
+    free(server->acceptors);
+    free(server->shards);
+    free(server->listeners);
+    memset(server, 0, sizeof(*server));
+}
+
+void knut_server_write_request_header(char* header, uint32_t day, uint64_t size)
+{
+    knut_wire_write_u32(header, day);
+    knut_wire_write_u32(header + 4, 0);
+    knut_wire_write_u64(header + 8, size);
+}
+
+int knut_server_send_request(knut_io_socket_t socket, uint32_t day, const char* input,
+    uint64_t size)
+{
+    char header[KNUT_SERVER_REQUEST_HEADER_SIZE];
+    knut_server_write_request_header(header, day, size);
+
+    knut_io_iovec_t request[2] = {
+        { header, sizeof(header) },
+        { (char*)input, size }
+    };
+
+    return knut_io_sendv_all(socket, request, 2);
+}
+
+int knut_server_recv_answer(knut_io_socket_t socket, knut_answer_t* answer)
+{
+    char response[KNUT_SERVER_RESPONSE_SIZE];
+
+    if (knut_io_recv_all(socket, response, sizeof(response)) != 0)
+    {
+        return -1;
+    }
+
+    return knut_server_parse_answer(response, answer);
+}
+
+int knut_server_parse_answer(const char* response, knut_answer_t* answer)
+{
+    answer->part_one = (int64_t)knut_wire_read_u64(response + 8);
+    answer->part_two = (int64_t)knut_wire_read_u64(response + 16);
+    return (int)knut_wire_read_u32(response);
+}
+
+#endif // KNUT_SERVER_IMPLEMENTATION
@@ -0,0 +1,20 @@
+#ifndef KNUT_SOLVE_INCLUDE_H
+#define KNUT_SOLVE_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+
+#include <stdint.h>
+
+/* Shared by the days that the server can solve, without pulling in the server itself */
+typedef struct {
+    int64_t part_one;
+    int64_t part_two;
+} knut_answer_t;
+
+/* Solves one puzzle input, everything taken from 'scratch' is released once the answer has
+ * been sent. Returns 0 on success. */
+typedef int (*knut_solve_t)(const char* input, uint64_t size, knut_arena_t* scratch,
+    knut_answer_t* answer);
+
+#endif // KNUT_SOLVE_INCLUDE_H
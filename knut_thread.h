@@ -0,0 +1,739 @@
+#ifndef KNUT_THREAD_INCLUDE_H
+#define KNUT_THREAD_INCLUDE_H
+
+#include "knut.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+
+typedef struct {
+    void* handle;
+} knut_thread_t;
+
+#else
+
+#include <pthread.h>
+
+typedef struct {
+    pthread_t handle;
+} knut_thread_t;
+
+#endif
+
+int knut_thread_create(knut_thread_t* thread, knut_function_t function);
+int knut_thread_join(knut_thread_t thread);
+uint32_t knut_thread_hardware_concurrency();
+/* Restricts the calling thread to one logical CPU, returns -1 where that isn't supported */
+int knut_thread_pin_current(uint32_t cpu);
+/* Runs tasks[0] on the calling thread and every other task on a thread of its own, returns once
+ * all of them are done */
+void knut_thread_run_all(const knut_function_t* tasks, uint32_t num_tasks);
+
+#define KNUT_CACHE_LINE_SIZE 64
+#define KNUT_RING_SPIN_COUNT 64
+
+/* Futex backed wait/notify, waiters register first and then re-check their condition before
+ * sleeping so a notify can't get lost in between */
+typedef struct {
+    _Atomic(uint32_t) epoch;
+    _Atomic(uint32_t) waiters;
+} knut_event_t;
+
+void knut_event_init(knut_event_t* event);
+uint32_t knut_event_prepare_wait(knut_event_t* event);
+void knut_event_cancel_wait(knut_event_t* event);
+void knut_event_wait(knut_event_t* event, uint32_t epoch);
+void knut_event_notify_all(knut_event_t* event);
+void knut_event_wake_all(knut_event_t* event);
+
+void knut_futex_wait(_Atomic(uint32_t)* address, uint32_t expected);
+void knut_futex_wake_all(_Atomic(uint32_t)* address);
+
+/* Bounded single producer single consumer ring, capacity is rounded up to a power of two. The
+ * blocking calls return short counts only once the ring is closed. */
+#define KNUT_DEFINE_SPSC_RING(TYPE, TYPE_NAME) \
+typedef struct { \
+    TYPE* buffer; \
+    uint64_t mask; \
+    char pad0[KNUT_CACHE_LINE_SIZE - sizeof(TYPE*) - sizeof(uint64_t)]; \
+    _Atomic(uint64_t) head; \
+    uint64_t cached_tail; \
+    char pad1[KNUT_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)]; \
+    _Atomic(uint64_t) tail; \
+    uint64_t cached_head; \
+    char pad2[KNUT_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)]; \
+    atomic_bool closed; \
+    knut_event_t not_empty; \
+    knut_event_t not_full; \
+} knut_spsc_##TYPE_NAME##_t; \
+\
+static void knut_spsc_##TYPE_NAME##_init(knut_spsc_##TYPE_NAME##_t* ring, uint64_t capacity) \
+{ \
+    KNUT_ASSERT(capacity > 0, "[knut_spsc_" #TYPE_NAME "_init] Capacity can't be 0\n"); \
+    capacity = knut_next_pow2_u64(capacity); \
+    memset(ring, 0, sizeof(*ring)); \
+    ring->buffer = (TYPE*)malloc(capacity * sizeof(TYPE)); \
+    KNUT_ASSERT(ring->buffer, "[knut_spsc_" #TYPE_NAME "_init] Failed to alloc buffer\n"); \
+    ring->mask = capacity - 1; \
+    atomic_init(&ring->head, 0); \
+    atomic_init(&ring->tail, 0); \
+    atomic_init(&ring->closed, false); \
+    knut_event_init(&ring->not_empty); \
+    knut_event_init(&ring->not_full); \
+} \
+\
+static void knut_spsc_##TYPE_NAME##_destroy(knut_spsc_##TYPE_NAME##_t* ring) \
+{ \
+    free(ring->buffer); \
+    ring->buffer = NULL; \
+} \
+\
+static void knut_spsc_##TYPE_NAME##_close(knut_spsc_##TYPE_NAME##_t* ring) \
+{ \
+    atomic_store(&ring->closed, true); \
+    knut_event_wake_all(&ring->not_empty); \
+    knut_event_wake_all(&ring->not_full); \
+} \
+\
+static bool knut_spsc_##TYPE_NAME##_is_closed(knut_spsc_##TYPE_NAME##_t* ring) \
+{ \
+    return atomic_load(&ring->closed); \
+} \
+\
+/* Producer only */ \
+static uint64_t knut_spsc_##TYPE_NAME##_try_push_slice(knut_spsc_##TYPE_NAME##_t* ring, \
+    const TYPE* values, uint64_t num_values) \
+{ \
+    const uint64_t capacity = ring->mask + 1; \
+    const uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed); \
+\
+    if (tail - ring->cached_head + num_values > capacity) \
+    { \
+        ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire); \
+    } \
+\
+    const uint64_t space = capacity - (tail - ring->cached_head); \
+    const uint64_t count = num_values < space ? num_values : space; \
+\
+    if (count == 0) \
+    { \
+        return 0; \
+    } \
+\
+    const uint64_t start = tail & ring->mask; \
+    const uint64_t first = count < capacity - start ? count : capacity - start; \
+    memcpy(ring->buffer + start, values, first * sizeof(TYPE)); \
+    memcpy(ring->buffer, values + first, (count - first) * sizeof(TYPE)); \
+\
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release); \
+    knut_event_notify_all(&ring->not_empty); \
+    return count; \
+} \
+\
+/* Consumer only */ \
+static uint64_t knut_spsc_##TYPE_NAME##_try_pop_slice(knut_spsc_##TYPE_NAME##_t* ring, \
+    TYPE* values, uint64_t max_values) \
+{ \
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed); \
+\
+    if (ring->cached_tail - head < max_values) \
+    { \
+        ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire); \
+    } \
+\
+    const uint64_t available = ring->cached_tail - head; \
+    const uint64_t count = max_values < available ? max_values : available; \
+\
+    if (count == 0) \
+    { \
+        return 0; \
+    } \
+\
+    const uint64_t capacity = ring->mask + 1; \
+    const uint64_t start = head & ring->mask; \
+    const uint64_t first = count < capacity - start ? count : capacity - start; \
+    memcpy(values, ring->buffer + start, first * sizeof(TYPE)); \
+    memcpy(values + first, ring->buffer, (count - first) * sizeof(TYPE)); \
+\
+    atomic_store_explicit(&ring->head, head + count, memory_order_release); \
+    knut_event_notify_all(&ring->not_full); \
+    return count; \
+} \
+\
+static uint64_t knut_spsc_##TYPE_NAME##_push_slice(knut_spsc_##TYPE_NAME##_t* ring, \
+    const TYPE* values, uint64_t num_values) \
+{ \
+    uint64_t pushed = 0; \
+    uint32_t spins = 0; \
+\
+    while (pushed < num_values && !knut_spsc_##TYPE_NAME##_is_closed(ring)) \
+    { \
+        uint64_t count = knut_spsc_##TYPE_NAME##_try_push_slice(ring, values + pushed, \
+            num_values - pushed); \
+\
+        if (count == 0 && ++spins > KNUT_RING_SPIN_COUNT) \
+        { \
+            const uint32_t epoch = knut_event_prepare_wait(&ring->not_full); \
+            count = knut_spsc_##TYPE_NAME##_try_push_slice(ring, values + pushed, \
+                num_values - pushed); \
+            if (count == 0 && !knut_spsc_##TYPE_NAME##_is_closed(ring)) \
+            { \
+                knut_event_wait(&ring->not_full, epoch); \
+            } \
+            else \
+            { \
+                knut_event_cancel_wait(&ring->not_full); \
+            } \
+        } \
+\
+        spins = count > 0 ? 0 : spins; \
+        pushed += count; \
+    } \
+\
+    return pushed; \
+} \
+\
+static bool knut_spsc_##TYPE_NAME##_push(knut_spsc_##TYPE_NAME##_t* ring, TYPE value) \
+{ \
+    return knut_spsc_##TYPE_NAME##_push_slice(ring, &value, 1) == 1; \
+} \
+\
+/* Waits for at least one entry, returns 0 once the ring is closed and drained */ \
+static uint64_t knut_spsc_##TYPE_NAME##_pop_slice(knut_spsc_##TYPE_NAME##_t* ring, \
+    TYPE* values, uint64_t max_values) \
+{ \
+    for (uint32_t spins = 0;; ++spins) \
+    { \
+        uint64_t count = knut_spsc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+\
+        if (count > 0 || max_values == 0) \
+        { \
+            return count; \
+        } \
+\
+        if (knut_spsc_##TYPE_NAME##_is_closed(ring)) \
+        { \
+            return knut_spsc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+        } \
+\
+        if (spins > KNUT_RING_SPIN_COUNT) \
+        { \
+            const uint32_t epoch = knut_event_prepare_wait(&ring->not_empty); \
+            count = knut_spsc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+            if (count == 0 && !knut_spsc_##TYPE_NAME##_is_closed(ring)) \
+            { \
+                knut_event_wait(&ring->not_empty, epoch); \
+            } \
+            else \
+            { \
+                knut_event_cancel_wait(&ring->not_empty); \
+            } \
+\
+            if (count > 0) \
+            { \
+                return count; \
+            } \
+        } \
+    } \
+} \
+\
+static bool knut_spsc_##TYPE_NAME##_pop(knut_spsc_##TYPE_NAME##_t* ring, TYPE* value) \
+{ \
+    return knut_spsc_##TYPE_NAME##_pop_slice(ring, value, 1) == 1; \
+} \
+
+/* Bounded multi producer multi consumer ring after Dmitry Vyukov, every cell carries a sequence
+ * number telling whether it is ready to be written or read for a given position */
+#define KNUT_DEFINE_MPMC_RING(TYPE, TYPE_NAME) \
+typedef struct { \
+    _Atomic(uint64_t) sequence; \
+    TYPE value; \
+} knut_mpmc_##TYPE_NAME##_cell_t; \
+\
+typedef struct { \
+    knut_mpmc_##TYPE_NAME##_cell_t* cells; \
+    uint64_t mask; \
+    char pad0[KNUT_CACHE_LINE_SIZE - sizeof(void*) - sizeof(uint64_t)]; \
+    _Atomic(uint64_t) enqueue_pos; \
+    char pad1[KNUT_CACHE_LINE_SIZE - sizeof(uint64_t)]; \
+    _Atomic(uint64_t) dequeue_pos; \
+    char pad2[KNUT_CACHE_LINE_SIZE - sizeof(uint64_t)]; \
+    atomic_bool closed; \
+    knut_event_t not_empty; \
+    knut_event_t not_full; \
+} knut_mpmc_##TYPE_NAME##_t; \
+\
+static void knut_mpmc_##TYPE_NAME##_init(knut_mpmc_##TYPE_NAME##_t* ring, uint64_t capacity) \
+{ \
+    KNUT_ASSERT(capacity > 1, "[knut_mpmc_" #TYPE_NAME "_init] Capacity has to be at least 2\n"); \
+    capacity = knut_next_pow2_u64(capacity); \
+    memset(ring, 0, sizeof(*ring)); \
+    ring->cells = (knut_mpmc_##TYPE_NAME##_cell_t*)malloc(capacity * sizeof(*ring->cells)); \
+    KNUT_ASSERT(ring->cells, "[knut_mpmc_" #TYPE_NAME "_init] Failed to alloc cells\n"); \
+    ring->mask = capacity - 1; \
+\
+    for (uint64_t i = 0; i < capacity; ++i) \
+    { \
+        atomic_init(&ring->cells[i].sequence, i); \
+    } \
+\
+    atomic_init(&ring->enqueue_pos, 0); \
+    atomic_init(&ring->dequeue_pos, 0); \
+    atomic_init(&ring->closed, false); \
+    knut_event_init(&ring->not_empty); \
+    knut_event_init(&ring->not_full); \
+} \
+\
+static void knut_mpmc_##TYPE_NAME##_destroy(knut_mpmc_##TYPE_NAME##_t* ring) \
+{ \
+    free(ring->cells); \
+    ring->cells = NULL; \
+} \
+\
+static void knut_mpmc_##TYPE_NAME##_close(knut_mpmc_##TYPE_NAME##_t* ring) \
+{ \
+    atomic_store(&ring->closed, true); \
+    knut_event_wake_all(&ring->not_empty); \
+    knut_event_wake_all(&ring->not_full); \
+} \
+\
+static bool knut_mpmc_##TYPE_NAME##_is_closed(knut_mpmc_##TYPE_NAME##_t* ring) \
+{ \
+    return atomic_load(&ring->closed); \
+} \
+\
+/* Claims the longest run of free cells at the current position, up to 'num_values' */ \
+static uint64_t knut_mpmc_##TYPE_NAME##_try_push_slice(knut_mpmc_##TYPE_NAME##_t* ring, \
+    const TYPE* values, uint64_t num_values) \
+{ \
+    uint64_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed); \
+    uint64_t count; \
+\
+    while (true) \
+    { \
+        count = 0; \
+        while (count < num_values && atomic_load_explicit( \
+            &ring->cells[(pos + count) & ring->mask].sequence, memory_order_acquire) == \
+            pos + count) \
+        { \
+            ++count; \
+        } \
+\
+        if (count == 0) \
+        { \
+            const uint64_t current = \
+                atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed); \
+            if (current == pos) \
+            { \
+                return 0; \
+            } \
+            pos = current; \
+        } \
+        else if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + count, \
+            memory_order_relaxed, memory_order_relaxed)) \
+        { \
+            break; \
+        } \
+    } \
+\
+    for (uint64_t i = 0; i < count; ++i) \
+    { \
+        knut_mpmc_##TYPE_NAME##_cell_t* cell = &ring->cells[(pos + i) & ring->mask]; \
+        cell->value = values[i]; \
+        atomic_store_explicit(&cell->sequence, pos + i + 1, memory_order_release); \
+    } \
+\
+    knut_event_notify_all(&ring->not_empty); \
+    return count; \
+} \
+\
+/* Claims the longest run of filled cells at the current position, up to 'max_values' */ \
+static uint64_t knut_mpmc_##TYPE_NAME##_try_pop_slice(knut_mpmc_##TYPE_NAME##_t* ring, \
+    TYPE* values, uint64_t max_values) \
+{ \
+    uint64_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed); \
+    uint64_t count; \
+\
+    while (true) \
+    { \
+        count = 0; \
+        while (count < max_values && atomic_load_explicit( \
+            &ring->cells[(pos + count) & ring->mask].sequence, memory_order_acquire) == \
+            pos + count + 1) \
+        { \
+            ++count; \
+        } \
+\
+        if (count == 0) \
+        { \
+            const uint64_t current = \
+                atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed); \
+            if (current == pos) \
+            { \
+                return 0; \
+            } \
+            pos = current; \
+        } \
+        else if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + count, \
+            memory_order_relaxed, memory_order_relaxed)) \
+        { \
+            break; \
+        } \
+    } \
+\
+    for (uint64_t i = 0; i < count; ++i) \
+    { \
+        knut_mpmc_##TYPE_NAME##_cell_t* cell = &ring->cells[(pos + i) & ring->mask]; \
+        values[i] = cell->value; \
+        atomic_store_explicit(&cell->sequence, pos + i + ring->mask + 1, memory_order_release); \
+    } \
+\
+    knut_event_notify_all(&ring->not_full); \
+    return count; \
+} \
+\
+static uint64_t knut_mpmc_##TYPE_NAME##_push_slice(knut_mpmc_##TYPE_NAME##_t* ring, \
+    const TYPE* values, uint64_t num_values) \
+{ \
+    uint64_t pushed = 0; \
+    uint32_t spins = 0; \
+\
+    while (pushed < num_values && !knut_mpmc_##TYPE_NAME##_is_closed(ring)) \
+    { \
+        uint64_t count = knut_mpmc_##TYPE_NAME##_try_push_slice(ring, values + pushed, \
+            num_values - pushed); \
+\
+        if (count == 0 && ++spins > KNUT_RING_SPIN_COUNT) \
+        { \
+            const uint32_t epoch = knut_event_prepare_wait(&ring->not_full); \
+            count = knut_mpmc_##TYPE_NAME##_try_push_slice(ring, values + pushed, \
+                num_values - pushed); \
+            if (count == 0 && !knut_mpmc_##TYPE_NAME##_is_closed(ring)) \
+            { \
+                knut_event_wait(&ring->not_full, epoch); \
+            } \
+            else \
+            { \
+                knut_event_cancel_wait(&ring->not_full); \
+            } \
+        } \
+\
+        spins = count > 0 ? 0 : spins; \
+        pushed += count; \
+    } \
+\
+    return pushed; \
+} \
+\
+static bool knut_mpmc_##TYPE_NAME##_push(knut_mpmc_##TYPE_NAME##_t* ring, TYPE value) \
+{ \
+    return knut_mpmc_##TYPE_NAME##_push_slice(ring, &value, 1) == 1; \
+} \
+\
+/* Waits for at least one entry, returns 0 once the ring is closed and drained */ \
+static uint64_t knut_mpmc_##TYPE_NAME##_pop_slice(knut_mpmc_##TYPE_NAME##_t* ring, \
+    TYPE* values, uint64_t max_values) \
+{ \
+    for (uint32_t spins = 0;; ++spins) \
+    { \
+        uint64_t count = knut_mpmc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+\
+        if (count > 0 || max_values == 0) \
+        { \
+            return count; \
+        } \
+\
+        if (knut_mpmc_##TYPE_NAME##_is_closed(ring)) \
+        { \
+            return knut_mpmc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+        } \
+\
+        if (spins > KNUT_RING_SPIN_COUNT) \
+        { \
+            const uint32_t epoch = knut_event_prepare_wait(&ring->not_empty); \
+            count = knut_mpmc_##TYPE_NAME##_try_pop_slice(ring, values, max_values); \
+            if (count == 0 && !knut_mpmc_##TYPE_NAME##_is_closed(ring)) \
+            { \
+                knut_event_wait(&ring->not_empty, epoch); \
+            } \
+            else \
+            { \
+                knut_event_cancel_wait(&ring->not_empty); \
+            } \
+\
+            if (count > 0) \
+            { \
+                return count; \
+            } \
+        } \
+    } \
+} \
+\
+static bool knut_mpmc_##TYPE_NAME##_pop(knut_mpmc_##TYPE_NAME##_t* ring, TYPE* value) \
+{ \
+    return knut_mpmc_##TYPE_NAME##_pop_slice(ring, value, 1) == 1; \
+} \
+
+
+#endif // KNUT_THREAD_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_THREAD_IMPLEMENTATION) && !defined(KNUT_THREAD_IMPLEMENTATION_DONE)
+#define KNUT_THREAD_IMPLEMENTATION_DONE
+
+#ifndef KNUT_IMPLEMENTATION_DONE
+#error "'knut.h' must be included with KNUT_IMPLEMENTATION before this header can be used"
+#endif
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+#pragma comment(lib, "Synchronization.lib")
+
+static DWORD WINAPI knut_thread_entry(LPVOID arg)
+{
+    knut_function_t function = *(knut_function_t*)arg;
+    free(arg);
+    function.proc(function.arg);
+    return 0;
+}
+
+int knut_thread_create(knut_thread_t* thread, knut_function_t function)
+{
+    knut_function_t* arg = (knut_function_t*)malloc(sizeof(*arg));
+    knut_exit_if(arg == NULL, "[knut_thread_create] malloc failed\n");
+    *arg = function;
+
+    thread->handle = CreateThread(NULL, 0, knut_thread_entry, arg, 0, NULL);
+
+    if (thread->handle == NULL)
+    {
+        free(arg);
+        return -1;
+    }
+
+    return 0;
+}
+
+int knut_thread_join(knut_thread_t thread)
+{
+    const DWORD result = WaitForSingleObject(thread.handle, INFINITE);
+    CloseHandle(thread.handle);
+    return result == WAIT_OBJECT_0 ? 0 : -1;
+}
+
+uint32_t knut_thread_hardware_concurrency()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+}
+
+/* Only the first processor group is addressable this way */
+int knut_thread_pin_current(uint32_t cpu)
+{
+    if (cpu >= 64)
+    {
+        return -1;
+    }
+
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0 ? 0 : -1;
+}
+
+void knut_futex_wait(_Atomic(uint32_t)* address, uint32_t expected)
+{
+    WaitOnAddress((volatile VOID*)address, &expected, sizeof(expected), INFINITE);
+}
+
+void knut_futex_wake_all(_Atomic(uint32_t)* address)
+{
+    WakeByAddressAll((PVOID)address);
+}
+
+#else
+
+#include <unistd.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+static void* knut_thread_entry(void* arg)
+{
+    knut_function_t function = *(knut_function_t*)arg;
+    free(arg);
+    function.proc(function.arg);
+    return NULL;
+}
+
+int knut_thread_create(knut_thread_t* thread, knut_function_t function)
+{
+    knut_function_t* arg = (knut_function_t*)malloc(sizeof(*arg));
+    knut_exit_if(arg == NULL, "[knut_thread_create] malloc failed\n");
+    *arg = function;
+
+    if (pthread_create(&thread->handle, NULL, knut_thread_entry, arg) != 0)
+    {
+        free(arg);
+        return -1;
+    }
+
+    return 0;
+}
+
+int knut_thread_join(knut_thread_t thread)
+{
+    return pthread_join(thread.handle, NULL) == 0 ? 0 : -1;
+}
+
+uint32_t knut_thread_hardware_concurrency()
+{
+    const long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t)count : 1;
+}
+
+#ifdef __linux__
+
+int knut_thread_pin_current(uint32_t cpu)
+{
+    if (cpu >= CPU_SETSIZE)
+    {
+        return -1;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+}
+
+#else
+
+int knut_thread_pin_current(uint32_t cpu)
+{
+    (void)cpu;
+    return -1;
+}
+
+#endif // ifdef __linux__
+
+#ifdef __linux__
+
+void knut_futex_wait(_Atomic(uint32_t)* address, uint32_t expected)
+{
+    syscall(SYS_futex, (uint32_t*)address, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void knut_futex_wake_all(_Atomic(uint32_t)* address)
+{
+    syscall(SYS_futex, (uint32_t*)address, FUTEX_WAKE_PRIVATE, INT32_MAX, NULL, NULL, 0);
+}
+
+#else
+
+/* No futex here, so waiting degrades to sleeping in short steps */
+void knut_futex_wait(_Atomic(uint32_t)* address, uint32_t expected)
+{
+    const struct timespec duration = { 0, 50000 };
+
+    while (atomic_load(address) == expected)
+    {
+        nanosleep(&duration, NULL);
+    }
+}
+
+void knut_futex_wake_all(_Atomic(uint32_t)* address)
+{
+    (void)address;
+}
+
+#endif // ifdef __linux__
+
+#endif // ifdef _WIN32
+
+void knut_thread_run_all(const knut_function_t* tasks, uint32_t num_tasks)
+{
+    if (num_tasks == 0)
+    {
+        return;
+    }
+
+    knut_thread_t* threads = (knut_thread_t*)malloc(num_tasks * sizeof(*threads));
+    knut_exit_if(threads == NULL, "[knut_thread_run_all] malloc failed\n");
+
+    for (uint32_t i = 1; i < num_tasks; ++i)
+    {
+        knut_exit_if(knut_thread_create(&threads[i], tasks[i]) != 0,
+            "[knut_thread_run_all] Failed to create thread\n");
+    }
+
+    tasks[0].proc(tasks[0].arg);
+
+    for (uint32_t i = 1; i < num_tasks; ++i)
+    {
+        knut_thread_join(threads[i]);
+    }
+
+    free(threads);
+}
+
+void knut_event_init(knut_event_t* event)
+{
+    atomic_init(&event->epoch, 0);
+    atomic_init(&event->waiters, 0);
+}
+
+/* The caller has to re-check its condition after this and then either wait or cancel */
+uint32_t knut_event_prepare_wait(knut_event_t* event)
+{
+    atomic_fetch_add(&event->waiters, 1);
+    return atomic_load(&event->epoch);
+}
+
+void knut_event_cancel_wait(knut_event_t* event)
+{
+    atomic_fetch_sub(&event->waiters, 1);
+}
+
+void knut_event_wait(knut_event_t* event, uint32_t epoch)
+{
+    knut_futex_wait(&event->epoch, epoch);
+    atomic_fetch_sub(&event->waiters, 1);
+}
+
+/* Cheap when nobody waits, the fence orders the caller's publish before reading the waiters */
+void knut_event_notify_all(knut_event_t* event)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (atomic_load_explicit(&event->waiters, memory_order_relaxed) > 0)
+    {
+        knut_event_wake_all(event);
+    }
+}
+
+void knut_event_wake_all(knut_event_t* event)
+{
+    atomic_fetch_add(&event->epoch, 1);
+    knut_futex_wake_all(&event->epoch);
+}
+
+#endif // KNUT_THREAD_IMPLEMENTATION
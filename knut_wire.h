@@ -0,0 +1,332 @@
+#ifndef KNUT_WIRE_INCLUDE_H
+#define KNUT_WIRE_INCLUDE_H
+
+#include "knut.h"
+#include "knut_ds.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* MSVC only targets little endian machines */
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define KNUT_WIRE_BIG_ENDIAN_HOST 1
+#else
+#define KNUT_WIRE_BIG_ENDIAN_HOST 0
+#endif
+
+/* Every message is a frame with a fixed little endian header
+ *   u32 body size, u16 type, u8 version, u8 flags
+ * followed by the body. Bodies are made of varints (LEB128, signed values zigzagged), fixed
+ * width little endian fields and arrays, which are a varint count followed by the raw values.
+ * Arrays are written in host order and KNUT_WIRE_FLAG_BIG_ENDIAN tells a reader on the other
+ * byte order to swap them, so peers only ever convert whole arrays at once. */
+#define KNUT_WIRE_HEADER_SIZE 8
+#define KNUT_WIRE_VERSION 1
+#define KNUT_WIRE_FLAG_BIG_ENDIAN 0x1
+#define KNUT_WIRE_MAX_VARINT_SIZE 10
+
+typedef struct {
+    uint32_t body_size;
+    uint16_t type;
+    uint8_t version;
+    uint8_t flags;
+} knut_wire_header_t;
+
+/* Reads a frame body, a failed read sets 'failed' and every read after it returns 0 */
+typedef struct {
+    const char* data;
+    uint64_t size;
+    uint64_t offset;
+    bool swap;
+    bool failed;
+} knut_wire_reader_t;
+
+static void knut_wire_write_u16(char* out, uint16_t value)
+{
+    value = KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u16(value) : value;
+    memcpy(out, &value, sizeof(value));
+}
+
+static void knut_wire_write_u32(char* out, uint32_t value)
+{
+    value = KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u32(value) : value;
+    memcpy(out, &value, sizeof(value));
+}
+
+static void knut_wire_write_u64(char* out, uint64_t value)
+{
+    value = KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u64(value) : value;
+    memcpy(out, &value, sizeof(value));
+}
+
+static uint16_t knut_wire_read_u16(const char* in)
+{
+    uint16_t value;
+    memcpy(&value, in, sizeof(value));
+    return KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u16(value) : value;
+}
+
+static uint32_t knut_wire_read_u32(const char* in)
+{
+    uint32_t value;
+    memcpy(&value, in, sizeof(value));
+    return KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u32(value) : value;
+}
+
+static uint64_t knut_wire_read_u64(const char* in)
+{
+    uint64_t value;
+    memcpy(&value, in, sizeof(value));
+    return KNUT_WIRE_BIG_ENDIAN_HOST ? knut_swap_u64(value) : value;
+}
+
+static uint64_t knut_wire_zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t knut_wire_unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* 'out' needs room for KNUT_WIRE_MAX_VARINT_SIZE bytes, returns the bytes written */
+static uint64_t knut_wire_write_varint(char* out, uint64_t value)
+{
+    uint64_t size = 0;
+
+    while (value >= 0x80)
+    {
+        out[size++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+
+    out[size++] = (char)value;
+    return size;
+}
+
+/* Returns the bytes read, 0 if the varint isn't complete yet and -1 if it is too long */
+static int knut_wire_read_varint(const char* in, uint64_t size, uint64_t* value)
+{
+    *value = 0;
+
+    for (uint64_t i = 0; i < size && i < KNUT_WIRE_MAX_VARINT_SIZE; ++i)
+    {
+        const uint8_t byte = (uint8_t)in[i];
+        *value |= (uint64_t)(byte & 0x7F) << (7 * i);
+
+        if ((byte & 0x80) == 0)
+        {
+            return (int)i + 1;
+        }
+    }
+
+    return size < KNUT_WIRE_MAX_VARINT_SIZE ? 0 : -1;
+}
+
+static void knut_wire_push_varint(knut_array_char_t* out, uint64_t value)
+{
+    char bytes[KNUT_WIRE_MAX_VARINT_SIZE];
+    knut_array_char_push_slice(out, bytes, knut_wire_write_varint(bytes, value));
+}
+
+static void knut_wire_push_i64(knut_array_char_t* out, int64_t value)
+{
+    knut_wire_push_varint(out, knut_wire_zigzag(value));
+}
+
+static void knut_wire_push_u32(knut_array_char_t* out, uint32_t value)
+{
+    char bytes[4];
+    knut_wire_write_u32(bytes, value);
+    knut_array_char_push_slice(out, bytes, sizeof(bytes));
+}
+
+static void knut_wire_push_u64(knut_array_char_t* out, uint64_t value)
+{
+    char bytes[8];
+    knut_wire_write_u64(bytes, value);
+    knut_array_char_push_slice(out, bytes, sizeof(bytes));
+}
+
+/* Starts a frame at the end of 'out', returns where it starts for knut_wire_end_frame */
+uint64_t knut_wire_begin_frame(knut_array_char_t* out, uint16_t type);
+/* Fills in the body size once the body has been pushed */
+void knut_wire_end_frame(knut_array_char_t* out, uint64_t start);
+
+/* Returns 0 once KNUT_WIRE_HEADER_SIZE bytes are there and -1 for unknown versions */
+int knut_wire_parse_header(const char* data, knut_wire_header_t* header);
+/* Fits knut_io_client_framing_t, so wire frames can be pipelined over a knut_io_client */
+uint64_t knut_wire_body_size(void* ctx, const char* header);
+knut_wire_reader_t knut_wire_reader_create(const knut_wire_header_t* header, const char* body);
+
+uint64_t knut_wire_pop_varint(knut_wire_reader_t* reader);
+int64_t knut_wire_pop_i64(knut_wire_reader_t* reader);
+uint32_t knut_wire_pop_u32(knut_wire_reader_t* reader);
+uint64_t knut_wire_pop_u64(knut_wire_reader_t* reader);
+/* Points at the next 'size' bytes of the body, NULL if it is too short */
+const char* knut_wire_pop_bytes(knut_wire_reader_t* reader, uint64_t size);
+
+/* Array payloads go from and to the array buffers with one copy each, without touching single
+ * values. Popping appends to the array and swaps the new values in one pass if the sender had
+ * the other byte order. */
+#define KNUT_WIRE_DEFINE_ARRAY(TYPE, TYPE_NAME, SWAP_TYPE, SWAP_NAME) \
+static void knut_wire_push_##TYPE_NAME##_slice(knut_array_char_t* out, const TYPE* values, \
+    uint64_t count) \
+{ \
+    knut_wire_push_varint(out, count); \
+    if (count > 0) \
+    { \
+        knut_array_char_push_slice(out, (const char*)values, count * sizeof(TYPE)); \
+    } \
+} \
+\
+static void knut_wire_push_array_##TYPE_NAME(knut_array_char_t* out, \
+    const knut_array_##TYPE_NAME##_t* values) \
+{ \
+    knut_wire_push_##TYPE_NAME##_slice(out, values->buffer, values->size); \
+} \
+\
+static int knut_wire_pop_array_##TYPE_NAME(knut_wire_reader_t* reader, \
+    knut_array_##TYPE_NAME##_t* values) \
+{ \
+    const uint64_t count = knut_wire_pop_varint(reader); \
+    if (reader->failed || count > (reader->size - reader->offset) / sizeof(TYPE)) \
+    { \
+        reader->failed = true; \
+        return -1; \
+    } \
+    if (count == 0) \
+    { \
+        return 0; \
+    } \
+    knut_array_##TYPE_NAME##_reserve(values, values->size + count); \
+    TYPE* first = values->buffer + values->size; \
+    memcpy(first, knut_wire_pop_bytes(reader, count * sizeof(TYPE)), count * sizeof(TYPE)); \
+    if (reader->swap) \
+    { \
+        knut_swap_##SWAP_NAME##_buffer((SWAP_TYPE*)first, count); \
+    } \
+    values->size += count; \
+    return 0; \
+} \
+
+KNUT_WIRE_DEFINE_ARRAY(uint16_t, u16, uint16_t, u16)
+KNUT_WIRE_DEFINE_ARRAY(uint32_t, u32, uint32_t, u32)
+KNUT_WIRE_DEFINE_ARRAY(uint64_t, u64, uint64_t, u64)
+KNUT_WIRE_DEFINE_ARRAY(int32_t, i32, uint32_t, u32)
+KNUT_WIRE_DEFINE_ARRAY(int64_t, i64, uint64_t, u64)
+KNUT_WIRE_DEFINE_ARRAY(int, int, uint32_t, u32)
+
+#endif // KNUT_WIRE_INCLUDE_H
+
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+// ==============================================================================
+
+#if defined(KNUT_WIRE_IMPLEMENTATION) && !defined(KNUT_WIRE_IMPLEMENTATION_DONE)
+#define KNUT_WIRE_IMPLEMENTATION_DONE
+
+#ifndef KNUT_DS_IMPLEMENTATION_DONE
+#error "'knut_ds.h' must be implemented before this header can be used"
+#endif
+
+uint64_t knut_wire_begin_frame(knut_array_char_t* out, uint16_t type)
+{
+    const uint64_t start = out->size;
+    char header[KNUT_WIRE_HEADER_SIZE];
+    knut_wire_write_u32(header, 0);
+    knut_wire_write_u16(header + 4, type);
+    header[6] = (char)KNUT_WIRE_VERSION;
+    header[7] = (char)(KNUT_WIRE_BIG_ENDIAN_HOST ? KNUT_WIRE_FLAG_BIG_ENDIAN : 0);
+    knut_array_char_push_slice(out, header, KNUT_WIRE_HEADER_SIZE);
+    return start;
+}
+
+void knut_wire_end_frame(knut_array_char_t* out, uint64_t start)
+{
+    const uint64_t body_size = out->size - start - KNUT_WIRE_HEADER_SIZE;
+    KNUT_ASSERT(body_size <= UINT32_MAX, "[knut_wire_end_frame] Body is too large\n");
+    knut_wire_write_u32(out->buffer + start, (uint32_t)body_size);
+}
+
+int knut_wire_parse_header(const char* data, knut_wire_header_t* header)
+{
+    header->body_size = knut_wire_read_u32(data);
+    header->type = knut_wire_read_u16(data + 4);
+    header->version = (uint8_t)data[6];
+    header->flags = (uint8_t)data[7];
+    return header->version == KNUT_WIRE_VERSION ? 0 : -1;
+}
+
+uint64_t knut_wire_body_size(void* ctx, const char* header)
+{
+    (void)ctx;
+    return knut_wire_read_u32(header);
+}
+
+knut_wire_reader_t knut_wire_reader_create(const knut_wire_header_t* header, const char* body)
+{
+    const bool big_endian = (header->flags & KNUT_WIRE_FLAG_BIG_ENDIAN) != 0;
+    knut_wire_reader_t reader = {
+        body,
+        header->body_size,
+        0,
+        big_endian != (bool)KNUT_WIRE_BIG_ENDIAN_HOST,
+        false
+    };
+    return reader;
+}
+
+uint64_t knut_wire_pop_varint(knut_wire_reader_t* reader)
+{
+    uint64_t value = 0;
+    const int size = reader->failed ? -1 : knut_wire_read_varint(reader->data + reader->offset,
+        reader->size - reader->offset, &value);
+
+    if (size <= 0)
+    {
+        reader->failed = true;
+        return 0;
+    }
+
+    reader->offset += size;
+    return value;
+}
+
+int64_t knut_wire_pop_i64(knut_wire_reader_t* reader)
+{
+    return knut_wire_unzigzag(knut_wire_pop_varint(reader));
+}
+
+const char* knut_wire_pop_bytes(knut_wire_reader_t* reader, uint64_t size)
+{
+    if (reader->failed || reader->size - reader->offset < size)
+    {
+        reader->failed = true;
+        return NULL;
+    }
+
+    const char* bytes = reader->data + reader->offset;
+    reader->offset += size;
+    return bytes;
+}
+
+uint32_t knut_wire_pop_u32(knut_wire_reader_t* reader)
+{
+    const char* bytes = knut_wire_pop_bytes(reader, 4);
+    return bytes != NULL ? knut_wire_read_u32(bytes) : 0;
+}
+
+uint64_t knut_wire_pop_u64(knut_wire_reader_t* reader)
+{
+    const char* bytes = knut_wire_pop_bytes(reader, 8);
+    return bytes != NULL ? knut_wire_read_u64(bytes) : 0;
+}
+
+#endif // KNUT_WIRE_IMPLEMENTATION
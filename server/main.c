@@ -0,0 +1,655 @@
+#define KNUT_IMPLEMENTATION
+#include "../knut.h"
+#define KNUT_DS_IMPLEMENTATION
+#include "../knut_ds.h"
+#define KNUT_IO_IMPLEMENTATION
+#include "../knut_io.h"
+#define KNUT_THREAD_IMPLEMENTATION
+#include "../knut_thread.h"
+#define KNUT_FIND_IMPLEMENTATION
+#include "../knut_find.h"
+#define KNUT_WIRE_IMPLEMENTATION
+#include "../knut_wire.h"
+#define KNUT_SERVER_IMPLEMENTATION
+#include "../knut_server.h"
+#define KNUT_IO_CLIENT_IMPLEMENTATION
+#include "../knut_io_client.h"
+
+#include "../day1/solve.h"
+#include "../day3/solve.h"
+#include "../day9/solve.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_LISTENERS 2
+/* Requests the solve client keeps in flight. The server stops reading while its answers aren't
+ * read, so an unbounded backlog deadlocks both sides on full socket buffers. */
+#define SOLVE_WINDOW 32
+
+static void print_usage()
+{
+    printf("Usage:\n");
+    printf("  knut_server serve [-tcp port] [-unix path] [-workers count]\n");
+    printf("  knut_server serve -tcp port -shards count\n");
+    printf("  knut_server solve (-tcp host:port | -tcp [ipv6]:port | -unix path) day input "
+        "[repeat [mode]]\n");
+    printf("    send modes: copy (default), sendfile, zerocopy\n");
+    printf("  knut_server bench -tcp host:port day input [connections [depth [requests]]]\n");
+}
+
+static bool resolve(knut_io_addr_family_t family, const char* host, const char* port,
+    knut_io_addrinfo_t* info)
+{
+    knut_io_getadddrinfo_args_t args = {
+        family,
+        KNUT_IO_SOCKET_TYPE_STREAM,
+        KNUT_IO_PROTOCOL_TYPE_TCP,
+        host,
+        port
+    };
+
+    if (knut_io_getaddrinfo(&args, info) != 0)
+    {
+        return false;
+    }
+
+    if (info->num_entires == 0)
+    {
+        knut_io_addrinfo_destroy(info);
+        return false;
+    }
+
+    return true;
+}
+
+/* Prefers a dual stack IPv6 wildcard and falls back to IPv4 on hosts without IPv6 */
+static bool resolve_listen(const char* port, knut_io_addr_family_t* family,
+    knut_io_endpoint_t* endpoint)
+{
+    const knut_io_addr_family_t families[2] = {
+        KNUT_IO_ADDR_FAMILY_IPV6,
+        KNUT_IO_ADDR_FAMILY_IPV4
+    };
+
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        knut_io_addrinfo_t info;
+        knut_io_socket_t probe = knut_io_socket(families[i], KNUT_IO_SOCKET_TYPE_STREAM,
+            KNUT_IO_PROTOCOL_TYPE_TCP);
+
+        if (!knut_io_socket_is_valid(probe))
+        {
+            continue;
+        }
+
+        knut_io_close(probe);
+
+        if (resolve(families[i], NULL, port, &info))
+        {
+            *family = info.families[0];
+            *endpoint = info.endpoints[0];
+            knut_io_addrinfo_destroy(&info);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static knut_io_socket_t listen_tcp(const char* port)
+{
+    knut_io_addr_family_t family;
+    knut_io_endpoint_t endpoint;
+    knut_exit_if(!resolve_listen(port, &family, &endpoint), "Unable to resolve port\n");
+
+    knut_io_socket_t listener = knut_io_socket(family, KNUT_IO_SOCKET_TYPE_STREAM,
+        KNUT_IO_PROTOCOL_TYPE_TCP);
+    knut_exit_if(!knut_io_socket_is_valid(listener), "Unable to listen on tcp port\n");
+
+    if (family == KNUT_IO_ADDR_FAMILY_IPV6)
+    {
+        knut_io_set_dual_stack(listener, true);
+    }
+
+    knut_exit_if(knut_io_bind(listener, family, &endpoint) != 0 ||
+        knut_io_listen(listener) != 0, "Unable to listen on tcp port\n");
+
+    return listener;
+}
+
+/* Tries every address the host resolves to in order */
+static knut_io_socket_t connect_tcp(const char* host, const char* port)
+{
+    knut_io_addrinfo_t info;
+    knut_exit_if(!resolve(KNUT_IO_ADDR_FAMILY_UNSPEC, host, port, &info),
+        "Unable to resolve host\n");
+
+    knut_io_socket_t socket = { 0 };
+    bool connected = false;
+
+    for (uint64_t i = 0; i < info.num_entires && !connected; ++i)
+    {
+        socket = knut_io_socket(info.families[i], KNUT_IO_SOCKET_TYPE_STREAM,
+            KNUT_IO_PROTOCOL_TYPE_TCP);
+
+        if (!knut_io_socket_is_valid(socket))
+        {
+            continue;
+        }
+
+        connected = knut_io_connect(socket, info.families[i], &info.endpoints[i]) == 0;
+
+        if (!connected)
+        {
+            knut_io_close(socket);
+        }
+    }
+
+    knut_io_addrinfo_destroy(&info);
+    knut_exit_if(!connected, "Unable to connect\n");
+
+    return socket;
+}
+
+/* IPv6 addresses come in brackets, [::1]:port. The returned copy backs both strings. */
+static char* split_host_port(const char* address, const char** name, const char** port)
+{
+    char* host = knut_strndup(address, strlen(address));
+    char* separator = strrchr(host, ':');
+    knut_exit_if(separator == NULL, "Expected host:port\n");
+    *separator = '\0';
+    *port = separator + 1;
+
+    const uint64_t length = strlen(host);
+
+    if (length >= 2 && host[0] == '[' && host[length - 1] == ']')
+    {
+        host[length - 1] = '\0';
+        *name = host + 1;
+    }
+    else
+    {
+        *name = host;
+    }
+
+    return host;
+}
+
+static knut_io_socket_t listen_unix(const char* path)
+{
+    remove(path);
+
+    knut_io_socket_t listener = knut_io_socket(KNUT_IO_ADDR_FAMILY_UNIX,
+        KNUT_IO_SOCKET_TYPE_STREAM, KNUT_IO_PROTOCOL_TYPE_TCP);
+    knut_exit_if(!knut_io_socket_is_valid(listener) || knut_io_bind_unix(listener, path) != 0 ||
+        knut_io_listen(listener) != 0, "Unable to listen on unix socket\n");
+
+    return listener;
+}
+
+/* Runs until a line is read from stdin or stdin is closed */
+static int serve(int argc, char** argv)
+{
+    knut_server_config_t config = knut_server_default_config();
+    config.solvers[1] = day1_solve;
+    config.solvers[3] = day3_solve;
+    config.solvers[9] = day9_solve;
+
+    const char* tcp_port = NULL;
+    const char* unix_path = NULL;
+    int64_t num_shards = -1;
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-tcp") == 0)
+        {
+            tcp_port = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-unix") == 0)
+        {
+            unix_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-workers") == 0)
+        {
+            config.num_workers = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        else if (strcmp(argv[i], "-shards") == 0)
+        {
+            num_shards = (int64_t)strtoul(argv[i + 1], NULL, 10);
+        }
+    }
+
+    knut_server_t server;
+
+    if (num_shards >= 0)
+    {
+        knut_exit_if(tcp_port == NULL || unix_path != NULL, "Shards only listen on tcp\n");
+
+        knut_io_addr_family_t family;
+        knut_io_endpoint_t endpoint;
+        knut_exit_if(!resolve_listen(tcp_port, &family, &endpoint), "Unable to resolve port\n");
+        knut_exit_if(knut_server_start_sharded(&server, &config, family, &endpoint,
+            (uint32_t)num_shards) != 0, "Unable to start server\n");
+
+        printf("Serving with %u shards on %u listeners, press enter to stop\n",
+            server.num_shards, server.num_listeners);
+    }
+    else
+    {
+        knut_io_socket_t listeners[MAX_LISTENERS];
+        uint32_t num_listeners = 0;
+
+        if (tcp_port != NULL)
+        {
+            listeners[num_listeners++] = listen_tcp(tcp_port);
+        }
+
+        if (unix_path != NULL)
+        {
+            listeners[num_listeners++] = listen_unix(unix_path);
+        }
+
+        knut_exit_if(num_listeners == 0, "Nothing to listen on\n");
+        knut_exit_if(knut_server_start(&server, &config, listeners, num_listeners) != 0,
+            "Unable to start server\n");
+
+        printf("Serving with %u workers, press enter to stop\n", server.num_workers);
+    }
+
+    fflush(stdout);
+    getchar();
+
+    knut_server_stop(&server);
+
+    if (unix_path != NULL)
+    {
+        remove(unix_path);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static double seconds_since(const struct timespec* start)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+static int solve(int argc, char** argv)
+{
+    const uint32_t repeat = argc > 6 ? (uint32_t)strtoul(argv[6], NULL, 10) : 1;
+
+    if (argc < 6 || repeat == 0)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    knut_io_socket_t socket;
+
+    if (strcmp(argv[2], "-unix") == 0)
+    {
+        socket = knut_io_socket(KNUT_IO_ADDR_FAMILY_UNIX, KNUT_IO_SOCKET_TYPE_STREAM,
+            KNUT_IO_PROTOCOL_TYPE_TCP);
+        knut_exit_if(!knut_io_socket_is_valid(socket) ||
+            knut_io_connect_unix(socket, argv[3]) != 0, "Unable to connect\n");
+    }
+    else
+    {
+        const char* name;
+        const char* port;
+        char* host = split_host_port(argv[3], &name, &port);
+        socket = connect_tcp(name, port);
+        free(host);
+    }
+
+    const uint32_t day = (uint32_t)strtoul(argv[4], NULL, 10);
+
+    knut_io_mapped_file_t file;
+    knut_exit_if(knut_io_map_file(&file, argv[5]) != 0, "Unable to open file\n");
+
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+
+    const char* send_mode = argc > 7 ? argv[7] : "copy";
+    const bool use_zerocopy = strcmp(send_mode, "zerocopy") == 0;
+    knut_io_zerocopy_t zerocopy;
+    uint32_t last_send = 0;
+
+    if (use_zerocopy)
+    {
+        knut_io_zerocopy_init(&zerocopy, socket);
+    }
+
+    /* Sends while the window has room and reads an answer otherwise */
+    knut_answer_t answer;
+    int status = KNUT_SERVER_STATUS_OK;
+    uint32_t num_sent = 0;
+    uint32_t num_received = 0;
+
+    while (num_received < repeat && status == KNUT_SERVER_STATUS_OK)
+    {
+        if (num_sent < repeat && num_sent - num_received < SOLVE_WINDOW)
+        {
+            char header[KNUT_SERVER_REQUEST_HEADER_SIZE];
+            knut_server_write_request_header(header, day, file.size);
+            int result;
+
+            if (strcmp(send_mode, "sendfile") == 0)
+            {
+                result = knut_io_send_all(socket, header, sizeof(header)) != 0 ? -1 :
+                    knut_io_sendfile(socket, &file, 0, file.size);
+            }
+            else if (use_zerocopy)
+            {
+                result = knut_io_send_all(socket, header, sizeof(header)) != 0 ? -1 :
+                    knut_io_zerocopy_send(&zerocopy, file.ptr, file.size, &last_send);
+            }
+            else
+            {
+                result = knut_server_send_request(socket, day, file.ptr, file.size);
+            }
+
+            knut_exit_if(result != 0, "Unable to send request\n");
+            ++num_sent;
+            continue;
+        }
+
+        status = knut_server_recv_answer(socket, &answer);
+        ++num_received;
+    }
+
+    const double seconds = seconds_since(&start);
+
+    /* The mapping may only go once the kernel let go of its pages */
+    if (use_zerocopy && status >= 0)
+    {
+        knut_exit_if(knut_io_zerocopy_wait(&zerocopy, last_send) != 0,
+            "Zero copy send failed\n");
+    }
+
+    knut_io_unmap_file(&file);
+    knut_io_close(socket);
+
+    knut_exit_if(status < 0, "Connection lost\n");
+    knut_exit_if(status != KNUT_SERVER_STATUS_OK, "Server failed to solve the input\n");
+
+    printf("Part one: %" PRId64 "\n", answer.part_one);
+    printf("Part two: %" PRId64 "\n", answer.part_two);
+    printf("%u requests, %.3f ms per request\n", repeat, seconds * 1e3 / repeat);
+
+    if (use_zerocopy && zerocopy.copied)
+    {
+        printf("Zero copy sends fell back to copying\n");
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static uint64_t now_ns()
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/* Answers have a fixed size and no body */
+static uint64_t answer_body_size(void* ctx, const char* header)
+{
+    (void)ctx; (void)header;
+    return 0;
+}
+
+typedef struct {
+    knut_io_client_t* client;
+    knut_io_addr_family_t family;
+    knut_io_endpoint_t endpoint;
+    uint32_t day;
+    const char* input;
+    uint64_t size;
+    uint32_t depth;
+    uint64_t num_requests;
+    knut_array_u64_t latencies;
+    knut_answer_t answer;
+    bool failed;
+} bench_thread_t;
+
+static bool bench_send(knut_io_client_connection_t* connection, bench_thread_t* bench,
+    char* header)
+{
+    const knut_io_iovec_t request[2] = {
+        { header, KNUT_SERVER_REQUEST_HEADER_SIZE },
+        { (char*)bench->input, bench->size }
+    };
+
+    return knut_io_client_write(connection, request, 2) == 0;
+}
+
+/* Keeps 'depth' requests in flight, the send times are queued in a ring of that size */
+static void bench_thread(void* arg)
+{
+    bench_thread_t* bench = (bench_thread_t*)arg;
+    knut_io_client_connection_t* connection =
+        knut_io_client_acquire(bench->client, bench->family, &bench->endpoint);
+
+    if (connection == NULL)
+    {
+        bench->failed = true;
+        return;
+    }
+
+    char header[KNUT_SERVER_REQUEST_HEADER_SIZE];
+    knut_server_write_request_header(header, bench->day, bench->size);
+
+    uint64_t* sent_at = (uint64_t*)calloc(bench->depth, sizeof(uint64_t));
+    knut_exit_if(sent_at == NULL, "[bench_thread] Failed to alloc send times\n");
+
+    uint64_t num_sent = 0;
+    uint64_t num_received = 0;
+
+    while (num_received < bench->num_requests && !bench->failed)
+    {
+        /* Everything written here leaves in one batch when the read flushes */
+        while (num_sent < bench->num_requests && num_sent - num_received < bench->depth)
+        {
+            sent_at[num_sent % bench->depth] = now_ns();
+
+            if (!bench_send(connection, bench, header))
+            {
+                bench->failed = true;
+                break;
+            }
+
+            ++num_sent;
+        }
+
+        const char* response;
+        uint64_t size;
+
+        if (bench->failed || knut_io_client_read(connection, &response, &size) != 0 ||
+            knut_server_parse_answer(response, &bench->answer) != KNUT_SERVER_STATUS_OK)
+        {
+            bench->failed = true;
+            break;
+        }
+
+        knut_array_u64_push(&bench->latencies,
+            now_ns() - sent_at[num_received % bench->depth]);
+        ++num_received;
+    }
+
+    free(sent_at);
+    knut_io_client_release(bench->client, connection);
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_us(const knut_array_u64_t* sorted, double percentile)
+{
+    uint64_t index = (uint64_t)(percentile * (double)sorted->size / 100.0);
+    index = index < sorted->size ? index : sorted->size - 1;
+    return (double)sorted->buffer[index] * 1e-3;
+}
+
+/* Pipelined load from one thread per pooled connection. Workers serve one connection each until
+ * it closes, so against worker mode there can't be more connections than workers. */
+static int bench(int argc, char** argv)
+{
+    if (argc < 6 || strcmp(argv[2], "-tcp") != 0)
+    {
+        print_usage();
+        return EXIT_FAILURE;
+    }
+
+    const uint32_t day = (uint32_t)strtoul(argv[4], NULL, 10);
+    const uint32_t num_connections = argc > 6 ? (uint32_t)strtoul(argv[6], NULL, 10) : 4;
+    const uint32_t depth = argc > 7 ? (uint32_t)strtoul(argv[7], NULL, 10) : 16;
+    const uint64_t num_requests = argc > 8 ? strtoull(argv[8], NULL, 10) : 1000;
+    knut_exit_if(num_connections == 0 || depth == 0 || num_requests == 0,
+        "Connections, depth and requests must be positive\n");
+
+    const char* name;
+    const char* port;
+    char* host = split_host_port(argv[3], &name, &port);
+    knut_io_addrinfo_t info;
+    knut_exit_if(!resolve(KNUT_IO_ADDR_FAMILY_UNSPEC, name, port, &info),
+        "Unable to resolve host\n");
+    free(host);
+
+    const knut_io_client_framing_t framing = {
+        KNUT_SERVER_RESPONSE_SIZE,
+        answer_body_size,
+        NULL
+    };
+    knut_io_client_t client;
+    knut_io_client_init(&client, &framing, num_connections);
+
+    /* The first address that takes a connection is used by every thread */
+    uint64_t entry = 0;
+
+    for (; entry < info.num_entires; ++entry)
+    {
+        knut_io_client_connection_t* connection =
+            knut_io_client_acquire(&client, info.families[entry], &info.endpoints[entry]);
+
+        if (connection != NULL)
+        {
+            knut_io_client_release(&client, connection);
+            break;
+        }
+    }
+
+    knut_exit_if(entry == info.num_entires, "Unable to connect\n");
+
+    knut_io_mapped_file_t file;
+    knut_exit_if(knut_io_map_file(&file, argv[5]) != 0, "Unable to open file\n");
+
+    bench_thread_t* benches = (bench_thread_t*)calloc(num_connections, sizeof(bench_thread_t));
+    knut_thread_t* threads = (knut_thread_t*)calloc(num_connections, sizeof(knut_thread_t));
+    knut_exit_if(benches == NULL || threads == NULL, "Failed to alloc bench threads\n");
+
+    struct timespec start;
+    timespec_get(&start, TIME_UTC);
+
+    for (uint32_t i = 0; i < num_connections; ++i)
+    {
+        bench_thread_t* bench = &benches[i];
+        bench->client = &client;
+        bench->family = info.families[entry];
+        bench->endpoint = info.endpoints[entry];
+        bench->day = day;
+        bench->input = file.ptr;
+        bench->size = file.size;
+        bench->depth = depth;
+        /* The remainder is spread over the first threads */
+        bench->num_requests = num_requests / num_connections + (i < num_requests % num_connections);
+        bench->latencies = knut_array_u64_create_with(bench->num_requests, NULL);
+
+        knut_exit_if(knut_thread_create(&threads[i], (knut_function_t){ bench_thread, bench }) != 0,
+            "Unable to start bench thread\n");
+    }
+
+    knut_array_u64_t latencies = knut_array_u64_create_with(num_requests, NULL);
+    bool failed = false;
+
+    for (uint32_t i = 0; i < num_connections; ++i)
+    {
+        knut_thread_join(threads[i]);
+        failed |= benches[i].failed;
+
+        if (benches[i].latencies.size > 0)
+        {
+            knut_array_u64_push_slice(&latencies, benches[i].latencies.buffer,
+                benches[i].latencies.size);
+        }
+
+        knut_array_u64_destroy(&benches[i].latencies);
+    }
+
+    const double seconds = seconds_since(&start);
+    const knut_answer_t answer = benches[0].answer;
+
+    free(threads);
+    free(benches);
+    knut_io_client_destroy(&client);
+    knut_io_unmap_file(&file);
+    knut_io_addrinfo_destroy(&info);
+
+    if (failed || latencies.size == 0)
+    {
+        knut_array_u64_destroy(&latencies);
+        knut_exit_if(true, "Bench failed, connection lost or input not solved\n");
+    }
+
+    qsort(latencies.buffer, latencies.size, sizeof(*latencies.buffer), compare_u64);
+
+    printf("Part one: %" PRId64 "\n", answer.part_one);
+    printf("Part two: %" PRId64 "\n", answer.part_two);
+    printf("%" PRIu64 " requests on %u connections with depth %u, %.0f requests per second\n",
+        latencies.size, num_connections, depth, (double)latencies.size / seconds);
+    printf("Latency us: p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+        percentile_us(&latencies, 50.0), percentile_us(&latencies, 90.0),
+        percentile_us(&latencies, 99.0), percentile_us(&latencies, 99.9),
+        (double)latencies.buffer[latencies.size - 1] * 1e-3);
+
+    knut_array_u64_destroy(&latencies);
+
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv)
+{
+    knut_exit_if(knut_io_init() != 0, "Unable to init sockets\n");
+
+    int result = EXIT_FAILURE;
+
+    if (argc >= 2 && strcmp(argv[1], "serve") == 0)
+    {
+        result = serve(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "solve") == 0)
+    {
+        result = solve(argc, argv);
+    }
+    else if (argc >= 2 && strcmp(argv[1], "bench") == 0)
+    {
+        result = bench(argc, argv);
+    }
+    else
+    {
+        print_usage();
+    }
+
+    knut_io_cleanup();
+
+    return result;
+}
\ No newline at end of file